@@ -0,0 +1,95 @@
+#include "allocation.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "object.h"
+
+namespace {
+void AddCounts(const ObjectAllocations& other, ObjectAllocations* counts) {
+    counts->allocated += other.allocated;
+    counts->allocated_bytes += other.allocated_bytes;
+    counts->live += other.live;
+    counts->live_bytes += other.live_bytes;
+    counts->peak_bytes = std::max(counts->peak_bytes, other.peak_bytes);
+}
+
+// Counts between two snapshots; peaks are measured from the live bytes of the first.
+AllocationStats Subtract(const AllocationCounters& end, const AllocationCounters& start) {
+    AllocationStats stats;
+    for (size_t i = 0; i < kObjectTypeCount; ++i) {
+        int64_t size = GetObjectSize(static_cast<ObjectType>(i));
+        const AllocationCounters::Type& before = start.types[i];
+        const AllocationCounters::Type& after = end.types[i];
+        ObjectAllocations& counts = stats.types[i];
+        counts.allocated = after.allocated - before.allocated;
+        counts.allocated_bytes = counts.allocated * size;
+        counts.live = after.live - before.live;
+        counts.live_bytes = counts.live * size;
+        counts.peak_bytes = (after.peak - before.live) * size;
+
+        stats.total.allocated += counts.allocated;
+        stats.total.allocated_bytes += counts.allocated_bytes;
+        stats.total.live += counts.live;
+    }
+    stats.total.live_bytes = end.live_bytes - start.live_bytes;
+    stats.total.peak_bytes = end.peak_bytes - start.live_bytes;
+    return stats;
+}
+
+void AppendLine(const char* name, const ObjectAllocations& counts, std::string* out) {
+    char line[160];
+    std::snprintf(line, sizeof(line),
+                  "%-7s %10llu allocated %12llu B  %+10lld live %+12lld B  peak %12lld B\n", name,
+                  static_cast<unsigned long long>(counts.allocated),
+                  static_cast<unsigned long long>(counts.allocated_bytes),
+                  static_cast<long long>(counts.live), static_cast<long long>(counts.live_bytes),
+                  static_cast<long long>(counts.peak_bytes));
+    *out += line;
+}
+}  // namespace
+
+const char* GetObjectTypeName(ObjectType type) {
+    static constexpr const char* kNames[kObjectTypeCount] = {"number", "bool", "quote", "symbol",
+                                                             "cell"};
+    return kNames[static_cast<size_t>(type)];
+}
+
+void AllocationStats::Add(const AllocationStats& other) {
+    for (size_t i = 0; i < kObjectTypeCount; ++i) {
+        AddCounts(other.types[i], &types[i]);
+    }
+    AddCounts(other.total, &total);
+}
+
+std::string AllocationStats::ToString() const {
+    std::string out;
+    for (size_t i = 0; i < kObjectTypeCount; ++i) {
+        if (types[i].allocated != 0 || types[i].live != 0) {
+            AppendLine(GetObjectTypeName(static_cast<ObjectType>(i)), types[i], &out);
+        }
+    }
+    AppendLine("total", total, &out);
+    return out;
+}
+
+AllocationStats GetThreadAllocations() {
+    return Subtract(allocation_counters, {});
+}
+
+AllocationWindow::AllocationWindow() : start_(allocation_counters) {
+    for (AllocationCounters::Type& counts : allocation_counters.types) {
+        counts.peak = counts.live;
+    }
+    allocation_counters.peak_bytes = allocation_counters.live_bytes;
+}
+
+AllocationStats AllocationWindow::Finish() {
+    AllocationStats window = Subtract(allocation_counters, start_);
+    for (size_t i = 0; i < kObjectTypeCount; ++i) {
+        allocation_counters.types[i].peak =
+            std::max(allocation_counters.types[i].peak, start_.types[i].peak);
+    }
+    allocation_counters.peak_bytes = std::max(allocation_counters.peak_bytes, start_.peak_bytes);
+    return window;
+}
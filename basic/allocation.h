@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum class ObjectType : uint8_t { kNumber, kBool, kQuote, kSymbol, kCell };
+
+inline constexpr size_t kObjectTypeCount = 5;
+
+const char* GetObjectTypeName(ObjectType type);
+
+// Objects of one type allocated and freed. Live counts are allocations minus frees, so over a
+// window they go negative when the window frees more older objects than it allocates.
+struct ObjectAllocations {
+    uint64_t allocated = 0;
+    uint64_t allocated_bytes = 0;
+    int64_t live = 0;
+    int64_t live_bytes = 0;
+    // Highest live_bytes reached.
+    int64_t peak_bytes = 0;
+};
+
+struct AllocationStats {
+    const ObjectAllocations& Get(ObjectType type) const {
+        return types[static_cast<size_t>(type)];
+    }
+
+    // Adds the counts of a later window; the peak is the highest of the two.
+    void Add(const AllocationStats& other);
+
+    // One line per type that allocated anything, then the total.
+    std::string ToString() const;
+
+    std::array<ObjectAllocations, kObjectTypeCount> types;
+    // All types together. Its peak is the peak of the sum, not the sum of the peaks.
+    ObjectAllocations total;
+};
+
+// Raw counters of the current thread, updated by the object allocator and by the collector.
+// Objects of a type all have the same size, so bytes per type follow from the counts. Read them
+// through GetThreadAllocations().
+struct AllocationCounters {
+    struct Type {
+        uint64_t allocated = 0;
+        int64_t live = 0;
+        int64_t peak = 0;
+    };
+
+    std::array<Type, kObjectTypeCount> types;
+    int64_t live_bytes = 0;
+    int64_t peak_bytes = 0;
+};
+
+inline thread_local AllocationCounters allocation_counters;
+
+inline void CountAllocation(ObjectType type, size_t size) {
+    AllocationCounters::Type& counts = allocation_counters.types[static_cast<size_t>(type)];
+    ++counts.allocated;
+    counts.peak = std::max(counts.peak, ++counts.live);
+    allocation_counters.live_bytes += size;
+    allocation_counters.peak_bytes =
+        std::max(allocation_counters.peak_bytes, allocation_counters.live_bytes);
+}
+
+inline void CountRelease(ObjectType type, size_t size) {
+    --allocation_counters.types[static_cast<size_t>(type)].live;
+    allocation_counters.live_bytes -= size;
+}
+
+// Everything the current thread allocated so far.
+AllocationStats GetThreadAllocations();
+
+// What the current thread allocated and freed between construction and Finish. Peaks are
+// measured from the live bytes at the start; the thread's own peaks are kept.
+class AllocationWindow {
+public:
+    AllocationWindow();
+
+    AllocationWindow(const AllocationWindow&) = delete;
+    AllocationWindow& operator=(const AllocationWindow&) = delete;
+
+    AllocationStats Finish();
+
+private:
+    AllocationCounters start_;
+};
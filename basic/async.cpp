@@ -0,0 +1,228 @@
+#include "async.h"
+#include "scheme.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+Scheduler::Scheduler(uint32_t slice_steps) : slice_steps_(std::max<uint32_t>(slice_steps, 1)) {
+}
+
+uint32_t Scheduler::GetSliceSteps() const {
+    return slice_steps_;
+}
+
+void Scheduler::Spawn(Task<void> task) {
+    ready_.push_back(task.GetHandle());
+    tasks_.push_back(std::move(task));
+}
+
+void Scheduler::Run() {
+    while (!ready_.empty()) {
+        std::coroutine_handle<> handle = ready_.front();
+        ready_.pop_front();
+        handle.resume();
+
+        if (tasks_.size() >= reap_at_) {
+            ReapFinished();
+        }
+    }
+    ReapFinished();
+}
+
+void Scheduler::ReapFinished() {
+    static constexpr size_t kMinReapAt = 64;
+
+    auto finished = std::partition(tasks_.begin(), tasks_.end(),
+                                   [](const Task<void>& task) { return !task.IsDone(); });
+    std::vector<Task<void>> done(std::make_move_iterator(finished),
+                                 std::make_move_iterator(tasks_.end()));
+    tasks_.erase(finished, tasks_.end());
+    reap_at_ = std::max(kMinReapAt, 2 * tasks_.size());
+    for (Task<void>& task : done) {
+        // Rethrows what the task failed with.
+        task.await_resume();
+    }
+}
+
+// A call whose arguments are being evaluated. Once they are, the handler runs on a copy of the
+// call with the values in place of the argument calls, lists and null quoted, so it sees the
+// values without evaluating anything.
+struct Interpreter::AsyncFrame {
+    Cell* call = nullptr;
+    ArgumentMode mode = ArgumentMode::kDirect;
+    // Cell holding the next argument to look at.
+    Object* next = nullptr;
+    Ref<Cell> rewritten = nullptr;
+    Cell* tail = nullptr;
+};
+
+bool Interpreter::PushFrame(Cell* call, std::vector<AsyncFrame>* frames) {
+    if (depth_left_ == 0) {
+        current_call_ = frames->empty() ? nullptr : frames->back().call;
+        Fail("Evaluation is nested too deeply", ErrorKind::kLimit);
+        current_call_ = nullptr;
+        return false;
+    }
+    --depth_left_;
+
+    AsyncFrame& frame = frames->emplace_back(AsyncFrame{.call = call});
+
+    // Calls without nested calls are handed to Evaluate as they are, which also spares them
+    // looking up the builtin twice.
+    bool has_calls = false;
+    for (Object* current = call->GetSecond().Get(); Is<Cell>(current) && !has_calls;
+         current = As<Cell>(current)->GetSecond().Get()) {
+        has_calls = Is<Cell>(As<Cell>(current)->GetFirst());
+    }
+    if (has_calls) {
+        frame.mode = GetArgumentMode(call);
+    }
+    if (frame.mode == ArgumentMode::kDirect) {
+        return true;
+    }
+
+    frame.next = call->GetSecond().Get();
+    frame.rewritten = MakeRef<Cell>();
+    frame.rewritten->first_ = call->GetFirst();
+    frame.rewritten->SetSourceOffset(call->GetSourceOffset());
+    frame.tail = frame.rewritten.Get();
+    return true;
+}
+
+// Runs up to `steps` calls of the program whose outermost call is at the bottom of frames.
+// Returns true once the program is evaluated or failed.
+bool Interpreter::EvaluateSlice(std::vector<AsyncFrame>* frames, Ref<Object>* result,
+                                uint32_t steps) {
+    auto append = [](AsyncFrame* frame, Ref<Object> argument) {
+        Ref<Cell> cell = MakeRef<Cell>();
+        cell->first_ = std::move(argument);
+        Cell* next_tail = cell.Get();
+        frame->tail->second_ = std::move(cell);
+        frame->tail = next_tail;
+    };
+
+    while (!frames->empty()) {
+        AsyncFrame& frame = frames->back();
+
+        // Plain arguments are copied; the first call found is evaluated on a frame of its own.
+        Cell* argument_call = nullptr;
+        while (Cell* current = As<Cell>(frame.next)) {
+            argument_call = As<Cell>(current->GetFirst());
+            if (argument_call != nullptr) {
+                break;
+            }
+            append(&frame, current->GetFirst());
+            frame.next = current->GetSecond().Get();
+        }
+        if (argument_call != nullptr) {
+            if (!PushFrame(argument_call, frames)) {
+                return true;
+            }
+            continue;
+        }
+
+        if (steps == 0) {
+            return false;
+        }
+        --steps;
+
+        ++depth_left_;
+        Ref<Object> value;
+        if (frame.rewritten != nullptr) {
+            frame.tail->second_ = Ref<Object>(frame.next);
+            value = Evaluate(frame.rewritten.Get());
+        } else {
+            value = Evaluate(frame.call);
+        }
+        frames->pop_back();
+        if (failed_) {
+            return true;
+        }
+        if (frames->empty()) {
+            *result = std::move(value);
+            return true;
+        }
+
+        AsyncFrame& parent = frames->back();
+        bool settled = false;
+        if (parent.mode != ArgumentMode::kEager) {
+            Bool* boolean = As<Bool>(value);
+            bool is_false = boolean != nullptr && !boolean->GetValue();
+            settled = (parent.mode == ArgumentMode::kAnd) == is_false;
+        }
+        if (Is<Number>(value) || Is<Bool>(value) || Is<Symbol>(value)) {
+            append(&parent, std::move(value));
+        } else {
+            Ref<Quote> quote = MakeRef<Quote>();
+            quote->next_ = std::move(value);
+            append(&parent, std::move(quote));
+        }
+        parent.next = As<Cell>(parent.next)->GetSecond().Get();
+        if (settled) {
+            // The handler stops at the settled value and never looks at the rest.
+            parent.tail->second_ = Ref<Object>(parent.next);
+            parent.next = nullptr;
+        }
+    }
+    return true;
+}
+
+Task<Expected<std::string>> Interpreter::RunAsync(Scheduler* scheduler, std::string input) {
+    Ref<Object> program;
+    Heap::Root program_root(heap_.get(), &program);
+    Ref<Object> result;
+    Heap::Root result_root(heap_.get(), &result);
+    std::vector<AsyncFrame> frames;
+
+    {
+        Heap::Scope heap_scope(heap_.get());
+        session_.Reset(input);
+        failed_ = false;
+        StartMeters();
+        Expected<Ref<Object>> read = ReadProgram(input);
+        if (!read) {
+            co_return read.GetError();
+        }
+        program = std::move(*read);
+        if (!CheckLimits()) {
+            co_return std::move(error_);
+        }
+
+        if (Cell* call = As<Cell>(program)) {
+            PushFrame(call, &frames);
+        } else {
+            result = GetAST(program);
+        }
+    }
+
+    // The heap scope is per slice: other interpreters run on this thread while we are suspended.
+    while (!frames.empty()) {
+        bool done = false;
+        {
+            Heap::Scope heap_scope(heap_.get());
+            done = EvaluateSlice(&frames, &result, scheduler->GetSliceSteps());
+        }
+        if (done) {
+            break;
+        }
+        co_await scheduler->Yield();
+    }
+
+    Heap::Scope heap_scope(heap_.get());
+    session_.ClearScratch();
+    frames.clear();
+    if (failed_) {
+        co_return std::move(error_);
+    }
+
+    std::string output;
+    Print(result, &output);
+    if (failed_) {
+        co_return std::move(error_);
+    }
+    program = nullptr;
+    result = nullptr;
+    Safepoint();
+    co_return output;
+}
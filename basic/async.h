@@ -0,0 +1,200 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <vector>
+
+template <class T>
+class Task;
+
+namespace detail {
+// What Task<T> and Task<void> promises have in common: they start suspended and, once done,
+// resume the coroutine that awaited them.
+class TaskPromiseBase {
+public:
+    struct FinalAwaiter {
+        bool await_ready() noexcept {
+            return false;
+        }
+
+        template <class Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            std::coroutine_handle<> continuation = handle.promise().continuation_;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {
+        }
+    };
+
+    std::suspend_always initial_suspend() noexcept {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() noexcept {
+        return {};
+    }
+
+    void unhandled_exception() {
+        exception_ = std::current_exception();
+    }
+
+    void SetContinuation(std::coroutine_handle<> continuation) {
+        continuation_ = continuation;
+    }
+
+    void RethrowIfFailed() {
+        if (exception_) {
+            std::rethrow_exception(exception_);
+        }
+    }
+
+private:
+    std::coroutine_handle<> continuation_;
+    std::exception_ptr exception_;
+};
+
+template <class T>
+class TaskPromise : public TaskPromiseBase {
+public:
+    Task<T> get_return_object();
+
+    void return_value(T value) {
+        value_.emplace(std::move(value));
+    }
+
+    T TakeValue() {
+        RethrowIfFailed();
+        return std::move(*value_);
+    }
+
+private:
+    std::optional<T> value_;
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+public:
+    Task<void> get_return_object();
+
+    void return_void() {
+    }
+
+    void TakeValue() {
+        RethrowIfFailed();
+    }
+};
+}  // namespace detail
+
+// Lazily started coroutine. Awaiting it runs it to completion, possibly across several
+// suspensions, and yields its result; Scheduler::Spawn runs one that nobody awaits.
+template <class T>
+class Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    explicit Task(Handle handle) : handle_(handle) {
+    }
+
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {
+    }
+
+    Task& operator=(Task&& other) noexcept {
+        Task(std::move(other)).Swap(*this);
+        return *this;
+    }
+
+    ~Task() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    void Swap(Task& other) noexcept {
+        std::swap(handle_, other.handle_);
+    }
+
+    bool IsDone() const {
+        return handle_ && handle_.done();
+    }
+
+    Handle GetHandle() const {
+        return handle_;
+    }
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle_.promise().SetContinuation(awaiting);
+        return handle_;
+    }
+
+    T await_resume() {
+        return handle_.promise().TakeValue();
+    }
+
+private:
+    Handle handle_;
+};
+
+template <class T>
+Task<T> detail::TaskPromise<T>::get_return_object() {
+    return Task<T>(Task<T>::Handle::from_promise(*this));
+}
+
+inline Task<void> detail::TaskPromise<void>::get_return_object() {
+    return Task<void>(Task<void>::Handle::from_promise(*this));
+}
+
+// Round-robin scheduler for coroutines sharing one thread. Evaluation yields to it after
+// GetSliceSteps() steps, so long runs are interleaved with short ones instead of blocking them.
+class Scheduler {
+public:
+    explicit Scheduler(uint32_t slice_steps = 1024);
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    uint32_t GetSliceSteps() const;
+
+    // Queues the task to start; the scheduler owns it until it completes.
+    void Spawn(Task<void> task);
+
+    // co_await scheduler->Yield() moves the calling coroutine to the back of the queue.
+    auto Yield() {
+        struct YieldAwaiter {
+            bool await_ready() noexcept {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) {
+                scheduler->ready_.push_back(handle);
+            }
+
+            void await_resume() noexcept {
+            }
+
+            Scheduler* scheduler;
+        };
+        return YieldAwaiter{this};
+    }
+
+    // Resumes queued coroutines until none is left. Exceptions from spawned tasks propagate.
+    void Run();
+
+private:
+    void ReapFinished();
+
+    uint32_t slice_steps_;
+    size_t reap_at_ = 0;
+    std::deque<std::coroutine_handle<>> ready_;
+    std::vector<Task<void>> tasks_;
+};
@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+"""Compares two scheme_bench result files and flags regressions.
+
+    bench/compare.py bench/baseline.json results.json [--threshold=0.10]
+
+A benchmark regresses when its ns/op grows by more than the threshold, or when it allocates more
+per operation than the baseline did. Exits with 1 if anything regressed.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    return data.get("context", {}), {b["name"]: b for b in data["benchmarks"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.10,
+                        help="relative ns/op increase that counts as a regression")
+    args = parser.parse_args()
+
+    base_context, baseline = load(args.baseline)
+    context, current = load(args.current)
+    if base_context.get("build") != context.get("build"):
+        print("warning: comparing a %s build against a %s baseline"
+              % (context.get("build"), base_context.get("build")), file=sys.stderr)
+
+    print("%-32s %12s %12s %8s %10s %10s" % ("benchmark", "base ns/op", "ns/op", "change",
+                                             "allocs/op", "peak MB"))
+    regressions = []
+    for name, result in current.items():
+        base = baseline.get(name)
+        if base is None:
+            print("%-32s %12s %12.1f %8s" % (name, "new", result["ns_per_op"], ""))
+            continue
+        change = result["ns_per_op"] / base["ns_per_op"] - 1 if base["ns_per_op"] else 0
+        flags = []
+        if change > args.threshold:
+            flags.append("slower")
+        for key in ("allocations_per_op", "object_bytes_per_op"):
+            if result[key] > base[key] + 1e-9:
+                flags.append("%s %.2f -> %.2f" % (key, base[key], result[key]))
+        print("%-32s %12.1f %12.1f %+7.1f%% %10.2f %10.1f %s"
+              % (name, base["ns_per_op"], result["ns_per_op"], change * 100,
+                 result["allocations_per_op"], result["peak_rss_bytes"] / 1e6, ", ".join(flags)))
+        if flags:
+            regressions.append(name)
+    for name in baseline:
+        if name not in current:
+            print("%-32s missing" % name)
+
+    if regressions:
+        print("\n%d regression(s): %s" % (len(regressions), " ".join(regressions)))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,136 @@
+#include "harness.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+#include <sys/resource.h>
+
+#include "../counting_new.h"
+#include "../object.h"
+
+namespace {
+struct RegisteredBenchmark {
+    std::string name;
+    BenchSetup setup;
+};
+
+std::vector<RegisteredBenchmark>& GetRegistry() {
+    static std::vector<RegisteredBenchmark> registry;
+    return registry;
+}
+
+// Linux lets a process reset its high-water mark; elsewhere the peak is the one of the process.
+void ResetPeakRss() {
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+}
+
+uint64_t GetPeakRss() {
+    std::ifstream status("/proc/self/status");
+    for (std::string line; std::getline(status, line);) {
+        if (line.rfind("VmHWM:", 0) == 0) {
+            return std::strtoull(line.c_str() + 6, nullptr, 10) << 10;
+        }
+    }
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<uint64_t>(usage.ru_maxrss) << 10;
+}
+}  // namespace
+
+void RegisterBenchmark(std::string name, BenchSetup setup) {
+    GetRegistry().push_back({std::move(name), std::move(setup)});
+}
+
+BenchResult RunBenchmark(const std::string& name, const BenchSetup& setup, double min_seconds) {
+    BenchOp op = setup();
+    op();
+    ResetPeakRss();
+
+    BenchResult result{.name = name};
+    for (uint64_t iterations = 1;;) {
+        uint64_t allocations = GetNewCount();
+        uint64_t object_bytes = allocated_object_bytes;
+        size_t bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            bytes += op();
+        }
+        double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (seconds >= min_seconds || iterations >= (uint64_t{1} << 40)) {
+            result.iterations = iterations;
+            result.ns_per_op = seconds * 1e9 / iterations;
+            result.bytes_per_second = seconds > 0 ? bytes / seconds : 0;
+            result.allocations_per_op =
+                static_cast<double>(GetNewCount() - allocations) / iterations;
+            result.object_bytes_per_op =
+                static_cast<double>(allocated_object_bytes - object_bytes) / iterations;
+            break;
+        }
+        // Aim a little past min_seconds, growing at least twofold and at most a hundredfold.
+        double scale = seconds > 0 ? min_seconds * 1.2 / seconds : 100;
+        iterations = static_cast<uint64_t>(iterations * std::clamp(scale, 2.0, 100.0));
+    }
+    result.peak_rss_bytes = GetPeakRss();
+    return result;
+}
+
+int RunBenchmarks(int argc, char** argv) {
+    std::string_view filter;
+    double min_seconds = 0.2;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg.rfind("--filter=", 0) == 0) {
+            filter = arg.substr(9);
+        } else if (arg.rfind("--min-time=", 0) == 0) {
+            min_seconds = std::strtod(argv[i] + 11, nullptr);
+        } else {
+            std::fprintf(stderr, "Usage: %s [--filter=SUBSTRING] [--min-time=SECONDS]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+
+    std::fprintf(stderr, "%-32s %12s %12s %10s %12s %10s\n", "benchmark", "ns/op", "MB/s",
+                 "allocs/op", "obj B/op", "peak MB");
+    std::vector<BenchResult> results;
+    for (const auto& [name, setup] : GetRegistry()) {
+        if (name.find(filter) == std::string::npos) {
+            continue;
+        }
+        const BenchResult& result = results.emplace_back(RunBenchmark(name, setup, min_seconds));
+        std::fprintf(stderr, "%-32s %12.1f %12.1f %10.2f %12.1f %10.1f\n", name.c_str(),
+                     result.ns_per_op, result.bytes_per_second / 1e6, result.allocations_per_op,
+                     result.object_bytes_per_op, result.peak_rss_bytes / 1e6);
+    }
+
+#ifdef NDEBUG
+    const char* build = "release";
+#else
+    const char* build = "debug";
+#endif
+    std::printf("{\n  \"context\": {\"build\": \"%s\", \"cpus\": %u},\n  \"benchmarks\": [\n",
+                build, std::thread::hardware_concurrency());
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& result = results[i];
+        std::printf("    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.2f, "
+                    "\"bytes_per_second\": %.0f, \"allocations_per_op\": %.3f, "
+                    "\"object_bytes_per_op\": %.1f, \"peak_rss_bytes\": %llu}%s\n",
+                    result.name.c_str(), static_cast<unsigned long long>(result.iterations),
+                    result.ns_per_op, result.bytes_per_second, result.allocations_per_op,
+                    result.object_bytes_per_op,
+                    static_cast<unsigned long long>(result.peak_rss_bytes),
+                    i + 1 < results.size() ? "," : "");
+    }
+    std::printf("  ]\n}\n");
+    return 0;
+}
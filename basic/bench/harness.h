@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A tiny benchmark harness for scheme_bench. A benchmark is registered with a setup function
+// that prepares its input and returns the operation to time; the operation returns the number of
+// input bytes it went through, or zero. Setup runs right before the benchmark, so inputs of
+// other benchmarks do not count towards its peak RSS.
+
+using BenchOp = std::function<size_t()>;
+using BenchSetup = std::function<BenchOp()>;
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations = 0;
+    double ns_per_op = 0;
+    // Zero for operations that do not report bytes.
+    double bytes_per_second = 0;
+    // Calls to the global operator new, and bytes of interpreter objects, see object.h.
+    double allocations_per_op = 0;
+    double object_bytes_per_op = 0;
+    // Peak resident set size while the benchmark ran, including whatever the process held before.
+    uint64_t peak_rss_bytes = 0;
+};
+
+void RegisterBenchmark(std::string name, BenchSetup setup);
+
+// Runs the operation in batches that grow until one takes at least min_seconds, and reports the
+// last batch.
+BenchResult RunBenchmark(const std::string& name, const BenchSetup& setup, double min_seconds);
+
+// Parses --filter=SUBSTRING and --min-time=SECONDS, runs the matching benchmarks, prints a table
+// to stderr and the results as JSON to stdout. Returns the exit code.
+int RunBenchmarks(int argc, char** argv);
@@ -0,0 +1,163 @@
+// Stage-isolated benchmarks of the tokenizer, the reader, the evaluator and the printer.
+//
+//   scheme_bench [--filter=SUBSTRING] [--min-time=SECONDS] > results.json
+//   bench/compare.py bench/baseline.json results.json
+//
+// Every benchmark prepares its input once and times a single stage over it: tokenizing and
+// reading go through a Session, evaluation calls Interpreter::Evaluate on a parsed program and
+// printing calls ASTToString on a prepared value. display evaluates (display 'value) into a
+// string port.
+
+#include <memory>
+#include <string>
+
+#include "../parser.h"
+#include "../ports.h"
+#include "../scheme.h"
+#include "../session.h"
+#include "harness.h"
+
+namespace {
+
+// (1 2 3 ... n)
+std::string FlatList(size_t n, const char* head = "") {
+    std::string text = "(";
+    text += head;
+    for (size_t i = 1; i <= n; ++i) {
+        if (i > 1 || *head != '\0') {
+            text += ' ';
+        }
+        text += std::to_string(i);
+    }
+    return text + ")";
+}
+
+// (((... (1) ...)))
+std::string DeepList(size_t n) {
+    return std::string(n, '(') + "1" + std::string(n, ')');
+}
+
+std::string Repeat(size_t n, const std::string& head, const std::string& element) {
+    std::string text = "(" + head;
+    for (size_t i = 0; i < n; ++i) {
+        text += ' ' + element;
+    }
+    return text + ")";
+}
+
+Ref<Object> ReadText(const std::string& text) {
+    Session session;
+    session.Reset(text);
+    return TryRead(session.GetTokenizer()).ValueOrThrow();
+}
+
+void RegisterTokenizer(const std::string& name, std::string text) {
+    RegisterBenchmark("tokenizer/" + name, [text = std::move(text)] {
+        auto session = std::make_shared<Session>();
+        return [session, &text] {
+            session->Reset(text);
+            Tokenizer* tokenizer = session->GetTokenizer();
+            while (!tokenizer->IsEnd()) {
+                tokenizer->Next();
+            }
+            return text.size();
+        };
+    });
+}
+
+void RegisterRead(const std::string& name, std::string text) {
+    RegisterBenchmark("read/" + name, [text = std::move(text)] {
+        auto session = std::make_shared<Session>();
+        return [session, &text] {
+            session->Reset(text);
+            TryRead(session->GetTokenizer()).ValueOrThrow();
+            return text.size();
+        };
+    });
+}
+
+void RegisterEvaluate(const std::string& name, std::string text, bool profiled = false) {
+    RegisterBenchmark("eval/" + name, [text = std::move(text), profiled] {
+        auto interpreter = std::make_shared<Interpreter>();
+        if (profiled) {
+            interpreter->EnableProfiling();
+        }
+        Ref<Object> program = ReadText(text);
+        return [interpreter, program]() -> size_t {
+            interpreter->Evaluate(As<Cell>(program));
+            return 0;
+        };
+    });
+}
+
+void RegisterPrint(const std::string& name, std::string text) {
+    RegisterBenchmark("print/" + name, [text = std::move(text)] {
+        auto interpreter = std::make_shared<Interpreter>();
+        Ref<Object> value = ReadText(text);
+        return [interpreter, value] { return interpreter->ASTToString(value).size(); };
+    });
+}
+
+void RegisterDisplay(const std::string& name, std::string text) {
+    RegisterBenchmark("display/" + name, [text = std::move(text)] {
+        auto port = std::make_shared<StringOutputPort>();
+        auto interpreter = std::make_shared<Interpreter>();
+        interpreter->SetOutputPort(port.get());
+        Ref<Object> program = ReadText("(display '" + text + ")");
+        return [interpreter, port, program] {
+            port->Clear();
+            interpreter->Evaluate(As<Cell>(program));
+            return port->GetSize();
+        };
+    });
+}
+
+void RegisterAll() {
+    for (size_t n : {10, 1000, 100000}) {
+        RegisterTokenizer("flat/" + std::to_string(n), FlatList(n));
+        RegisterTokenizer("symbols/" + std::to_string(n), Repeat(n, "list", "sym-x"));
+    }
+    for (size_t n : {10, 1000}) {
+        RegisterTokenizer("deep/" + std::to_string(n), DeepList(n));
+    }
+
+    for (size_t n : {10, 1000, 10000, 100000}) {
+        RegisterRead("flat/" + std::to_string(n), FlatList(n));
+    }
+    for (size_t n : {10, 1000}) {
+        RegisterRead("deep/" + std::to_string(n), DeepList(n));
+    }
+
+    for (size_t n : {10, 1000, 10000}) {
+        std::string size = std::to_string(n);
+        RegisterEvaluate("arith/" + size, FlatList(n, "+"));
+        RegisterEvaluate("compare/" + size, FlatList(n, "<"));
+        RegisterEvaluate("bool/" + size, Repeat(n, "and", "(< 1 2)"));
+        RegisterEvaluate("list/" + size, "(list-tail " + FlatList(n, "list") + " " +
+                                             std::to_string(n / 2) + ")");
+    }
+    // (+ (+ ... (+ 1 1) ... 1) 1)
+    for (size_t n : {10, 100}) {
+        std::string text = "1";
+        for (size_t i = 0; i < n; ++i) {
+            text = "(+ " + text + " 1)";
+        }
+        RegisterEvaluate("nested/" + std::to_string(n), text);
+        RegisterEvaluate("nested/" + std::to_string(n) + "/profiled", std::move(text), true);
+    }
+
+    for (size_t n : {10, 1000, 10000, 100000}) {
+        RegisterPrint("flat/" + std::to_string(n), FlatList(n));
+    }
+    for (size_t n : {10, 1000}) {
+        RegisterPrint("rows/" + std::to_string(n), Repeat(n, "row", "(1 (2 #t) sym)"));
+        RegisterDisplay("rows/" + std::to_string(n), Repeat(n, "row", "(1 (2 #t) sym)"));
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    RegisterAll();
+    return RunBenchmarks(argc, argv);
+}
@@ -0,0 +1,529 @@
+#include "binary.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+constexpr char kMagic[4] = {'S', 'C', 'M', 'B'};
+constexpr uint32_t kVersion = 1;
+
+// magic, version, then tree count, symbol count and the offsets of the four sections.
+constexpr size_t kHeaderSize = 8 + 6 * 8;
+
+// A cell is followed by its first element, then its second. kSizedCell puts the byte size of
+// the first element in between, as a fixed u32 the writer fills in once the element is written.
+enum Tag : uint8_t { kNull, kFalse, kTrue, kNumber, kSymbol, kQuote, kCell, kSizedCell };
+
+void PutU32(uint32_t value, char* out) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+void AppendU32(uint32_t value, std::string* out) {
+    out->append(4, '\0');
+    PutU32(value, out->data() + out->size() - 4);
+}
+
+void AppendU64(uint64_t value, std::string* out) {
+    for (int i = 0; i < 8; ++i) {
+        *out += static_cast<char>(value >> (8 * i));
+    }
+}
+
+void AppendVarint(uint64_t value, std::string* out) {
+    while (value >= 0x80) {
+        *out += static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    *out += static_cast<char>(value);
+}
+
+uint64_t GetU32(std::string_view bytes, size_t offset) {
+    uint64_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[offset + i])) << (8 * i);
+    }
+    return value;
+}
+
+uint64_t GetU64(std::string_view bytes, size_t offset) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[offset + i])) << (8 * i);
+    }
+    return value;
+}
+
+// Decodes the varint at *offset and moves past it; false if it runs off the end or overflows.
+bool GetVarint(std::string_view bytes, size_t* offset, uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*offset >= bytes.size()) {
+            return false;
+        }
+        uint8_t byte = bytes[(*offset)++];
+        *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool IsAtom(Object* node) {
+    return !Is<Cell>(node) && !Is<Quote>(node);
+}
+
+Error Malformed(size_t offset) {
+    return Error{ErrorKind::kSyntax, "Malformed binary image", offset};
+}
+}  // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+
+void BinaryWriter::Add(const Ref<Object>& tree) {
+    tree_offsets_.push_back(nodes_.size());
+    WriteNode(tree.Get());
+}
+
+size_t BinaryWriter::GetTreeCount() const {
+    return tree_offsets_.size();
+}
+
+// Walks down the spine of a list in a loop; only first elements that are lists recurse.
+void BinaryWriter::WriteNode(Object* node) {
+    while (true) {
+        if (node == nullptr) {
+            nodes_ += static_cast<char>(kNull);
+            return;
+        } else if (Number* number = As<Number>(node)) {
+            int64_t value = number->GetValue();
+            nodes_ += static_cast<char>(kNumber);
+            AppendVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63),
+                         &nodes_);
+            return;
+        } else if (Bool* boolean = As<Bool>(node)) {
+            nodes_ += static_cast<char>(boolean->GetValue() ? kTrue : kFalse);
+            return;
+        } else if (Symbol* symbol = As<Symbol>(node)) {
+            nodes_ += static_cast<char>(kSymbol);
+            AppendVarint(GetSymbolIndex(symbol->GetName()), &nodes_);
+            return;
+        } else if (Quote* quote = As<Quote>(node)) {
+            nodes_ += static_cast<char>(kQuote);
+            node = quote->next_.Get();
+            continue;
+        }
+
+        Cell* cell = As<Cell>(node);
+        Object* first = cell->GetFirst().Get();
+        if (IsAtom(first)) {
+            nodes_ += static_cast<char>(kCell);
+            WriteNode(first);
+        } else {
+            nodes_ += static_cast<char>(kSizedCell);
+            size_t size_at = nodes_.size();
+            nodes_.append(4, '\0');
+            WriteNode(first);
+            size_t size = nodes_.size() - size_at - 4;
+            if (size > std::numeric_limits<uint32_t>::max()) {
+                throw std::length_error("List element too large for a binary image");
+            }
+            PutU32(size, nodes_.data() + size_at);
+        }
+        node = cell->GetSecond().Get();
+    }
+}
+
+uint32_t BinaryWriter::GetSymbolIndex(const std::string& name) {
+    if (auto found = symbol_indices_.find(name); found != symbol_indices_.end()) {
+        return found->second;
+    }
+    if (names_.size() + name.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Too many symbol names for a binary image");
+    }
+    uint32_t index = symbols_.size();
+    symbols_.emplace_back(names_.size(), name.size());
+    names_ += name;
+    symbol_indices_.emplace(name, index);
+    return index;
+}
+
+std::string BinaryWriter::Finish() const {
+    size_t trees_offset = kHeaderSize;
+    size_t symbols_offset = trees_offset + 8 * tree_offsets_.size();
+    size_t names_offset = symbols_offset + 8 * symbols_.size();
+    size_t nodes_offset = names_offset + names_.size();
+
+    std::string image;
+    image.reserve(nodes_offset + nodes_.size());
+    image.append(kMagic, sizeof(kMagic));
+    AppendU32(kVersion, &image);
+    AppendU64(tree_offsets_.size(), &image);
+    AppendU64(symbols_.size(), &image);
+    AppendU64(trees_offset, &image);
+    AppendU64(symbols_offset, &image);
+    AppendU64(names_offset, &image);
+    AppendU64(nodes_offset, &image);
+    for (uint64_t offset : tree_offsets_) {
+        AppendU64(nodes_offset + offset, &image);
+    }
+    for (auto [offset, size] : symbols_) {
+        AppendU32(offset, &image);
+        AppendU32(size, &image);
+    }
+    image += names_;
+    image += nodes_;
+    return image;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+BinaryNode BinaryImage::Decode(size_t offset, size_t* end) const {
+    BinaryNode node;
+    node.image_ = this;
+    node.offset_ = offset;
+    if (offset < nodes_offset_ || offset >= bytes_.size()) {
+        return node;
+    }
+
+    size_t position = offset + 1;
+    uint64_t value = 0;
+    switch (static_cast<uint8_t>(bytes_[offset])) {
+        case kNull:
+            node.kind_ = BinaryNode::Kind::kNull;
+            break;
+        case kFalse:
+        case kTrue:
+            node.kind_ = BinaryNode::Kind::kBool;
+            node.value_ = bytes_[offset] == kTrue;
+            break;
+        case kNumber:
+            if (!GetVarint(bytes_, &position, &value)) {
+                return node;
+            }
+            node.value_ = static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+            if (node.value_ < std::numeric_limits<int>::min() ||
+                node.value_ > std::numeric_limits<int>::max()) {
+                return node;
+            }
+            node.kind_ = BinaryNode::Kind::kNumber;
+            break;
+        case kSymbol:
+            if (!GetVarint(bytes_, &position, &value) || value >= symbol_count_) {
+                return node;
+            }
+            node.kind_ = BinaryNode::Kind::kSymbol;
+            node.value_ = value;
+            break;
+        case kQuote:
+            node.kind_ = BinaryNode::Kind::kQuote;
+            node.first_ = position;
+            break;
+        case kCell: {
+            size_t first_end = 0;
+            BinaryNode::Kind first = Decode(position, &first_end).kind_;
+            if (first == BinaryNode::Kind::kInvalid || first == BinaryNode::Kind::kQuote ||
+                first == BinaryNode::Kind::kCell) {
+                return node;
+            }
+            node.kind_ = BinaryNode::Kind::kCell;
+            node.first_ = position;
+            node.second_ = first_end;
+            break;
+        }
+        case kSizedCell:
+            if (bytes_.size() - position < 4) {
+                return node;
+            }
+            node.first_ = position + 4;
+            if (GetU32(bytes_, position) >= bytes_.size() - node.first_) {
+                return node;
+            }
+            node.kind_ = BinaryNode::Kind::kCell;
+            node.second_ = node.first_ + GetU32(bytes_, position);
+            break;
+        default:
+            return node;
+    }
+    if (end != nullptr) {
+        *end = position;
+    }
+    return node;
+}
+
+Expected<BinaryImage> BinaryImage::Open(std::string_view bytes) {
+    if (bytes.size() < kHeaderSize || bytes.compare(0, sizeof(kMagic), kMagic, 4) != 0) {
+        return Error{ErrorKind::kSyntax, "Not a binary image"};
+    }
+    if (GetU32(bytes, 4) != kVersion) {
+        return Error{ErrorKind::kSyntax, "Unsupported binary image version", 4};
+    }
+
+    BinaryImage image;
+    image.bytes_ = bytes;
+    uint64_t tree_count = GetU64(bytes, 8);
+    uint64_t symbol_count = GetU64(bytes, 16);
+    uint64_t trees_offset = GetU64(bytes, 24);
+    uint64_t symbols_offset = GetU64(bytes, 32);
+    uint64_t names_offset = GetU64(bytes, 40);
+    uint64_t nodes_offset = GetU64(bytes, 48);
+    // Sections are in order and do not overlap.
+    if (trees_offset < kHeaderSize || trees_offset > symbols_offset ||
+        tree_count > (symbols_offset - trees_offset) / 8 || symbols_offset > names_offset ||
+        symbol_count > (names_offset - symbols_offset) / 8 || names_offset > nodes_offset ||
+        nodes_offset > bytes.size()) {
+        return Malformed(0);
+    }
+    image.tree_count_ = tree_count;
+    image.trees_offset_ = trees_offset;
+    image.symbol_count_ = symbol_count;
+    image.symbols_offset_ = symbols_offset;
+    image.names_offset_ = names_offset;
+    image.nodes_offset_ = nodes_offset;
+
+    for (size_t i = 0; i < tree_count; ++i) {
+        uint64_t offset = GetU64(bytes, trees_offset + 8 * i);
+        if (offset < nodes_offset || offset >= bytes.size()) {
+            return Malformed(trees_offset + 8 * i);
+        }
+    }
+    for (size_t i = 0; i < symbol_count; ++i) {
+        uint64_t offset = GetU32(bytes, symbols_offset + 8 * i);
+        uint64_t size = GetU32(bytes, symbols_offset + 8 * i + 4);
+        if (offset + size > nodes_offset - names_offset) {
+            return Malformed(symbols_offset + 8 * i);
+        }
+    }
+    return image;
+}
+
+size_t BinaryImage::GetTreeCount() const {
+    return tree_count_;
+}
+
+BinaryNode BinaryImage::GetTree(size_t index) const {
+    assert(index < tree_count_);
+    return Decode(GetU64(bytes_, trees_offset_ + 8 * index));
+}
+
+std::string_view BinaryImage::GetSymbol(size_t index) const {
+    assert(index < symbol_count_);
+    size_t entry = symbols_offset_ + 8 * index;
+    return bytes_.substr(names_offset_ + GetU32(bytes_, entry), GetU32(bytes_, entry + 4));
+}
+
+size_t BinaryImage::GetSymbolCount() const {
+    return symbol_count_;
+}
+
+// Builds objects the way the reader does: recursing into nested lists and quotes, looping along
+// the spine of a list. Fails on the first node that does not decode.
+class BinaryImage::Loader {
+public:
+    explicit Loader(size_t max_depth)
+        : depth_left_(max_depth == 0 ? BinaryImage::kDefaultMaxDepth : max_depth) {
+    }
+
+    bool Failed() const {
+        return failed_;
+    }
+
+    Error& GetError() {
+        return error_;
+    }
+
+    Ref<Object> Load(const BinaryNode& node) {
+        switch (node.GetKind()) {
+            case BinaryNode::Kind::kNull:
+                return nullptr;
+            case BinaryNode::Kind::kNumber:
+                return MakeRef<Number>(node.GetNumber());
+            case BinaryNode::Kind::kBool:
+                return MakeRef<Bool>(node.GetBool());
+            case BinaryNode::Kind::kSymbol:
+                return MakeRef<Symbol>(std::string(node.GetSymbol()));
+            case BinaryNode::Kind::kQuote:
+            case BinaryNode::Kind::kCell: {
+                if (depth_left_ == 0) {
+                    return Fail(
+                        Error{ErrorKind::kLimit, "Input is nested too deeply", node.GetOffset()});
+                }
+                --depth_left_;
+                Ref<Object> result = node.GetKind() == BinaryNode::Kind::kQuote ? LoadQuote(node)
+                                                                               : LoadList(node);
+                ++depth_left_;
+                return result;
+            }
+            case BinaryNode::Kind::kInvalid:
+                break;
+        }
+        return Fail(Malformed(node.GetOffset()));
+    }
+
+private:
+    std::nullptr_t Fail(Error error) {
+        if (!failed_) {
+            failed_ = true;
+            error_ = std::move(error);
+        }
+        return nullptr;
+    }
+
+    Ref<Object> LoadQuote(const BinaryNode& node) {
+        Ref<Quote> quote = MakeRef<Quote>();
+        quote->next_ = Load(node.GetQuoted());
+        if (failed_) {
+            return nullptr;
+        }
+        return quote;
+    }
+
+    Ref<Object> LoadList(BinaryNode node) {
+        Ref<Cell> head = MakeRef<Cell>();
+        Cell* cell = head.Get();
+        while (true) {
+            cell->first_ = Load(node.GetFirst());
+            if (failed_) {
+                return nullptr;
+            }
+            node = node.GetSecond();
+            if (node.GetKind() != BinaryNode::Kind::kCell) {
+                cell->second_ = Load(node);
+                if (failed_) {
+                    return nullptr;
+                }
+                return head;
+            }
+            Ref<Cell> next = MakeRef<Cell>();
+            Cell* next_cell = next.Get();
+            cell->second_ = std::move(next);
+            cell = next_cell;
+        }
+    }
+
+    size_t depth_left_;
+    bool failed_ = false;
+    Error error_;
+};
+
+Expected<Ref<Object>> BinaryImage::Load(size_t index, size_t max_depth) const {
+    Loader loader(max_depth);
+    Ref<Object> tree = loader.Load(GetTree(index));
+    if (loader.Failed()) {
+        return std::move(loader.GetError());
+    }
+    return tree;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+BinaryNode::Kind BinaryNode::GetKind() const {
+    return kind_;
+}
+
+size_t BinaryNode::GetOffset() const {
+    return offset_;
+}
+
+int BinaryNode::GetNumber() const {
+    assert(kind_ == Kind::kNumber);
+    return value_;
+}
+
+bool BinaryNode::GetBool() const {
+    assert(kind_ == Kind::kBool);
+    return value_ != 0;
+}
+
+std::string_view BinaryNode::GetSymbol() const {
+    assert(kind_ == Kind::kSymbol);
+    return image_->GetSymbol(value_);
+}
+
+BinaryNode BinaryNode::GetQuoted() const {
+    assert(kind_ == Kind::kQuote);
+    return image_->Decode(first_);
+}
+
+BinaryNode BinaryNode::GetFirst() const {
+    assert(kind_ == Kind::kCell);
+    return image_->Decode(first_);
+}
+
+BinaryNode BinaryNode::GetSecond() const {
+    assert(kind_ == Kind::kCell);
+    return image_->Decode(second_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+Expected<MappedFile> MappedFile::Open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return Error{ErrorKind::kRuntime, path + ": " + std::strerror(errno)};
+    }
+    MappedFile file;
+    struct stat status;
+    if (::fstat(fd, &status) != 0) {
+        int error = errno;
+        ::close(fd);
+        return Error{ErrorKind::kRuntime, path + ": " + std::strerror(error)};
+    }
+    if (status.st_size > 0) {
+        void* data = ::mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            int error = errno;
+            ::close(fd);
+            return Error{ErrorKind::kRuntime, path + ": " + std::strerror(error)};
+        }
+        file.data_ = data;
+        file.size_ = status.st_size;
+    }
+    ::close(fd);
+    return file;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        if (data_ != nullptr) {
+            ::munmap(data_, size_);
+        }
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        ::munmap(data_, size_);
+    }
+}
+
+std::string_view MappedFile::GetBytes() const {
+    return {static_cast<const char*>(data_), size_};
+}
+
+void MappedFile::Release(size_t size) {
+    static const size_t kPageSize = ::sysconf(_SC_PAGESIZE);
+    size = std::min(size, size_) / kPageSize * kPageSize;
+    if (size > 0) {
+        ::madvise(data_, size, MADV_DONTNEED);
+    }
+}
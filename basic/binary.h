@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "error.h"
+#include "object.h"
+
+// Binary images of S-expressions, to ship parsed data without tokenizing it again on load.
+//
+// An image holds a sequence of trees. Each tree is a preorder stream of tagged nodes; symbol
+// names are stored once in a table and referred to by index. Nothing in an image is an address,
+// so a file can be mapped anywhere and read in place:
+//
+//   header     magic "SCMB", version, tree and symbol counts, section offsets
+//   trees      u64 offset of every tree from the start of the image
+//   symbols    u32 offset in the names section and u32 length of every name
+//   names      symbol names back to back
+//   nodes      the trees, one after another
+//
+// A cell stores the size of its first element in front of it when that element is a list or a
+// quote, so a view reaches both halves of a cell without decoding the first one. Integers are
+// little endian; numbers, symbol indices and sizes are varints.
+//
+// Source offsets are not kept: loaded objects report offset 0.
+
+class BinaryWriter {
+public:
+    // Appends a tree as Read would return it; null stands for the empty list.
+    void Add(const Ref<Object>& tree);
+
+    size_t GetTreeCount() const;
+
+    // The image of the trees added so far.
+    std::string Finish() const;
+
+private:
+    void WriteNode(Object* node);
+    uint32_t GetSymbolIndex(const std::string& name);
+
+    std::string nodes_;
+    std::vector<uint64_t> tree_offsets_;
+    // Offset into names_ and length of every symbol.
+    std::vector<std::pair<uint32_t, uint32_t>> symbols_;
+    std::unordered_map<std::string, uint32_t> symbol_indices_;
+    std::string names_;
+};
+
+class BinaryImage;
+
+// Lazy view of one node of an image, decoded when the view is made: children are only decoded
+// when asked for. A node that does not decode reads as kInvalid, and so does everything below it.
+class BinaryNode {
+public:
+    enum class Kind : uint8_t { kInvalid, kNull, kNumber, kBool, kSymbol, kQuote, kCell };
+
+    Kind GetKind() const;
+
+    // Where the node starts in the image.
+    size_t GetOffset() const;
+
+    // Meaningful for the matching kind only.
+    int GetNumber() const;
+    bool GetBool() const;
+    std::string_view GetSymbol() const;
+    BinaryNode GetQuoted() const;
+    BinaryNode GetFirst() const;
+    BinaryNode GetSecond() const;
+
+private:
+    friend class BinaryImage;
+
+    BinaryNode() = default;
+
+    const BinaryImage* image_ = nullptr;
+    size_t offset_ = 0;
+    // Number, bool or symbol index.
+    int64_t value_ = 0;
+    // Where the quoted datum or the first element starts, and where the second element does.
+    size_t first_ = 0;
+    size_t second_ = 0;
+    Kind kind_ = Kind::kInvalid;
+};
+
+// Read-only view of an image in memory, which must outlive the view and the nodes taken from it.
+class BinaryImage {
+public:
+    // Checks the header and the tables; nodes are checked as they are decoded.
+    static Expected<BinaryImage> Open(std::string_view bytes);
+
+    size_t GetTreeCount() const;
+    BinaryNode GetTree(size_t index) const;
+
+    // Nesting allowed by Load when no max_depth is given. Loading recurses once per level, so
+    // without a bound a malformed image, such as a long run of quotes, could overflow the stack.
+    static constexpr size_t kDefaultMaxDepth = 4096;
+
+    // Builds the objects of a tree on the current heap, the same ones Read builds from its text.
+    // Lists and quotes nested deeper than max_depth, or kDefaultMaxDepth when it is zero, are
+    // rejected.
+    Expected<Ref<Object>> Load(size_t index, size_t max_depth = 0) const;
+
+    std::string_view GetSymbol(size_t index) const;
+    size_t GetSymbolCount() const;
+
+private:
+    friend class BinaryNode;
+    class Loader;
+
+    BinaryImage() = default;
+
+    // Sets *end past the node when it is an atom.
+    BinaryNode Decode(size_t offset, size_t* end = nullptr) const;
+
+    std::string_view bytes_;
+    size_t tree_count_ = 0;
+    size_t trees_offset_ = 0;
+    size_t symbol_count_ = 0;
+    size_t symbols_offset_ = 0;
+    size_t names_offset_ = 0;
+    size_t nodes_offset_ = 0;
+};
+
+// A file mapped read-only into memory.
+class MappedFile {
+public:
+    static Expected<MappedFile> Open(const std::string& path);
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    std::string_view GetBytes() const;
+
+    // Lets the kernel drop the pages of the first size bytes, which are read from the file again
+    // if they are touched. Keeps a sequential scan from holding the whole file in memory.
+    void Release(size_t size);
+
+private:
+    MappedFile() = default;
+
+    void* data_ = nullptr;
+    size_t size_ = 0;
+};
@@ -0,0 +1,113 @@
+#include "counting_new.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// All of the overloads are replaced, so that nothing allocated by one implementation is freed by
+// another, which sanitizers report as a mismatch.
+
+namespace {
+std::atomic<uint64_t> new_count = 0;
+
+void* Allocate(size_t size, size_t alignment) noexcept {
+    new_count.fetch_add(1, std::memory_order_relaxed);
+    size = size == 0 ? 1 : size;
+    if (alignment <= alignof(std::max_align_t)) {
+        return std::malloc(size);
+    }
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+void* AllocateOrThrow(size_t size, size_t alignment) {
+    if (void* ptr = Allocate(size, alignment)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+}  // namespace
+
+uint64_t GetNewCount() {
+    return new_count.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size) {
+    return AllocateOrThrow(size, 0);
+}
+
+void* operator new[](size_t size) {
+    return AllocateOrThrow(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return AllocateOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return AllocateOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return Allocate(size, 0);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return Allocate(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return Allocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return Allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
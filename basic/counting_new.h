@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+// Replaces every form of the global operator new and delete with ones over malloc that count
+// the calls to new. Only executables that measure allocations link counting_new.cpp; the library
+// does not, and whatever else runs in such an executable runs under the replacement too.
+//
+// Counts calls from all threads since the start of the process.
+uint64_t GetNewCount();
@@ -0,0 +1,217 @@
+#include "data_loader.h"
+#include "heap.h"
+#include "parser.h"
+#include "session.h"
+
+#include <bit>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+constexpr size_t kBlockSize = 64;
+
+struct ParenMasks {
+    uint64_t open = 0;
+    uint64_t close = 0;
+};
+
+// Bit i is set when byte i of the block is a paren.
+ParenMasks LoadMasks(const char* block) {
+    ParenMasks masks;
+#if defined(__SSE2__)
+    const __m128i open = _mm_set1_epi8('(');
+    const __m128i close = _mm_set1_epi8(')');
+    for (size_t i = 0; i < kBlockSize; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        masks.open |= static_cast<uint64_t>(
+                           static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, open))))
+                       << i;
+        masks.close |= static_cast<uint64_t>(
+                            static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, close))))
+                        << i;
+    }
+#else
+    for (size_t i = 0; i < kBlockSize; ++i) {
+        masks.open |= static_cast<uint64_t>(block[i] == '(') << i;
+        masks.close |= static_cast<uint64_t>(block[i] == ')') << i;
+    }
+#endif
+    return masks;
+}
+
+// Updates *depth for ch; true when ch closes a list at depth zero.
+bool Step(char ch, int64_t* depth) {
+    if (ch == '(') {
+        ++*depth;
+    } else if (ch == ')') {
+        return --*depth == 0;
+    }
+    return false;
+}
+
+// Returns the offset just past the first paren at or after from that closes a list at depth
+// zero and ends at or after target, or the size of data when there is none. *depth is the
+// depth at from and is updated along the way. Blocks that end before target, or whose closing
+// parens cannot bring the depth down to zero, are settled with two popcounts.
+size_t FindBoundary(std::string_view data, size_t from, size_t target, int64_t* depth) {
+    size_t position = from;
+    for (; position + kBlockSize <= data.size(); position += kBlockSize) {
+        ParenMasks masks = LoadMasks(data.data() + position);
+        if (position + kBlockSize < target || *depth > std::popcount(masks.close)) {
+            *depth += std::popcount(masks.open) - std::popcount(masks.close);
+            continue;
+        }
+        for (uint64_t parens = masks.open | masks.close; parens != 0; parens &= parens - 1) {
+            int bit = std::countr_zero(parens);
+            if (Step(data[position + bit], depth) && position + bit + 1 >= target) {
+                return position + bit + 1;
+            }
+        }
+    }
+    for (; position < data.size(); ++position) {
+        if (Step(data[position], depth) && position + 1 >= target) {
+            return position + 1;
+        }
+    }
+    return data.size();
+}
+
+bool IsSpace(char ch) {
+    return ch == ' ' || ch == '\n' || ch == '\t' || ch == '\r' || ch == '\f' || ch == '\v';
+}
+
+// Cuts text into its top-level datums, quotes included. Unbalanced parens end up in a datum of
+// their own, which the reader then rejects.
+void SplitDatums(std::string_view text, std::vector<std::string_view>* datums) {
+    size_t position = 0;
+    while (position < text.size()) {
+        if (IsSpace(text[position])) {
+            ++position;
+            continue;
+        }
+        size_t start = position;
+        while (position < text.size() && (text[position] == '\'' || IsSpace(text[position]))) {
+            ++position;
+        }
+        if (position < text.size() && text[position] == '(') {
+            int64_t depth = 0;
+            position = FindBoundary(text, position, position, &depth);
+        } else if (position < text.size() && text[position] == ')') {
+            ++position;
+        } else {
+            while (position < text.size() && !IsSpace(text[position]) && text[position] != '(' &&
+                   text[position] != ')' && text[position] != '\'') {
+                ++position;
+            }
+        }
+        datums->push_back(text.substr(start, position - start));
+    }
+}
+}  // namespace
+
+Expected<std::unique_ptr<DataLoader>> DataLoader::Open(const std::string& path,
+                                                        WorkStealingPool* pool,
+                                                        const DataLoaderOptions& options) {
+    auto file = MappedFile::Open(path);
+    if (!file) {
+        return file.GetError();
+    }
+    auto loader = std::make_unique<DataLoader>(file->GetBytes(), pool, options);
+    loader->file_ = std::move(*file);
+    return loader;
+}
+
+DataLoader::DataLoader(std::string_view data, WorkStealingPool* pool,
+                       const DataLoaderOptions& options)
+    : data_(data), pool_(pool), options_(options) {
+}
+
+DataLoader::~DataLoader() {
+    std::unique_lock lock(mutex_);
+    for (const auto& chunk : chunks_) {
+        parsed_.wait(lock, [&chunk] { return chunk->done; });
+    }
+}
+
+// Cuts and submits chunks until the window is full; there is always one chunk in flight
+// unless the data is exhausted. Without a pool, only the chunk about to be consumed is parsed.
+void DataLoader::Fill() {
+    while (scanned_ < data_.size() &&
+           (chunks_.empty() ||
+            (pool_ != nullptr && window_used_ + options_.chunk_bytes <= options_.window_bytes))) {
+        size_t end = FindBoundary(data_, scanned_, scanned_ + options_.chunk_bytes, &depth_);
+        auto chunk = std::make_unique<Chunk>();
+        chunk->offset = scanned_;
+        chunk->text = data_.substr(scanned_, end - scanned_);
+        window_used_ += chunk->text.size();
+        scanned_ = end;
+
+        Chunk* raw = chunk.get();
+        chunks_.push_back(std::move(chunk));
+        if (pool_ != nullptr) {
+            pool_->Submit([this, raw] { Parse(raw); });
+        } else {
+            Parse(raw);
+        }
+    }
+}
+
+void DataLoader::Parse(Chunk* chunk) {
+    Heap::Scope plain_scope(nullptr);
+    std::vector<std::string_view> texts;
+    SplitDatums(chunk->text, &texts);
+
+    std::vector<Ref<Object>> datums;
+    datums.reserve(texts.size());
+    std::optional<Error> error;
+    Session session;
+    for (std::string_view text : texts) {
+        session.Reset(text);
+        auto datum = TryRead(session.GetTokenizer(), options_.max_depth);
+        if (!datum) {
+            error = datum.GetError();
+            error->offset += chunk->offset + (text.data() - chunk->text.data());
+            break;
+        }
+        datums.push_back(std::move(*datum));
+    }
+
+    // Notified under the lock: once done is seen, the destructor may tear the loader down.
+    std::lock_guard lock(mutex_);
+    chunk->datums = std::move(datums);
+    chunk->error = std::move(error);
+    chunk->done = true;
+    parsed_.notify_all();
+}
+
+bool DataLoader::Next(Ref<Object>* datum) {
+    while (!error_) {
+        Fill();
+        if (chunks_.empty()) {
+            return false;
+        }
+
+        Chunk& chunk = *chunks_.front();
+        {
+            std::unique_lock lock(mutex_);
+            parsed_.wait(lock, [&chunk] { return chunk.done; });
+        }
+        if (chunk.consumed < chunk.datums.size()) {
+            *datum = std::move(chunk.datums[chunk.consumed++]);
+            return true;
+        }
+        if (chunk.error) {
+            error_ = std::move(chunk.error);
+            return false;
+        }
+        window_used_ -= chunk.text.size();
+        chunks_.pop_front();
+    }
+    return false;
+}
+
+const Error* DataLoader::GetError() const {
+    return error_ ? &*error_ : nullptr;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "binary.h"
+#include "error.h"
+#include "object.h"
+#include "thread_pool.h"
+
+struct DataLoaderOptions {
+    // Source bytes handed to one parsing task. Chunks end after a top-level list, so a chunk can
+    // be longer by up to one datum.
+    size_t chunk_bytes = 64 << 10;
+    // Source bytes of chunks being parsed or waiting to be consumed. The objects parsed from
+    // them take about ten times as much, so this is what bounds the memory of a load. It should
+    // hold a few chunks per thread of the pool.
+    size_t window_bytes = 1 << 20;
+    // Applies to every datum, see TryRead.
+    size_t max_depth = 0;
+};
+
+// Reads a file of top-level datums, parsing chunks of it on a pool while the caller consumes
+// the datums of earlier chunks in file order.
+//
+// The file is mapped, and one thread scans it for chunk boundaries by tracking paren depth a
+// block at a time; quotes only prefix a datum and do not affect the depth. Chunks are cut right
+// after a list closes at depth zero, so a file of bare atoms is parsed as one chunk.
+//
+// Datums are plain reference counted objects that belong to the caller once returned. A loader
+// is used from one thread outside the pool; the pool can be shared with other work. Without a
+// pool, chunks are parsed on the calling thread as they are needed.
+class DataLoader {
+public:
+    static Expected<std::unique_ptr<DataLoader>> Open(const std::string& path,
+                                                      WorkStealingPool* pool,
+                                                      const DataLoaderOptions& options = {});
+
+    // Parses data held in memory instead, which must outlive the loader.
+    DataLoader(std::string_view data, WorkStealingPool* pool,
+               const DataLoaderOptions& options = {});
+
+    // Waits for the chunks still being parsed.
+    ~DataLoader();
+
+    DataLoader(const DataLoader&) = delete;
+    DataLoader& operator=(const DataLoader&) = delete;
+
+    // Moves the next datum into *datum. Returns false at the end of the data and on the first
+    // datum that does not parse, see GetError.
+    bool Next(Ref<Object>* datum);
+
+    // The error that stopped the load, with its offset in the data.
+    const Error* GetError() const;
+
+private:
+    struct Chunk {
+        size_t offset = 0;
+        std::string_view text;
+        std::vector<Ref<Object>> datums;
+        size_t consumed = 0;
+        std::optional<Error> error;
+        bool done = false;
+    };
+
+    void Fill();
+    void Parse(Chunk* chunk);
+
+    std::optional<MappedFile> file_;
+    std::string_view data_;
+    WorkStealingPool* pool_;
+    DataLoaderOptions options_;
+
+    // Scan state: where the next chunk starts and the paren depth there.
+    size_t scanned_ = 0;
+    int64_t depth_ = 0;
+
+    std::deque<std::unique_ptr<Chunk>> chunks_;
+    size_t window_used_ = 0;
+    std::optional<Error> error_;
+
+    std::mutex mutex_;
+    std::condition_variable parsed_;
+};
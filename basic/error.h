@@ -1,6 +1,11 @@
 #pragma once
 
+#include <cassert>
+#include <cstddef>
 #include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
 
 struct SyntaxError : public std::runtime_error {
     using std::runtime_error::runtime_error;
@@ -13,3 +18,86 @@ struct RuntimeError : public std::runtime_error {
 struct NameError : public std::runtime_error {
     using std::runtime_error::runtime_error;
 };
+
+// A run exceeded its RunLimits or was cancelled.
+struct LimitError : public RuntimeError {
+    using RuntimeError::RuntimeError;
+};
+
+enum class ErrorKind { kSyntax, kRuntime, kName, kLimit };
+
+// Failure reported by the non-throwing entry points. offset points into the source: at the
+// token the reader stopped on, or at the first element of the failed call.
+struct Error {
+    ErrorKind kind;
+    std::string message;
+    size_t offset = 0;
+};
+
+// Raises the exception the throwing API uses for error.
+[[noreturn]] inline void Throw(const Error& error) {
+    switch (error.kind) {
+        case ErrorKind::kSyntax:
+            throw SyntaxError(error.message);
+        case ErrorKind::kName:
+            throw NameError(error.message);
+        case ErrorKind::kLimit:
+            throw LimitError(error.message);
+        case ErrorKind::kRuntime:
+            break;
+    }
+    throw RuntimeError(error.message);
+}
+
+// Holds either a value or an Error, like C++23 std::expected.
+template <class T>
+class Expected {
+public:
+    Expected(T value) : storage_(std::in_place_index<0>, std::move(value)) {
+    }
+
+    Expected(Error error) : storage_(std::in_place_index<1>, std::move(error)) {
+    }
+
+    bool HasValue() const {
+        return storage_.index() == 0;
+    }
+
+    explicit operator bool() const {
+        return HasValue();
+    }
+
+    T& operator*() {
+        assert(HasValue());
+        return *std::get_if<0>(&storage_);
+    }
+
+    const T& operator*() const {
+        assert(HasValue());
+        return *std::get_if<0>(&storage_);
+    }
+
+    T* operator->() {
+        return &**this;
+    }
+
+    const T* operator->() const {
+        return &**this;
+    }
+
+    const Error& GetError() const {
+        assert(!HasValue());
+        return *std::get_if<1>(&storage_);
+    }
+
+    // Returns the value or throws the matching exception.
+    T& ValueOrThrow() {
+        if (!HasValue()) {
+            Throw(GetError());
+        }
+        return **this;
+    }
+
+private:
+    std::variant<T, Error> storage_;
+};
@@ -0,0 +1,20 @@
+// libFuzzer entry point for the interpreter. Runs are bounded in steps, memory and depth, so
+// that libFuzzer's -timeout and -rss_limit_mb flag inputs whose cost escapes the limits.
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "../scheme.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static Interpreter* interpreter = [] {
+        auto* interpreter = new Interpreter;
+        interpreter->SetLimits(
+            {.max_steps = 1'000'000, .max_live_bytes = 64 << 20, .max_depth = 1000});
+        return interpreter;
+    }();
+
+    interpreter->TryRun(std::string_view(reinterpret_cast<const char*>(data), size));
+    return 0;
+}
@@ -0,0 +1,18 @@
+// libFuzzer entry point for the reader. Nesting is bounded so that deep inputs are rejected
+// instead of overflowing the stack; anything but a returned error is a bug.
+
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include "../parser.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static constexpr size_t kMaxDepth = 1000;
+
+    std::istringstream input(std::string(reinterpret_cast<const char*>(data), size));
+    Tokenizer tokenizer(&input);
+    TryRead(&tokenizer, kMaxDepth);
+    return 0;
+}
@@ -0,0 +1,290 @@
+// Hunts for inputs whose cost grows faster than their size. For every shape of GrammarFuzzer and
+// a number of seeds, runs the input at doubling sizes and measures the calls evaluated, the peak
+// live bytes, the time and the nesting depth of each run. When a cost grows faster than
+// size^--exponent over two doublings in a row, the input is shrunk to the smallest size that
+// still shows it and saved to DIR/slow-<shape>-<seed>-<metric>.scm.
+//
+//   scheme_slow_fuzz [--seeds N] [--max-size N] [--exponent X] [--max-depth N]
+//                    [--timeout SECONDS] [--out DIR] [--verbose]
+//
+// Runs are bounded by the interpreter's limits, nesting by --max-depth so that deep inputs fail
+// instead of overflowing the stack. A run that takes longer than --timeout is saved to
+// DIR/hang-<shape>-<seed>.scm before the process aborts. The exit status is 1 if anything was
+// saved.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fuzzer.h>
+
+#include "../scheme.h"
+
+namespace {
+
+using Shape = GrammarFuzzer::Shape;
+
+struct Options {
+    uint64_t seeds = 8;
+    size_t max_size = 1 << 14;
+    double exponent = 1.5;
+    size_t max_depth = 4096;
+    double timeout = 10;
+    std::string out_dir = ".";
+    bool verbose = false;
+};
+
+enum class Metric { kSteps, kMemory, kTime };
+
+constexpr Metric kMetrics[] = {Metric::kSteps, Metric::kMemory, Metric::kTime};
+constexpr const char* kMetricNames[] = {"steps", "memory", "time"};
+// Costs below these are too small to tell a growth rate from noise.
+constexpr double kMetricFloors[] = {1000, 64 << 10, 1e6};
+
+struct Cost {
+    size_t size = 0;
+    size_t input_bytes = 0;
+    uint64_t steps = 0;
+    int64_t peak_bytes = 0;
+    std::chrono::nanoseconds time{0};
+    size_t depth = 0;
+    bool limited = false;
+
+    double Get(Metric metric) const {
+        switch (metric) {
+            case Metric::kSteps:
+                return steps;
+            case Metric::kMemory:
+                return peak_bytes;
+            case Metric::kTime:
+                return time.count();
+        }
+        return 0;
+    }
+};
+
+size_t GetNestingDepth(std::string_view input) {
+    size_t depth = 0;
+    size_t max_depth = 0;
+    for (char c : input) {
+        if (c == '(') {
+            max_depth = std::max(max_depth, ++depth);
+        } else if (c == ')' && depth > 0) {
+            --depth;
+        }
+    }
+    return max_depth;
+}
+
+// Aborts the process when a run takes too long, leaving the input behind.
+class Watchdog {
+public:
+    Watchdog(const Options& options)
+        : options_(options), thread_([this](std::stop_token stop) { Watch(stop); }) {
+    }
+
+    void Start(const std::string* input, std::string name) {
+        std::lock_guard lock(mutex_);
+        input_ = input;
+        name_ = std::move(name);
+        start_ = std::chrono::steady_clock::now();
+    }
+
+    void Stop() {
+        std::lock_guard lock(mutex_);
+        input_ = nullptr;
+    }
+
+private:
+    void Watch(std::stop_token stop) {
+        std::chrono::duration<double> timeout(options_.timeout);
+        while (!stop.stop_requested()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            std::lock_guard lock(mutex_);
+            if (input_ != nullptr && std::chrono::steady_clock::now() - start_ > timeout) {
+                std::string path = options_.out_dir + "/hang-" + name_ + ".scm";
+                std::ofstream(path) << *input_;
+                std::cerr << "scheme_slow_fuzz: run timed out, input saved to " << path << '\n';
+                std::abort();
+            }
+        }
+    }
+
+    const Options& options_;
+    std::mutex mutex_;
+    const std::string* input_ = nullptr;
+    std::string name_;
+    std::chrono::steady_clock::time_point start_;
+    std::jthread thread_;
+};
+
+class Hunter {
+public:
+    explicit Hunter(const Options& options) : options_(options), watchdog_(options) {
+        interpreter_.SetLimits({.max_steps = 1'000'000'000,
+                                .max_live_bytes = size_t{1} << 30,
+                                .max_depth = options.max_depth});
+    }
+
+    // Returns the number of inputs saved.
+    size_t Hunt(Shape shape, uint64_t seed) {
+        std::vector<Cost> costs;
+        for (size_t size = 16; size <= options_.max_size; size *= 2) {
+            costs.push_back(Measure(shape, seed, size));
+            if (costs.back().limited || costs.back().time > std::chrono::seconds(1)) {
+                break;
+            }
+        }
+        if (options_.verbose) {
+            for (const Cost& cost : costs) {
+                std::printf("%-14s seed %-3llu size %-6zu %8zu B %12llu steps %10lld B peak "
+                            "%10.1f us depth %zu%s\n",
+                            GrammarFuzzer::GetShapeName(shape),
+                            static_cast<unsigned long long>(seed), cost.size, cost.input_bytes,
+                            static_cast<unsigned long long>(cost.steps),
+                            static_cast<long long>(cost.peak_bytes), cost.time.count() / 1e3,
+                            cost.depth, cost.limited ? " (limited)" : "");
+            }
+        }
+
+        size_t saved = 0;
+        for (Metric metric : kMetrics) {
+            for (size_t i = 0; i + 2 < costs.size(); ++i) {
+                if (GetExponent(costs[i], costs[i + 1], metric) > options_.exponent &&
+                    GetExponent(costs[i + 1], costs[i + 2], metric) > options_.exponent) {
+                    saved += Save(shape, seed, metric, costs[i].size);
+                    break;
+                }
+            }
+        }
+        return saved;
+    }
+
+private:
+    Cost Measure(Shape shape, uint64_t seed, size_t size) {
+        std::string input = fuzzer_.Generate(shape, seed, size);
+        Cost cost{.size = size, .input_bytes = input.size(), .depth = GetNestingDepth(input)};
+        cost.time = std::chrono::nanoseconds::max();
+        // The fastest of a few runs, to keep scheduling noise out of the growth rate.
+        std::chrono::nanoseconds total{0};
+        for (int run = 0; run < 3 || (run < 10 && total < std::chrono::milliseconds(5)); ++run) {
+            watchdog_.Start(&input, std::string(GrammarFuzzer::GetShapeName(shape)) + '-' +
+                                        std::to_string(seed));
+            auto start = std::chrono::steady_clock::now();
+            auto result = interpreter_.TryRun(input);
+            std::chrono::nanoseconds time = std::chrono::steady_clock::now() - start;
+            watchdog_.Stop();
+
+            total += time;
+            cost.time = std::min(cost.time, time);
+            cost.steps = interpreter_.GetLastRunSteps();
+            cost.peak_bytes = interpreter_.GetLastRunAllocationStats().total.peak_bytes;
+            cost.limited = !result && result.GetError().kind == ErrorKind::kLimit;
+        }
+        return cost;
+    }
+
+    double GetExponent(const Cost& small, const Cost& large, Metric metric) const {
+        double before = small.Get(metric);
+        double after = large.Get(metric);
+        if (large.limited || before <= 0 || after < kMetricFloors[static_cast<int>(metric)] ||
+            large.input_bytes <= small.input_bytes) {
+            return 0;
+        }
+        return std::log(after / before) /
+               std::log(static_cast<double>(large.input_bytes) / small.input_bytes);
+    }
+
+    // Shrinks the size to the smallest whose doubling still grows faster than the exponent, and
+    // writes the input of that size out. Returns false when the growth does not show again,
+    // which happens to timings.
+    bool Save(Shape shape, uint64_t seed, Metric metric, size_t size) {
+        size_t low = size / 2;
+        size_t high = size;
+        while (low + 1 < high) {
+            size_t middle = (low + high) / 2;
+            Cost small = Measure(shape, seed, middle);
+            Cost large = Measure(shape, seed, middle * 2);
+            if (GetExponent(small, large, metric) > options_.exponent) {
+                high = middle;
+            } else {
+                low = middle;
+            }
+        }
+        Cost small = Measure(shape, seed, high);
+        Cost large = Measure(shape, seed, high * 2);
+        double exponent = GetExponent(small, large, metric);
+        if (exponent <= options_.exponent) {
+            return false;
+        }
+
+        const char* name = kMetricNames[static_cast<int>(metric)];
+        std::string path = options_.out_dir + "/slow-" + GrammarFuzzer::GetShapeName(shape) +
+                           '-' + std::to_string(seed) + '-' + name + ".scm";
+        std::ofstream(path) << fuzzer_.Generate(shape, seed, high);
+        std::printf("%s: %s grows as size^%.2f from %zu to %zu bytes (%.0f to %.0f)\n",
+                    path.c_str(), name, exponent,
+                    small.input_bytes, large.input_bytes, small.Get(metric), large.Get(metric));
+        return true;
+    }
+
+    const Options& options_;
+    GrammarFuzzer fuzzer_;
+    Interpreter interpreter_;
+    Watchdog watchdog_;
+};
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--verbose") {
+            options->verbose = true;
+        } else if (arg == "--seeds" && has_value) {
+            options->seeds = std::stoull(argv[++i]);
+        } else if (arg == "--max-size" && has_value) {
+            options->max_size = std::stoul(argv[++i]);
+        } else if (arg == "--exponent" && has_value) {
+            options->exponent = std::stod(argv[++i]);
+        } else if (arg == "--max-depth" && has_value) {
+            options->max_depth = std::stoul(argv[++i]);
+        } else if (arg == "--timeout" && has_value) {
+            options->timeout = std::stod(argv[++i]);
+        } else if (arg == "--out" && has_value) {
+            options->out_dir = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, &options)) {
+        std::cerr << "usage: scheme_slow_fuzz [--seeds N] [--max-size N] [--exponent X] "
+                     "[--max-depth N] [--timeout SECONDS] [--out DIR] [--verbose]\n";
+        return 2;
+    }
+
+    Hunter hunter(options);
+    size_t saved = 0;
+    for (size_t shape = 0; shape < GrammarFuzzer::kShapeCount; ++shape) {
+        for (uint64_t seed = 0; seed < options.seeds; ++seed) {
+            saved += hunter.Hunt(static_cast<Shape>(shape), seed);
+        }
+    }
+    std::printf("%zu slow inputs saved\n", saved);
+    return saved == 0 ? 0 : 1;
+}
@@ -0,0 +1,26 @@
+// libFuzzer entry point for the tokenizer. The first byte picks how often the reader's
+// lookahead for a dot runs between tokens, as it does inside lists.
+
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include "../tokenizer.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    uint8_t lookahead = data[0];
+    std::istringstream input(std::string(reinterpret_cast<const char*>(data) + 1, size - 1));
+    Tokenizer tokenizer(&input);
+    for (size_t i = 0; !tokenizer.IsEnd() && tokenizer.GetError() == nullptr; ++i) {
+        tokenizer.TryGetToken();
+        if ((lookahead >> (i % 8)) & 1) {
+            tokenizer.NextIsDot();
+        }
+        tokenizer.Next();
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+#include "hash_cons.h"
+#include "heap.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+
+namespace {
+constexpr size_t kMinSweepAt = 1024;
+
+size_t Mix(size_t seed, size_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+}  // namespace
+
+size_t HashConsTable::KeyHash::operator()(const Key& key) const {
+    size_t hash = Mix(key.kind, static_cast<size_t>(key.value));
+    hash = Mix(hash, std::hash<std::string_view>{}(key.name));
+    hash = Mix(hash, std::hash<const Object*>{}(key.first));
+    return Mix(hash, std::hash<const Object*>{}(key.second));
+}
+
+size_t HashConsTable::KeyHash::operator()(const Ref<Object>& node) const {
+    return (*this)(GetKey(node.Get()));
+}
+
+bool HashConsTable::KeyEqual::operator()(const Key& key, const Ref<Object>& node) const {
+    Key other = GetKey(node.Get());
+    return key.kind == other.kind && key.value == other.value && key.name == other.name &&
+           key.first == other.first && key.second == other.second;
+}
+
+bool HashConsTable::KeyEqual::operator()(const Ref<Object>& node, const Key& key) const {
+    return (*this)(key, node);
+}
+
+bool HashConsTable::KeyEqual::operator()(const Ref<Object>& lhs, const Ref<Object>& rhs) const {
+    return (*this)(GetKey(lhs.Get()), rhs);
+}
+
+HashConsTable::Key HashConsTable::GetKey(const Object* node) {
+    Object* object = const_cast<Object*>(node);
+    if (const Number* number = As<Number>(object)) {
+        return {.kind = Key::kNumber, .value = number->GetValue()};
+    } else if (const Bool* boolean = As<Bool>(object)) {
+        return {.kind = Key::kBool, .value = boolean->GetValue()};
+    } else if (const Symbol* symbol = As<Symbol>(object)) {
+        return {.kind = Key::kSymbol, .name = symbol->GetName()};
+    } else if (const Quote* quote = As<Quote>(object)) {
+        return {.kind = Key::kQuote, .first = quote->next_.Get()};
+    }
+    const Cell* cell = As<Cell>(object);
+    return {.kind = Key::kCell, .first = cell->GetFirst().Get(), .second = cell->GetSecond().Get()};
+}
+
+Ref<Object> HashConsTable::Intern(const Ref<Object>& datum) {
+    if (datum == nullptr || datum->IsHashConsed()) {
+        return datum;
+    }
+
+    // Canonical objects outlive the run that read them, so they never live on a collected heap.
+    Heap::Scope plain_scope(nullptr);
+    if (Is<Cell>(datum)) {
+        return InternList(datum);
+    }
+    if (Quote* quote = As<Quote>(datum)) {
+        Ref<Object> next = Intern(quote->next_);
+        return InternNode(datum.Get(), {.kind = Key::kQuote, .first = next.Get()});
+    }
+    return InternNode(datum.Get(), GetKey(datum.Get()));
+}
+
+// Interns the spine from its end, so a long list does not recurse once per element.
+Ref<Object> HashConsTable::InternList(const Ref<Object>& list) {
+    size_t start = spine_.size();
+    Object* current = list.Get();
+    while (Cell* cell = As<Cell>(current)) {
+        if (cell->IsHashConsed()) {
+            break;
+        }
+        spine_.push_back(cell);
+        current = cell->GetSecond().Get();
+    }
+
+    Ref<Object> tail = Intern(Ref<Object>(current));
+    while (spine_.size() > start) {
+        Cell* cell = spine_.back();
+        spine_.pop_back();
+        Ref<Object> first = Intern(cell->GetFirst());
+        tail = InternNode(cell, {.kind = Key::kCell, .first = first.Get(), .second = tail.Get()});
+    }
+    return tail;
+}
+
+Ref<Object> HashConsTable::InternNode(const Object* original, const Key& key) {
+    if (auto found = nodes_.find(key); found != nodes_.end()) {
+        ++hits_;
+        return *found;
+    }
+    ++misses_;
+
+    if (nodes_.size() >= sweep_at_) {
+        Sweep();
+    }
+
+    Ref<Object> node;
+    switch (key.kind) {
+        case Key::kNumber:
+            node = MakeRef<Number>(key.value);
+            break;
+        case Key::kBool:
+            node = MakeRef<Bool>(key.value != 0);
+            break;
+        case Key::kSymbol:
+            node = MakeRef<Symbol>(std::string(key.name));
+            break;
+        case Key::kQuote: {
+            Ref<Quote> quote = MakeRef<Quote>();
+            quote->next_ = Ref<Object>(const_cast<Object*>(key.first));
+            node = std::move(quote);
+            break;
+        }
+        case Key::kCell: {
+            Ref<Cell> cell = MakeRef<Cell>();
+            cell->first_ = Ref<Object>(const_cast<Object*>(key.first));
+            cell->second_ = Ref<Object>(const_cast<Object*>(key.second));
+            node = std::move(cell);
+            break;
+        }
+    }
+    node->SetSourceOffset(original->GetSourceOffset());
+    // The children are canonical, hence shared already.
+    node->flags_ |= Object::kShared | Object::kHashConsed;
+
+    order_.push_back(node.Get());
+    nodes_.insert(node);
+    return node;
+}
+
+// Parents come after their children in order_, so walking it backwards frees a whole dead tree
+// in one pass: by the time a child is looked at, its dead parents have let go of it.
+void HashConsTable::Sweep() {
+    size_t kept = order_.size();
+    for (size_t i = order_.size(); i-- > 0;) {
+        Object* node = order_[i];
+        if (std::atomic_ref<uint32_t>(node->ref_count_).load(std::memory_order_acquire) == 1) {
+            nodes_.erase(nodes_.find(GetKey(node)));
+            ++swept_;
+        } else {
+            order_[--kept] = node;
+        }
+    }
+    order_.erase(order_.begin(), order_.begin() + kept);
+    sweep_at_ = std::max(kMinSweepAt, 2 * nodes_.size());
+}
+
+HashConsStats HashConsTable::GetStats() const {
+    return {nodes_.size(), hits_, misses_, swept_};
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "object.h"
+
+struct HashConsStats {
+    size_t entries = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t swept = 0;
+};
+
+// Canonical copies of quoted data. Interning a datum returns a structurally equal tree in which
+// every subtree is the one object the table holds for that structure, so repeated rows and
+// symbols are stored once and two values interned by the same table are structurally equal
+// exactly when they are the same object.
+//
+// Canonical objects are Share()d and never mutated. The table only keeps them as long as
+// something else does: entries that nothing else references are swept as the table grows. A
+// table belongs to one thread, the objects it hands out can go anywhere.
+class HashConsTable {
+public:
+    HashConsTable() = default;
+
+    HashConsTable(const HashConsTable&) = delete;
+    HashConsTable& operator=(const HashConsTable&) = delete;
+
+    Ref<Object> Intern(const Ref<Object>& datum);
+
+    // Drops the entries that only the table references.
+    void Sweep();
+
+    HashConsStats GetStats() const;
+
+private:
+    // What identifies a node once its children are canonical.
+    struct Key {
+        enum Kind : uint8_t { kNumber, kBool, kSymbol, kQuote, kCell } kind = kNumber;
+        int value = 0;
+        std::string_view name = {};
+        const Object* first = nullptr;
+        const Object* second = nullptr;
+    };
+
+    struct KeyHash {
+        using is_transparent = void;
+        size_t operator()(const Key& key) const;
+        size_t operator()(const Ref<Object>& node) const;
+    };
+
+    struct KeyEqual {
+        using is_transparent = void;
+        bool operator()(const Key& key, const Ref<Object>& node) const;
+        bool operator()(const Ref<Object>& node, const Key& key) const;
+        bool operator()(const Ref<Object>& lhs, const Ref<Object>& rhs) const;
+    };
+
+    static Key GetKey(const Object* node);
+    Ref<Object> InternNode(const Object* original, const Key& key);
+    Ref<Object> InternList(const Ref<Object>& list);
+
+    std::unordered_set<Ref<Object>, KeyHash, KeyEqual> nodes_;
+    // Nodes in the order they were interned, children before their parents.
+    std::vector<Object*> order_;
+    std::vector<Cell*> spine_;
+    size_t sweep_at_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t swept_ = 0;
+};
@@ -0,0 +1,512 @@
+#include "heap.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace {
+thread_local Heap* current_heap = nullptr;
+
+constexpr size_t kAlignment = alignof(std::max_align_t);
+
+size_t AlignUp(size_t size) {
+    return (size + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+constexpr size_t kGranularity = 8;
+constexpr size_t kClassCount = 8;
+constexpr size_t kMaxCached = 1 << 14;
+constexpr size_t kMaxDepotBatches = 64;
+
+// Full free lists that threads handed over, so that blocks freed on one thread are reused by
+// another: a loader allocates on its workers and the consumer frees, the Reclaimer frees on its
+// own thread. Lists move as a whole, one lock per kMaxCached blocks; beyond kMaxDepotBatches
+// lists per size class, blocks go back to the global allocator.
+class BlockDepot {
+public:
+    struct Batch {
+        FreeBlock* head = nullptr;
+        size_t count = 0;
+    };
+
+    // False when the depot is full and the caller keeps the list.
+    bool Put(size_t size_class, Batch batch) {
+        std::lock_guard lock(mutex_);
+        auto& batches = batches_[size_class];
+        if (batches.size() >= kMaxDepotBatches) {
+            return false;
+        }
+        batches.push_back(batch);
+        return true;
+    }
+
+    Batch Take(size_t size_class) {
+        std::lock_guard lock(mutex_);
+        auto& batches = batches_[size_class];
+        if (batches.empty()) {
+            return {};
+        }
+        Batch batch = batches.back();
+        batches.pop_back();
+        return batch;
+    }
+
+private:
+    std::mutex mutex_;
+    std::array<std::vector<Batch>, kClassCount> batches_;
+};
+
+// Never destroyed: threads may still free blocks while statics are torn down.
+BlockDepot& GetBlockDepot() {
+    static BlockDepot* depot = new BlockDepot();
+    return *depot;
+}
+
+// Per-thread free lists of small blocks. Reference counted objects are recycled through them, so
+// steady-state evaluation does not go to the global allocator. A full list goes to the depot;
+// an empty one is refilled from it before falling back to the global allocator.
+class ObjectPool {
+public:
+    void* Allocate(size_t size) {
+        size_t size_class = SizeClass(size);
+        if (size_class >= kClassCount) {
+            return ::operator new(size);
+        }
+        if (free_lists_[size_class] == nullptr) {
+            BlockDepot::Batch batch = GetBlockDepot().Take(size_class);
+            free_lists_[size_class] = batch.head;
+            cached_[size_class] = batch.count;
+        }
+        if (FreeBlock* block = free_lists_[size_class]) {
+            free_lists_[size_class] = block->next;
+            --cached_[size_class];
+            return block;
+        }
+        return ::operator new(ClassSize(size_class));
+    }
+
+    void Deallocate(void* ptr, size_t size) {
+        size_t size_class = SizeClass(size);
+        if (enabled_ && size_class < kClassCount) {
+            if (cached_[size_class] >= kMaxCached &&
+                GetBlockDepot().Put(size_class, {free_lists_[size_class], cached_[size_class]})) {
+                free_lists_[size_class] = nullptr;
+                cached_[size_class] = 0;
+            }
+            if (cached_[size_class] < kMaxCached) {
+                auto* block = static_cast<FreeBlock*>(ptr);
+                block->next = free_lists_[size_class];
+                free_lists_[size_class] = block;
+                ++cached_[size_class];
+                return;
+            }
+        }
+        ::operator delete(ptr);
+    }
+
+    // Called on thread exit, hands the lists over to other threads; objects destroyed after that
+    // go straight to the global allocator.
+    void Drain() {
+        enabled_ = false;
+        for (size_t size_class = 0; size_class < kClassCount; ++size_class) {
+            FreeBlock*& list = free_lists_[size_class];
+            if (list != nullptr && GetBlockDepot().Put(size_class, {list, cached_[size_class]})) {
+                list = nullptr;
+            }
+            while (list != nullptr) {
+                ::operator delete(std::exchange(list, list->next));
+            }
+        }
+        cached_.fill(0);
+    }
+
+private:
+    static size_t SizeClass(size_t size) {
+        return (size + kGranularity - 1) / kGranularity - 1;
+    }
+
+    static size_t ClassSize(size_t size_class) {
+        return (size_class + 1) * kGranularity;
+    }
+
+    std::array<FreeBlock*, kClassCount> free_lists_{};
+    std::array<size_t, kClassCount> cached_{};
+    bool enabled_ = true;
+};
+
+// The pool itself is trivially destructible, so it stays usable while other thread-locals are
+// torn down; the guard returns its blocks when the thread exits.
+thread_local ObjectPool object_pool;
+
+struct ObjectPoolGuard {
+    ~ObjectPoolGuard() {
+        object_pool.Drain();
+    }
+};
+thread_local ObjectPoolGuard object_pool_guard;
+
+// Unlinks references to collected objects so that destructors of garbage never touch other
+// garbage, which may already be destroyed. References to plain objects are kept and released by
+// the destructor as usual.
+class DetachingVisitor : public ObjectVisitor {
+public:
+    void Visit(Ref<Object>& slot) override {
+        if (slot != nullptr && slot->IsGcManaged()) {
+            slot.Detach();
+        }
+    }
+};
+}  // namespace
+
+struct alignas(kAlignment) Heap::Header {
+    Object* forward = nullptr;
+    uint32_t size = 0;
+    uint8_t age = 0;
+    bool old = false;
+    bool marked = false;
+};
+
+Object::Object() : flags_(current_heap != nullptr ? kGcManaged : 0), source_offset_(0) {
+}
+
+Object::Object(const Object& other) : Object() {
+    source_offset_ = other.source_offset_;
+}
+
+void* Object::Allocate(size_t size, ObjectType type) {
+    allocated_object_bytes += size;
+    CountAllocation(type, size);
+    if (current_heap != nullptr) {
+        return current_heap->Allocate(size);
+    }
+    // The pool may take blocks from the depot, which have to go back when the thread exits.
+    (void)object_pool_guard;
+    return object_pool.Allocate(size);
+}
+
+void Object::Deallocate(void* ptr, size_t size, ObjectType type) {
+    CountRelease(type, size);
+    // Collected objects are never deleted, this only happens when a constructor throws.
+    if (current_heap != nullptr && current_heap->Owns(ptr)) {
+        return;
+    }
+    (void)object_pool_guard;
+    object_pool.Deallocate(ptr, size);
+}
+
+Heap::Heap(const GcOptions& options)
+    : options_(options), old_generation_limit_(options.old_generation_bytes) {
+}
+
+Heap::~Heap() {
+    ReleaseChunks(&nursery_, false);
+
+    std::vector<Object*> old_objects;
+    for (Header* header : old_generation_) {
+        old_objects.push_back(ObjectOf(header));
+    }
+    Destroy(old_objects);
+    for (Header* header : old_generation_) {
+        ::operator delete(header);
+    }
+}
+
+Heap::Header* Heap::HeaderOf(Object* object) {
+    return reinterpret_cast<Header*>(reinterpret_cast<char*>(object) - sizeof(Header));
+}
+
+Object* Heap::ObjectOf(Header* header) {
+    return reinterpret_cast<Object*>(reinterpret_cast<char*>(header) + sizeof(Header));
+}
+
+void* Heap::Allocate(size_t size) {
+    return AllocateYoung(size);
+}
+
+void* Heap::AllocateYoung(size_t size) {
+    size_t total = sizeof(Header) + AlignUp(size);
+    if (nursery_.empty() || nursery_.back().used + total > nursery_.back().capacity) {
+        if (!spare_chunks_.empty() && spare_chunks_.back().capacity >= total) {
+            nursery_.push_back(std::move(spare_chunks_.back()));
+            spare_chunks_.pop_back();
+        } else {
+            size_t capacity = std::max(options_.nursery_bytes, total);
+            nursery_.push_back({std::make_unique<char[]>(capacity), capacity, 0});
+        }
+    }
+
+    Chunk& chunk = nursery_.back();
+    char* storage = chunk.data.get() + chunk.used;
+    chunk.used += total;
+    nursery_used_ += total;
+
+    Header* header = ::new (storage) Header;
+    header->size = total;
+    return ObjectOf(header);
+}
+
+void* Heap::AllocateOld(size_t size) {
+    size_t total = sizeof(Header) + AlignUp(size);
+    Header* header = ::new (::operator new(total)) Header;
+    header->size = total;
+    header->old = true;
+    old_generation_.push_back(header);
+    old_generation_used_ += total;
+    return ObjectOf(header);
+}
+
+bool Heap::Owns(const void* ptr) const {
+    for (const Chunk& chunk : nursery_) {
+        if (ptr >= chunk.data.get() && ptr < chunk.data.get() + chunk.used) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Heap::AddRoot(Ref<Object>* root) {
+    roots_.push_back(root);
+}
+
+void Heap::RemoveRoot(Ref<Object>* root) {
+    auto it = std::find(roots_.rbegin(), roots_.rend(), root);
+    assert(it != roots_.rend());
+    roots_.erase(std::next(it).base());
+}
+
+void Heap::Safepoint() {
+    if (nursery_used_ < options_.nursery_bytes) {
+        return;
+    }
+
+    CollectMinor();
+    if (old_generation_used_ > old_generation_limit_) {
+        MarkSweep();
+        old_generation_limit_ = std::max(options_.old_generation_bytes, 2 * old_generation_used_);
+    }
+}
+
+void Heap::Evacuate(Ref<Object>& slot, bool promote) {
+    Object* object = slot.Get();
+    if (object == nullptr || !object->IsGcManaged()) {
+        return;
+    }
+
+    Header* header = HeaderOf(object);
+    if (header->old) {
+        return;
+    }
+
+    if (header->forward == nullptr) {
+        size_t size = header->size - sizeof(Header);
+        bool to_old = promote || header->age + 1u >= options_.promotion_age;
+        void* storage = to_old ? AllocateOld(size) : AllocateYoung(size);
+        if (to_old) {
+            stats_.bytes_promoted += header->size;
+        }
+
+        Object* copy = object->Relocate(storage);
+        copy->ref_count_ = 0;
+        copy->flags_ = Object::kGcManaged;
+        HeaderOf(copy)->age = header->age + 1;
+
+        header->forward = copy;
+        worklist_.push_back(copy);
+    }
+
+    slot.Detach();
+    slot = Ref<Object>(header->forward);
+}
+
+void Heap::CollectMinor() {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<Chunk> from_space = std::move(nursery_);
+    nursery_.clear();
+    nursery_used_ = 0;
+
+    class EvacuatingVisitor : public ObjectVisitor {
+    public:
+        EvacuatingVisitor(Heap* heap, bool promote) : heap_(heap), promote_(promote) {
+        }
+
+        void Visit(Ref<Object>& slot) override {
+            heap_->Evacuate(slot, promote_);
+        }
+
+    private:
+        Heap* heap_;
+        bool promote_;
+    };
+
+    for (Ref<Object>* root : roots_) {
+        Evacuate(*root, false);
+    }
+    while (!worklist_.empty()) {
+        Object* object = worklist_.back();
+        worklist_.pop_back();
+        EvacuatingVisitor visitor(this, HeaderOf(object)->old);
+        object->VisitChildren(&visitor);
+    }
+
+    ReleaseChunks(&from_space, true);
+
+    ++stats_.minor_collections;
+    RecordPause(start);
+}
+
+void Heap::CollectMajor() {
+    // Leaves only live objects in the nursery, so nothing swept below is referenced from there.
+    CollectMinor();
+    MarkSweep();
+}
+
+void Heap::MarkSweep() {
+    auto start = std::chrono::steady_clock::now();
+
+    for (Ref<Object>* root : roots_) {
+        if (*root != nullptr && (*root)->IsGcManaged()) {
+            worklist_.push_back(root->Get());
+        }
+    }
+
+    class MarkingVisitor : public ObjectVisitor {
+    public:
+        explicit MarkingVisitor(std::vector<Object*>* worklist) : worklist_(worklist) {
+        }
+
+        void Visit(Ref<Object>& slot) override {
+            if (slot != nullptr && slot->IsGcManaged()) {
+                worklist_->push_back(slot.Get());
+            }
+        }
+
+    private:
+        std::vector<Object*>* worklist_;
+    };
+
+    MarkingVisitor visitor(&worklist_);
+    while (!worklist_.empty()) {
+        Object* object = worklist_.back();
+        worklist_.pop_back();
+        Header* header = HeaderOf(object);
+        if (header->marked) {
+            continue;
+        }
+        header->marked = true;
+        object->VisitChildren(&visitor);
+    }
+
+    std::vector<Header*> survivors;
+    std::vector<Object*> garbage;
+    for (Header* header : old_generation_) {
+        if (header->marked) {
+            header->marked = false;
+            survivors.push_back(header);
+        } else {
+            garbage.push_back(ObjectOf(header));
+            stats_.bytes_collected += header->size;
+            old_generation_used_ -= header->size;
+        }
+    }
+    Destroy(garbage);
+    for (Object* object : garbage) {
+        ::operator delete(HeaderOf(object));
+    }
+    old_generation_ = std::move(survivors);
+
+    for (Chunk& chunk : nursery_) {
+        for (size_t offset = 0; offset < chunk.used;) {
+            Header* header = reinterpret_cast<Header*>(chunk.data.get() + offset);
+            header->marked = false;
+            offset += header->size;
+        }
+    }
+
+    ++stats_.major_collections;
+    RecordPause(start);
+}
+
+void Heap::ReleaseChunks(std::vector<Chunk>* chunks, bool count_garbage) {
+    std::vector<Object*> objects;
+    for (Chunk& chunk : *chunks) {
+        for (size_t offset = 0; offset < chunk.used;) {
+            Header* header = reinterpret_cast<Header*>(chunk.data.get() + offset);
+            if (count_garbage && header->forward == nullptr) {
+                stats_.bytes_collected += header->size;
+            }
+            objects.push_back(ObjectOf(header));
+            offset += header->size;
+        }
+    }
+
+    // Evacuated objects are destroyed too, their moved-from state owns nothing.
+    Destroy(objects);
+
+    for (Chunk& chunk : *chunks) {
+        chunk.used = 0;
+        if (chunk.capacity == options_.nursery_bytes && spare_chunks_.size() < 2) {
+            spare_chunks_.push_back(std::move(chunk));
+        }
+    }
+    chunks->clear();
+}
+
+void Heap::Destroy(const std::vector<Object*>& objects) {
+    DetachingVisitor visitor;
+    for (Object* object : objects) {
+        object->VisitChildren(&visitor);
+        // Evacuated objects live on as their copies.
+        if (HeaderOf(object)->forward == nullptr) {
+            CountRelease(object->GetType(), GetObjectSize(object->GetType()));
+        }
+    }
+    for (Object* object : objects) {
+        object->~Object();
+    }
+}
+
+void Heap::RecordPause(std::chrono::steady_clock::time_point start) {
+    auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+    stats_.last_pause = pause;
+    stats_.max_pause = std::max(stats_.max_pause, pause);
+    stats_.total_pause += pause;
+}
+
+GcStats Heap::GetStats() const {
+    GcStats stats = stats_;
+    stats.nursery_bytes = nursery_used_;
+    stats.old_generation_bytes = old_generation_used_;
+    return stats;
+}
+
+Heap* Heap::Current() {
+    return current_heap;
+}
+
+Heap::Scope::Scope(Heap* heap) : previous_(std::exchange(current_heap, heap)) {
+}
+
+Heap::Scope::~Scope() {
+    current_heap = previous_;
+}
+
+Heap::Root::Root(Heap* heap, Ref<Object>* root) : heap_(heap), root_(root) {
+    if (heap_ != nullptr) {
+        heap_->AddRoot(root_);
+    }
+}
+
+Heap::Root::~Root() {
+    if (heap_ != nullptr) {
+        heap_->RemoveRoot(root_);
+    }
+}
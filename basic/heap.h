@@ -0,0 +1,125 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "object.h"
+
+struct GcOptions {
+    // Capacity of the nursery; a minor collection is due at the next safepoint once it fills up.
+    size_t nursery_bytes = 1 << 20;
+    // Number of minor collections an object has to survive to be promoted to the old generation.
+    uint32_t promotion_age = 2;
+    // Old generation size that triggers a mark-sweep collection. Grows with the live set.
+    size_t old_generation_bytes = 8 << 20;
+};
+
+struct GcStats {
+    uint64_t minor_collections = 0;
+    uint64_t major_collections = 0;
+    std::chrono::nanoseconds last_pause{0};
+    std::chrono::nanoseconds max_pause{0};
+    std::chrono::nanoseconds total_pause{0};
+    uint64_t bytes_collected = 0;
+    uint64_t bytes_promoted = 0;
+    size_t nursery_bytes = 0;
+    size_t old_generation_bytes = 0;
+};
+
+// Precise generational heap for interpreter objects. Objects allocated while the heap is current
+// are bump-allocated in the nursery and are not reference counted. Minor collections copy the
+// survivors out of the nursery, promoting those that are old enough, and the old generation is
+// reclaimed by mark-sweep, so cycles are collected as well.
+//
+// Collections only happen at safepoints, where the caller guarantees that every live object of
+// the heap is reachable from the registered roots. Nothing may point from the old generation
+// into the nursery: promotion takes the young objects reachable from a promoted one along, and
+// objects are never mutated after construction. A mutating builtin will need a write barrier.
+//
+// A heap belongs to one thread.
+class Heap {
+public:
+    explicit Heap(const GcOptions& options = {});
+    ~Heap();
+
+    Heap(const Heap&) = delete;
+    Heap& operator=(const Heap&) = delete;
+
+    void* Allocate(size_t size);
+    bool Owns(const void* ptr) const;
+
+    void AddRoot(Ref<Object>* root);
+    void RemoveRoot(Ref<Object>* root);
+
+    void Safepoint();
+    void CollectMinor();
+    void CollectMajor();
+
+    GcStats GetStats() const;
+
+    static Heap* Current();
+
+    // Makes the heap current for the calling thread. Null heap means plain reference counting.
+    class Scope {
+    public:
+        explicit Scope(Heap* heap);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Heap* previous_;
+    };
+
+    // Registers a root for the lifetime of the guard. Null heap makes it a no-op.
+    class Root {
+    public:
+        Root(Heap* heap, Ref<Object>* root);
+        ~Root();
+
+        Root(const Root&) = delete;
+        Root& operator=(const Root&) = delete;
+
+    private:
+        Heap* heap_;
+        Ref<Object>* root_;
+    };
+
+private:
+    struct Header;
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t capacity = 0;
+        size_t used = 0;
+    };
+
+    static Header* HeaderOf(Object* object);
+    static Object* ObjectOf(Header* header);
+
+    void* AllocateYoung(size_t size);
+    void* AllocateOld(size_t size);
+    void Evacuate(Ref<Object>& slot, bool promote);
+    void MarkSweep();
+    void ReleaseChunks(std::vector<Chunk>* chunks, bool count_garbage);
+    void Destroy(const std::vector<Object*>& objects);
+    void RecordPause(std::chrono::steady_clock::time_point start);
+
+    GcOptions options_;
+    size_t old_generation_limit_;
+
+    std::vector<Chunk> nursery_;
+    std::vector<Chunk> spare_chunks_;
+    size_t nursery_used_ = 0;
+
+    std::vector<Header*> old_generation_;
+    size_t old_generation_used_ = 0;
+
+    std::vector<Ref<Object>*> roots_;
+    std::vector<Object*> worklist_;
+
+    GcStats stats_;
+};
@@ -0,0 +1,183 @@
+#include "latency.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace {
+constexpr size_t kExactValues = 2 * LatencyHistogram::kSubBuckets;
+constexpr uint64_t kMaxValue = (uint64_t{1} << 40) - 1;
+constexpr const char* kPhaseNames[kPhaseCount] = {"read", "evaluate", "print", "total"};
+
+uint64_t GetBucketEnd(size_t bucket) {
+    return bucket + 1 < LatencyHistogram::kBuckets ? LatencyHistogram::GetBucketStart(bucket + 1)
+                                                   : UINT64_MAX;
+}
+
+void AppendMetric(std::string* out, const char* name, const char* phase, const char* quantile,
+                  double value) {
+    char line[160];
+    if (quantile != nullptr) {
+        std::snprintf(line, sizeof(line), "%s{phase=\"%s\",quantile=\"%s\"} %.9g\n", name, phase,
+                      quantile, value);
+    } else {
+        std::snprintf(line, sizeof(line), "%s{phase=\"%s\"} %.9g\n", name, phase, value);
+    }
+    *out += line;
+}
+}  // namespace
+
+const char* GetPhaseName(Phase phase) {
+    return kPhaseNames[static_cast<size_t>(phase)];
+}
+
+size_t LatencyHistogram::GetBucket(uint64_t value) {
+    value = std::min(value, kMaxValue);
+    if (value < kExactValues) {
+        return value;
+    }
+    size_t shift = std::bit_width(value) - std::bit_width(kExactValues - 1);
+    return shift * kSubBuckets + (value >> shift);
+}
+
+uint64_t LatencyHistogram::GetBucketStart(size_t bucket) {
+    if (bucket < kExactValues) {
+        return bucket;
+    }
+    size_t shift = bucket / kSubBuckets - 1;
+    return static_cast<uint64_t>(bucket - shift * kSubBuckets) << shift;
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+    ++counts_[GetBucket(value)];
+    ++count_;
+    sum_ += value;
+    max_ = std::max(max_, value);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < kBuckets; ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+}
+
+// Reports the largest value of the bucket the quantile falls in, as HdrHistogram does.
+uint64_t LatencyHistogram::GetQuantile(double q) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(q * count_)), 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += counts_[i];
+        if (seen >= rank) {
+            return std::min(GetBucketEnd(i) - 1, max_);
+        }
+    }
+    return max_;
+}
+
+void LatencyRecorder::Shard::Record(Phase phase, std::chrono::nanoseconds duration) {
+    // Only the owner writes, so plain loads and stores are enough and readers see whole values.
+    auto bump = [](std::atomic<uint64_t>* counter, uint64_t delta) {
+        counter->store(counter->load(std::memory_order_relaxed) + delta,
+                       std::memory_order_relaxed);
+    };
+    uint64_t value = std::max<int64_t>(duration.count(), 0);
+    Counters& counters = phases_[static_cast<size_t>(phase)];
+    bump(&counters.counts[LatencyHistogram::GetBucket(value)], 1);
+    bump(&counters.count, 1);
+    bump(&counters.sum, value);
+    if (value > counters.max.load(std::memory_order_relaxed)) {
+        counters.max.store(value, std::memory_order_relaxed);
+    }
+}
+
+LatencyRecorder::Shard* LatencyRecorder::AddShard() {
+    std::lock_guard lock(mutex_);
+    return &shards_.emplace_back();
+}
+
+LatencyHistogram LatencyRecorder::Merge(Phase phase) const {
+    LatencyHistogram merged;
+    std::lock_guard lock(mutex_);
+    for (const Shard& shard : shards_) {
+        const Shard::Counters& counters = shard.phases_[static_cast<size_t>(phase)];
+        for (size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+            merged.counts_[i] += counters.counts[i].load(std::memory_order_relaxed);
+        }
+        merged.count_ += counters.count.load(std::memory_order_relaxed);
+        merged.sum_ += counters.sum.load(std::memory_order_relaxed);
+        merged.max_ = std::max(merged.max_, counters.max.load(std::memory_order_relaxed));
+    }
+    return merged;
+}
+
+std::string LatencyRecorder::ToPrometheus() const {
+    static constexpr std::pair<double, const char*> kQuantiles[] = {
+        {0.5, "0.5"}, {0.9, "0.9"}, {0.99, "0.99"}, {0.999, "0.999"}};
+    static constexpr const char* kSummary = "scheme_phase_duration_seconds";
+    static constexpr const char* kMax = "scheme_phase_duration_max_seconds";
+
+    std::string out;
+    out += "# HELP scheme_phase_duration_seconds Time spent in each phase of a run.\n";
+    out += "# TYPE scheme_phase_duration_seconds summary\n";
+    LatencyHistogram histograms[kPhaseCount];
+    for (size_t i = 0; i < kPhaseCount; ++i) {
+        histograms[i] = Merge(static_cast<Phase>(i));
+        const char* phase = kPhaseNames[i];
+        for (auto [q, label] : kQuantiles) {
+            AppendMetric(&out, kSummary, phase, label, histograms[i].GetQuantile(q) / 1e9);
+        }
+        AppendMetric(&out, "scheme_phase_duration_seconds_sum", phase, nullptr,
+                     histograms[i].GetSum() / 1e9);
+        AppendMetric(&out, "scheme_phase_duration_seconds_count", phase, nullptr,
+                     histograms[i].GetCount());
+    }
+    out += "# HELP scheme_phase_duration_max_seconds Longest time spent in each phase of a run.\n";
+    out += "# TYPE scheme_phase_duration_max_seconds gauge\n";
+    for (size_t i = 0; i < kPhaseCount; ++i) {
+        AppendMetric(&out, kMax, kPhaseNames[i], nullptr, histograms[i].GetMax() / 1e9);
+    }
+    return out;
+}
+
+bool LatencyRecorder::ExportPrometheus(const std::string& path) const {
+    std::string text = ToPrometheus();
+    if (path == "-") {
+        std::cout << text << std::flush;
+        return static_cast<bool>(std::cout);
+    }
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!(out << text) || !out.flush()) {
+            return false;
+        }
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+PhaseClock::PhaseClock(LatencyRecorder::Shard* shard) : shard_(shard) {
+    if (shard_ != nullptr) {
+        start_ = lap_ = std::chrono::steady_clock::now();
+    }
+}
+
+PhaseClock::~PhaseClock() {
+    if (shard_ != nullptr) {
+        shard_->Record(Phase::kTotal, std::chrono::steady_clock::now() - start_);
+    }
+}
+
+void PhaseClock::RecordLap(Phase phase) {
+    auto now = std::chrono::steady_clock::now();
+    shard_->Record(phase, now - lap_);
+    lap_ = now;
+}
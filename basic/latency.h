@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+
+// Phases of a run. Reading covers tokenizing as well, the reader pulls tokens as it goes.
+enum class Phase : uint8_t { kRead, kEvaluate, kPrint, kTotal };
+
+inline constexpr size_t kPhaseCount = 4;
+
+const char* GetPhaseName(Phase phase);
+
+// Log-linear histogram of nanosecond durations in the manner of HdrHistogram: values below 64 are
+// exact and larger ones fall in one of 32 buckets per power of two, so quantiles are within about
+// 3% of the recorded values. Durations of 2^40 ns (about 18 minutes) and more share one bucket.
+class LatencyHistogram {
+public:
+    static constexpr size_t kSubBuckets = 32;
+    static constexpr size_t kBuckets = (40 - 4) * kSubBuckets;
+
+    static size_t GetBucket(uint64_t value);
+    static uint64_t GetBucketStart(size_t bucket);
+
+    void Record(uint64_t value);
+    void Merge(const LatencyHistogram& other);
+
+    // The value below which a fraction q of the recorded ones lie, zero when empty.
+    uint64_t GetQuantile(double q) const;
+
+    uint64_t GetCount() const {
+        return count_;
+    }
+    uint64_t GetSum() const {
+        return sum_;
+    }
+    uint64_t GetMax() const {
+        return max_;
+    }
+
+private:
+    friend class LatencyRecorder;
+
+    std::array<uint64_t, kBuckets> counts_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
+
+// Phase timings of many interpreters, typically one per thread. Each interpreter records into a
+// shard of its own without locking; Merge sums the shards while they are being written, so a
+// snapshot may miss the runs that finish at the same time but never tears a counter.
+class LatencyRecorder {
+public:
+    class Shard {
+    public:
+        void Record(Phase phase, std::chrono::nanoseconds duration);
+
+    private:
+        friend class LatencyRecorder;
+
+        struct Counters {
+            std::array<std::atomic<uint64_t>, LatencyHistogram::kBuckets> counts{};
+            std::atomic<uint64_t> count = 0;
+            std::atomic<uint64_t> sum = 0;
+            std::atomic<uint64_t> max = 0;
+        };
+
+        std::array<Counters, kPhaseCount> phases_;
+    };
+
+    LatencyRecorder() = default;
+
+    LatencyRecorder(const LatencyRecorder&) = delete;
+    LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+
+    // The shard lives as long as the recorder and must be written by one thread at a time.
+    Shard* AddShard();
+
+    LatencyHistogram Merge(Phase phase) const;
+
+    // A summary per phase in the Prometheus text format, in seconds, with the 0.5, 0.9, 0.99 and
+    // 0.999 quantiles.
+    std::string ToPrometheus() const;
+
+    // Writes ToPrometheus() to the file through a temporary one and a rename, so scrapers never
+    // see half of it, or to stdout when the path is "-".
+    bool ExportPrometheus(const std::string& path) const;
+
+private:
+    mutable std::mutex mutex_;
+    std::deque<Shard> shards_;
+};
+
+// Times consecutive phases of one run into a shard; does nothing without one. The total is
+// recorded when the clock goes out of scope, phases only when they are lapped.
+class PhaseClock {
+public:
+    explicit PhaseClock(LatencyRecorder::Shard* shard);
+    ~PhaseClock();
+
+    PhaseClock(const PhaseClock&) = delete;
+    PhaseClock& operator=(const PhaseClock&) = delete;
+
+    void Lap(Phase phase) {
+        if (shard_ != nullptr) {
+            RecordLap(phase);
+        }
+    }
+
+private:
+    void RecordLap(Phase phase);
+
+    LatencyRecorder::Shard* shard_;
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point lap_;
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+struct CacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t insertions = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+};
+
+// String-keyed LRU map bounded by the sizes its users report for the entries. Entries are spread
+// over shards with a lock each, so threads can share one cache.
+template <class Value>
+class ShardedLruCache {
+public:
+    ShardedLruCache(size_t max_bytes, size_t shard_count)
+        : shard_count_(std::max<size_t>(shard_count, 1)),
+          shard_max_bytes_(max_bytes / shard_count_),
+          shards_(std::make_unique<Shard[]>(shard_count_)) {
+    }
+
+    // Calls on_hit with the value for key under the shard's lock; returns false on a miss.
+    template <class OnHit>
+    bool Lookup(std::string_view key, OnHit&& on_hit) {
+        Shard& shard = GetShard(key);
+        std::lock_guard lock(shard.mutex);
+        auto found = shard.index.find(key);
+        if (found == shard.index.end()) {
+            ++shard.misses;
+            return false;
+        }
+        ++shard.hits;
+        shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+        on_hit(found->second->value);
+        return true;
+    }
+
+    // Entries that do not fit in a shard's share of the budget are not stored.
+    void Insert(std::string_view key, Value value, size_t size) {
+        if (size > shard_max_bytes_) {
+            return;
+        }
+
+        Shard& shard = GetShard(key);
+        std::unique_lock lock(shard.mutex);
+        if (auto found = shard.index.find(key); found != shard.index.end()) {
+            // Another thread got here first.
+            shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+            return;
+        }
+
+        // Evicted values are destroyed after the lock is released.
+        std::list<Entry> evicted;
+        while (shard.bytes + size > shard_max_bytes_) {
+            auto last = std::prev(shard.entries.end());
+            shard.bytes -= last->size;
+            shard.index.erase(last->key);
+            evicted.splice(evicted.end(), shard.entries, last);
+            ++shard.evictions;
+        }
+
+        shard.entries.push_front(Entry{std::string(key), std::move(value), size});
+        shard.index.emplace(shard.entries.front().key, shard.entries.begin());
+        shard.bytes += size;
+        ++shard.insertions;
+        lock.unlock();
+    }
+
+    void Clear() {
+        for (size_t i = 0; i < shard_count_; ++i) {
+            std::list<Entry> entries;
+            std::lock_guard lock(shards_[i].mutex);
+            shards_[i].index.clear();
+            entries.swap(shards_[i].entries);
+            shards_[i].bytes = 0;
+        }
+    }
+
+    CacheStats GetStats() const {
+        CacheStats stats;
+        for (size_t i = 0; i < shard_count_; ++i) {
+            std::lock_guard lock(shards_[i].mutex);
+            stats.hits += shards_[i].hits;
+            stats.misses += shards_[i].misses;
+            stats.insertions += shards_[i].insertions;
+            stats.evictions += shards_[i].evictions;
+            stats.entries += shards_[i].entries.size();
+            stats.bytes += shards_[i].bytes;
+        }
+        return stats;
+    }
+
+private:
+    struct Entry {
+        std::string key;
+        Value value;
+        size_t size;
+    };
+
+    // Front is the most recently used entry; the index points into the list.
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> entries;
+        std::unordered_map<std::string_view, typename std::list<Entry>::iterator> index;
+        size_t bytes = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t insertions = 0;
+        uint64_t evictions = 0;
+    };
+
+    Shard& GetShard(std::string_view key) {
+        return shards_[std::hash<std::string_view>{}(key) % shard_count_];
+    }
+
+    size_t shard_count_;
+    size_t shard_max_bytes_;
+    std::unique_ptr<Shard[]> shards_;
+};
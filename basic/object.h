@@ -1,69 +1,240 @@
 #pragma once
 
-#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <type_traits>
+#include <typeinfo>
 
-class Object : public std::enable_shared_from_this<Object> {
+#include "allocation.h"
+#include "ref.h"
+
+// Bytes of objects allocated by the current thread so far, see RunLimits::max_bytes.
+inline thread_local uint64_t allocated_object_bytes = 0;
+
+#ifndef NDEBUG
+// Number of reference count updates made by the current thread. Debug builds only, used to
+// keep an eye on the refcount traffic of the evaluator.
+inline thread_local uint64_t ref_count_operations = 0;
+#endif
+
+class ObjectVisitor;
+
+// Objects are owned through Ref<T> and counted non-atomically: an object graph belongs to the
+// thread (interpreter) that created it. To hand a graph to other threads, call Share() on it
+// first; shared objects switch to atomic counting and must be treated as immutable.
+//
+// Objects created while a Heap is current (see heap.h) are managed by its tracing collector
+// instead: Ref<T> does not count them at all.
+class Object {
 public:
+    Object();
+    Object(const Object&);
+    Object& operator=(const Object&) = delete;
     virtual ~Object() = default;
+
+    virtual ObjectType GetType() const = 0;
+
+    void IncRef() const {
+#ifndef NDEBUG
+        ++ref_count_operations;
+#endif
+        if (flags_ == 0) {
+            ++ref_count_;
+        } else if (flags_ & kShared) {
+            std::atomic_ref<uint32_t>(ref_count_).fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void DecRef() const {
+        if (DropRef()) {
+            Destroy(this);
+        }
+    }
+
+    // Drops a reference without destroying the object; returns true if it was the last one.
+    bool DropRef() const {
+#ifndef NDEBUG
+        ++ref_count_operations;
+#endif
+        if (flags_ == 0) {
+            return --ref_count_ == 0;
+        } else if (flags_ & kShared) {
+            return std::atomic_ref<uint32_t>(ref_count_).fetch_sub(
+                       1, std::memory_order_acq_rel) == 1;
+        }
+        return false;
+    }
+
+    bool IsShared() const {
+        return flags_ & kShared;
+    }
+
+    bool IsGcManaged() const {
+        return flags_ & kGcManaged;
+    }
+
+    // Canonical copy owned by a HashConsTable, see hash_cons.h.
+    bool IsHashConsed() const {
+        return flags_ & kHashConsed;
+    }
+
+    uint32_t GetRefCount() const {
+        return ref_count_;
+    }
+
+    // Where the reader found the object in its input, used to locate errors. Saturates at 16 MiB.
+    size_t GetSourceOffset() const {
+        return source_offset_;
+    }
+
+    void SetSourceOffset(size_t offset) {
+        source_offset_ = std::min<size_t>(offset, kMaxSourceOffset);
+    }
+
+    // Calls visitor for every reference the object holds.
+    virtual void VisitChildren(ObjectVisitor* visitor);
+
+    // Move-constructs a copy of the object into storage, used by the collector to evacuate it.
+    virtual Object* Relocate(void* storage) = 0;
+
+protected:
+    // Objects are allocated through TypedObject, which counts them in allocation_counters.
+    static void* Allocate(size_t size, ObjectType type);
+    static void Deallocate(void* ptr, size_t size, ObjectType type);
+
+    static constexpr uint32_t kShared = 1;
+    static constexpr uint32_t kGcManaged = 2;
+    static constexpr uint32_t kHashConsed = 4;
+    static constexpr uint32_t kMaxSourceOffset = (1 << 24) - 1;
+
+private:
+    friend void Share(const Ref<Object>& root);
+    friend class Heap;
+    friend class HashConsTable;
+
+    // Tears down an unreferenced object and everything only it kept alive, see reclaimer.h.
+    static void Destroy(const Object* object);
+
+    mutable uint32_t ref_count_ = 0;
+    uint32_t flags_ : 8;
+    uint32_t source_offset_ : 24;
+};
+
+class ObjectVisitor {
+public:
+    virtual ~ObjectVisitor() = default;
+    virtual void Visit(Ref<Object>& slot) = 0;
+};
+
+// Base of the concrete object types, routing their allocations through the counting allocator.
+template <ObjectType kType>
+class TypedObject : public Object {
+public:
+    static void* operator new(size_t size) {
+        return Allocate(size, kType);
+    }
+
+    static void operator delete(void* ptr, size_t size) {
+        Deallocate(ptr, size, kType);
+    }
+
+    ObjectType GetType() const final {
+        return kType;
+    }
 };
 
-class Number : public Object {
+class Number final : public TypedObject<ObjectType::kNumber> {
 public:
     explicit Number(const int value);
     int GetValue() const;
+    Object* Relocate(void* storage) override;
 
     int value_;
 };
 
-class Bool : public Object {
+class Bool final : public TypedObject<ObjectType::kBool> {
 public:
     explicit Bool(const bool value);
     bool GetValue() const;
+    Object* Relocate(void* storage) override;
 
     bool value_;
 };
 
-class Quote : public Object {
+class Quote final : public TypedObject<ObjectType::kQuote> {
 public:
-    std::shared_ptr<Object> next_ = nullptr;
+    void VisitChildren(ObjectVisitor* visitor) override;
+    Object* Relocate(void* storage) override;
+
+    Ref<Object> next_ = nullptr;
 };
 
-class Symbol : public Object {
+class Symbol final : public TypedObject<ObjectType::kSymbol> {
 public:
     explicit Symbol(const std::string& name);
     const std::string& GetName() const;
+    Object* Relocate(void* storage) override;
 
     std::string name_;
 };
 
-class Cell : public Object {
+class Cell final : public TypedObject<ObjectType::kCell> {
 public:
-    std::shared_ptr<Object> GetFirst() const;
-    std::shared_ptr<Object> GetSecond() const;
+    const Ref<Object>& GetFirst() const;
+    const Ref<Object>& GetSecond() const;
     bool HasSon() const;
+    void VisitChildren(ObjectVisitor* visitor) override;
+    Object* Relocate(void* storage) override;
 
-    std::shared_ptr<Object> first_ = nullptr;
-    std::shared_ptr<Object> second_ = nullptr;
+    Ref<Object> first_ = nullptr;
+    Ref<Object> second_ = nullptr;
 };
 
+// Size the allocator is asked for to create an object of the type.
+inline size_t GetObjectSize(ObjectType type) {
+    static constexpr size_t kSizes[kObjectTypeCount] = {
+        sizeof(Number), sizeof(Bool), sizeof(Quote), sizeof(Symbol), sizeof(Cell)};
+    return kSizes[static_cast<size_t>(type)];
+}
+
+// Freezes the graph reachable from root and switches it to atomic reference counting, so that
+// it can be read and referenced from several threads. Must be called by the owning thread
+// before the graph is published. Objects of a collected heap cannot be shared.
+void Share(const Ref<Object>& root);
+
 ///////////////////////////////////////////////////////////////////////////////
 
-// Runtime type checking and convertion.
-// This can be helpful: https://en.cppreference.com/w/cpp/memory/shared_ptr/pointer_cast
+// Runtime type checking and convertion. As<T> returns a borrowed view that stays valid as long
+// as the checked object is referenced by someone else; wrap it into Ref<T> to take ownership.
+// Final types are matched exactly, which is much cheaper than a failing dynamic_cast.
 
 template <class T>
-std::shared_ptr<T> As(const std::shared_ptr<Object>& obj) {
-    if (auto new_ptr = std::dynamic_pointer_cast<T>(obj)) {
-        return new_ptr;
+bool Is(const Object* obj) {
+    if constexpr (std::is_final_v<T>) {
+        return obj != nullptr && typeid(*obj) == typeid(T);
+    } else {
+        return dynamic_cast<const T*>(obj) != nullptr;
     }
-    return nullptr;
+}
+
+template <class T, class U>
+bool Is(const Ref<U>& obj) {
+    return Is<T>(static_cast<const Object*>(obj.Get()));
 }
 
 template <class T>
-bool Is(const std::shared_ptr<Object>& obj) {
-    if (auto new_ptr = std::dynamic_pointer_cast<T>(obj)) {
-        return true;
+T* As(Object* obj) {
+    if constexpr (std::is_final_v<T>) {
+        return Is<T>(obj) ? static_cast<T*>(obj) : nullptr;
+    } else {
+        return dynamic_cast<T*>(obj);
     }
-    return false;
+}
+
+template <class T, class U>
+T* As(const Ref<U>& obj) {
+    return As<T>(static_cast<Object*>(obj.Get()));
 }
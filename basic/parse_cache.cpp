@@ -0,0 +1,26 @@
+#include "parse_cache.h"
+
+namespace {
+// Counts the list node and the index entry along with the key.
+constexpr size_t kEntryOverhead = 128;
+}  // namespace
+
+ParseCache::ParseCache(size_t max_bytes, size_t shard_count) : cache_(max_bytes, shard_count) {
+}
+
+bool ParseCache::Lookup(std::string_view source, Ref<Object>* program) {
+    return cache_.Lookup(source, [program](const Ref<Object>& cached) { *program = cached; });
+}
+
+void ParseCache::Insert(std::string_view source, const Ref<Object>& program, size_t ast_bytes) {
+    Share(program);
+    cache_.Insert(source, program, source.size() + ast_bytes + kEntryOverhead);
+}
+
+void ParseCache::Clear() {
+    cache_.Clear();
+}
+
+ParseCacheStats ParseCache::GetStats() const {
+    return cache_.GetStats();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+#include "lru_cache.h"
+#include "object.h"
+
+using ParseCacheStats = CacheStats;
+
+// Parsed programs keyed by their source text, so a repeated request skips the tokenizer and the
+// reader. Trees are Share()d when inserted and never mutated afterwards: evaluation builds new
+// cells instead of writing into the program. They are safe to read from any number of threads.
+class ParseCache {
+public:
+    explicit ParseCache(size_t max_bytes, size_t shard_count = 16);
+
+    ParseCache(const ParseCache&) = delete;
+    ParseCache& operator=(const ParseCache&) = delete;
+
+    // Returns false on a miss. A cached program can be null: "()" reads as the empty list.
+    bool Lookup(std::string_view source, Ref<Object>* program);
+
+    // Shares program and stores it; ast_bytes is what the tree took to allocate.
+    void Insert(std::string_view source, const Ref<Object>& program, size_t ast_bytes);
+
+    void Clear();
+
+    ParseCacheStats GetStats() const;
+
+private:
+    ShardedLruCache<Ref<Object>> cache_;
+};
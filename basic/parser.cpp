@@ -1,6 +1,10 @@
 #include <parser.h>
 #include <error.h>
 
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
 Number::Number(const int value) : value_(value) {
 }
 
@@ -8,6 +12,10 @@ int Number::GetValue() const {
     return value_;
 }
 
+Object* Number::Relocate(void* storage) {
+    return ::new (storage) Number(std::move(*this));
+}
+
 Bool::Bool(const bool value) : value_(value) {
 }
 
@@ -15,6 +23,18 @@ bool Bool::GetValue() const {
     return value_;
 }
 
+Object* Bool::Relocate(void* storage) {
+    return ::new (storage) Bool(std::move(*this));
+}
+
+void Quote::VisitChildren(ObjectVisitor* visitor) {
+    visitor->Visit(next_);
+}
+
+Object* Quote::Relocate(void* storage) {
+    return ::new (storage) Quote(std::move(*this));
+}
+
 Symbol::Symbol(const std::string& name) : name_(name) {
 }
 
@@ -22,11 +42,15 @@ const std::string& Symbol::GetName() const {
     return name_;
 }
 
-std::shared_ptr<Object> Cell::GetFirst() const {
+Object* Symbol::Relocate(void* storage) {
+    return ::new (storage) Symbol(std::move(*this));
+}
+
+const Ref<Object>& Cell::GetFirst() const {
     return first_;
 }
 
-std::shared_ptr<Object> Cell::GetSecond() const {
+const Ref<Object>& Cell::GetSecond() const {
     return second_;
 }
 
@@ -37,155 +61,299 @@ bool Cell::HasSon() const {
     return true;
 }
 
-std::shared_ptr<Object> Read(Tokenizer* tokenizer) {
-    Token current_token;
-    try {
-        current_token = tokenizer->GetToken();
-    } catch (...) {
-        throw SyntaxError("SyntaxError in Read_1");
-    }
-    if (ConstantToken* number_token = std::get_if<ConstantToken>(&current_token)) {
-        std::shared_ptr<Number> head = std::make_shared<Number>(number_token->value);
-        tokenizer->Next();
-        if (!tokenizer->IsEnd()) {
-            throw SyntaxError("SyntaxError in Read_2");
-        }
-        return head;
-    } else if (SymbolToken* symbol_token = std::get_if<SymbolToken>(&current_token)) {
-        std::shared_ptr<Symbol> head = std::make_shared<Symbol>(symbol_token->name);
-        tokenizer->Next();
-        if (!tokenizer->IsEnd()) {
-            throw SyntaxError("SyntaxError in Read_3");
+void Cell::VisitChildren(ObjectVisitor* visitor) {
+    visitor->Visit(first_);
+    visitor->Visit(second_);
+}
+
+Object* Cell::Relocate(void* storage) {
+    return ::new (storage) Cell(std::move(*this));
+}
+
+void Object::VisitChildren(ObjectVisitor*) {
+}
+
+void Share(const Ref<Object>& root) {
+    class SharingVisitor : public ObjectVisitor {
+    public:
+        void Visit(Ref<Object>& slot) override {
+            if (slot != nullptr && !slot->IsShared()) {
+                assert(!slot->IsGcManaged());
+                slot->flags_ |= Object::kShared;
+                stack.push_back(slot.Get());
+            }
         }
-        return head;
-    } else if (BoolToken* bool_token = std::get_if<BoolToken>(&current_token)) {
-        std::shared_ptr<Bool> head = std::make_shared<Bool>(bool_token->value);
-        tokenizer->Next();
-        if (!tokenizer->IsEnd()) {
-            throw SyntaxError("SyntaxError in Read_4");
+
+        std::vector<Object*> stack;
+    };
+
+    SharingVisitor visitor;
+    Ref<Object> root_slot = root;
+    visitor.Visit(root_slot);
+    while (!visitor.stack.empty()) {
+        Object* current = visitor.stack.back();
+        visitor.stack.pop_back();
+        current->VisitChildren(&visitor);
+    }
+}
+
+namespace {
+// Recursive descent over the tokens. The first failure is recorded and every caller returns null
+// right away, so malformed input is rejected without unwinding.
+class Reader {
+public:
+    explicit Reader(Tokenizer* tokenizer, size_t max_depth = 0, HashConsTable* table = nullptr)
+        : tokenizer_(tokenizer), table_(table), depth_left_(max_depth == 0 ? SIZE_MAX : max_depth) {
+    }
+
+    bool Failed() const {
+        return failed_;
+    }
+
+    Error& GetError() {
+        return error_;
+    }
+
+    std::nullptr_t Fail(const char* message, ErrorKind kind = ErrorKind::kSyntax) {
+        if (!failed_) {
+            failed_ = true;
+            const char* tokenizer_error = tokenizer_->GetError();
+            error_ = Error{kind, tokenizer_error ? tokenizer_error : message,
+                           tokenizer_->GetOffset()};
         }
-        return head;
-    } else if (QuoteToken* quote_token = std::get_if<QuoteToken>(&current_token)) {
-        std::shared_ptr<Quote> head = std::make_shared<Quote>();
-        tokenizer->Next();
-        if (tokenizer->IsEnd()) {
-            throw SyntaxError("SyntaxError in Read_4");
+        return nullptr;
+    }
+
+    Ref<Object> Read() {
+        const Token* current_token = tokenizer_->TryGetToken();
+        if (current_token == nullptr) {
+            return Fail("SyntaxError in Read_1");
         }
-        head->next_ = Read(tokenizer);
-        return head;
-    } else if (BracketToken* bracket_token = std::get_if<BracketToken>(&current_token)) {
-        if (*bracket_token == BracketToken::CLOSE) {
-            throw SyntaxError("SyntaxError in Read_5");
-        } else {
-            std::shared_ptr<Cell> head = ReadList(tokenizer);
-            tokenizer->Next();
-            if (!tokenizer->IsEnd()) {
-                throw SyntaxError("SyntaxError in Read_6");
+        if (const ConstantToken* number_token = std::get_if<ConstantToken>(current_token)) {
+            Ref<Number> head = MakeRef<Number>(number_token->value);
+            tokenizer_->Next();
+            if (!tokenizer_->IsEnd()) {
+                return Fail("SyntaxError in Read_2");
             }
             return head;
-        }
-    }
-    throw SyntaxError("SyntaxError in Read_7");
-}
-
-std::shared_ptr<Cell> ReadList(Tokenizer* tokenizer) {
-    tokenizer->Next();
-    if (tokenizer->IsEnd()) {
-        throw SyntaxError("SyntaxError in ReadList_1");
-    }
-    Token current_token = tokenizer->GetToken();
-    std::shared_ptr<Cell> head = std::make_shared<Cell>();
-    if (ConstantToken* number_token = std::get_if<ConstantToken>(&current_token)) {
-        head->first_ = std::make_shared<Number>(number_token->value);
-    } else if (SymbolToken* symbol_token = std::get_if<SymbolToken>(&current_token)) {
-        head->first_ = std::make_shared<Symbol>(symbol_token->name);
-    } else if (BoolToken* bool_token = std::get_if<BoolToken>(&current_token)) {
-        head->first_ = std::make_shared<Bool>(bool_token->value);
-    } else if (QuoteToken* quote_token = std::get_if<QuoteToken>(&current_token)) {
-        head->first_ = std::make_shared<Quote>();
-        As<Quote>(head->first_)->next_ = ReadOne(tokenizer);
-    } else if (BracketToken* bracket_token = std::get_if<BracketToken>(&current_token)) {
-        if (*bracket_token == BracketToken::CLOSE) {
-            head = nullptr;
+        } else if (const SymbolToken* symbol_token = std::get_if<SymbolToken>(current_token)) {
+            Ref<Symbol> head = MakeRef<Symbol>(symbol_token->name);
+            tokenizer_->Next();
+            if (!tokenizer_->IsEnd()) {
+                return Fail("SyntaxError in Read_3");
+            }
             return head;
-        } else {
-            head->first_ = ReadList(tokenizer);
+        } else if (const BoolToken* bool_token = std::get_if<BoolToken>(current_token)) {
+            Ref<Bool> head = MakeRef<Bool>(bool_token->value);
+            tokenizer_->Next();
+            if (!tokenizer_->IsEnd()) {
+                return Fail("SyntaxError in Read_4");
+            }
+            return head;
+        } else if (std::holds_alternative<QuoteToken>(*current_token)) {
+            Ref<Quote> head = MakeRef<Quote>();
+            tokenizer_->Next();
+            if (tokenizer_->IsEnd()) {
+                return Fail("SyntaxError in Read_4");
+            }
+            if (!Enter()) {
+                return nullptr;
+            }
+            head->next_ = Read();
+            ++depth_left_;
+            if (failed_) {
+                return nullptr;
+            }
+            head->next_ = Intern(head->next_);
+            return head;
+        } else if (const BracketToken* bracket_token = std::get_if<BracketToken>(current_token)) {
+            if (*bracket_token == BracketToken::CLOSE) {
+                return Fail("SyntaxError in Read_5");
+            } else {
+                Ref<Cell> head = ReadNested();
+                if (failed_) {
+                    return nullptr;
+                }
+                tokenizer_->Next();
+                if (!tokenizer_->IsEnd()) {
+                    return Fail("SyntaxError in Read_6");
+                }
+                return head;
+            }
         }
-    } else {
-        throw SyntaxError("SyntaxError in ReadList_3");
+        return Fail("SyntaxError in Read_7");
     }
 
-    if (!tokenizer->NextIsDot()) {
-        head->second_ = ReadList(tokenizer);
+    // Reads the rest of a list, one element per iteration: only nesting deepens the recursion,
+    // so long lists are read in constant stack.
+    Ref<Cell> ReadList() {
+        Ref<Cell> head;
+        Cell* last = nullptr;
+        while (true) {
+            tokenizer_->Next();
+            if (tokenizer_->IsEnd()) {
+                return Fail("SyntaxError in ReadList_1");
+            }
+            const Token* current_token = tokenizer_->TryGetToken();
+            if (*current_token == Token{BracketToken::CLOSE}) {
+                return head;
+            }
+            Ref<Cell> cell = MakeRef<Cell>();
+            cell->SetSourceOffset(tokenizer_->GetOffset());
+            Cell* next = cell.Get();
+            if (last == nullptr) {
+                head = std::move(cell);
+            } else {
+                last->second_ = std::move(cell);
+            }
+            last = next;
+            if (!ReadElement(*current_token, &last->first_, "SyntaxError in ReadList_3")) {
+                return nullptr;
+            }
+            if (tokenizer_->NextIsDot()) {
+                break;
+            }
+        }
+
+        tokenizer_->Next();
+        if (tokenizer_->IsEnd()) {
+            return Fail("SyntaxError in ReadList_4");
+        }
+
+        tokenizer_->Next();
+        if (tokenizer_->IsEnd()) {
+            return Fail("SyntaxError in ReadList_6");
+        }
+
+        const Token* current_token = tokenizer_->TryGetToken();
+        if (*current_token == Token{BracketToken::CLOSE}) {
+            return Fail("SyntaxError in ReadList_7");
+        }
+        if (!ReadElement(*current_token, &last->second_, "SyntaxError in ReadList_8")) {
+            return nullptr;
+        }
+
+        tokenizer_->Next();
+        current_token = tokenizer_->TryGetToken();
+        if (current_token == nullptr || !std::holds_alternative<BracketToken>(*current_token)) {
+            return Fail("SyntaxError in ReadList_9");
+        }
+
+        if (tokenizer_->IsEnd()) {
+            return Fail("SyntaxError in ReadList_4");
+        }
+
         return head;
     }
 
-    tokenizer->Next();
-    if (tokenizer->IsEnd()) {
-        throw SyntaxError("SyntaxError in ReadList_4");
+    Ref<Object> ReadOne() {
+        tokenizer_->Next();
+        const Token* current_token = tokenizer_->TryGetToken();
+        if (tokenizer_->IsEnd()) {
+            return Fail("SyntaxError in Read_1");
+        }
+        if (const ConstantToken* number_token = std::get_if<ConstantToken>(current_token)) {
+            return MakeRef<Number>(number_token->value);
+        } else if (const SymbolToken* symbol_token = std::get_if<SymbolToken>(current_token)) {
+            return MakeRef<Symbol>(symbol_token->name);
+        } else if (const BoolToken* bool_token = std::get_if<BoolToken>(current_token)) {
+            return MakeRef<Bool>(bool_token->value);
+        } else if (const BracketToken* bracket_token = std::get_if<BracketToken>(current_token)) {
+            if (*bracket_token == BracketToken::CLOSE) {
+                return Fail("SyntaxError in Read_5");
+            } else {
+                return ReadNested();
+            }
+        }
+        return Fail("SyntaxError in Read_7");
     }
 
-    tokenizer->Next();
-    if (tokenizer->IsEnd()) {
-        throw SyntaxError("SyntaxError in ReadList_6");
+private:
+    bool Enter() {
+        if (depth_left_ == 0) {
+            Fail("Input is nested too deeply", ErrorKind::kLimit);
+            return false;
+        }
+        --depth_left_;
+        return true;
     }
 
-    current_token = tokenizer->GetToken();
-    if (ConstantToken* number_token = std::get_if<ConstantToken>(&current_token)) {
-        head->second_ = std::make_shared<Number>(number_token->value);
-    } else if (SymbolToken* symbol_token = std::get_if<SymbolToken>(&current_token)) {
-        head->second_ = std::make_shared<Symbol>(symbol_token->name);
-    } else if (BoolToken* bool_token = std::get_if<BoolToken>(&current_token)) {
-        head->second_ = std::make_shared<Bool>(bool_token->value);
-    } else if (QuoteToken* quote_token = std::get_if<QuoteToken>(&current_token)) {
-        head->second_ = std::make_shared<Quote>();
-        As<Quote>(head->second_)->next_ = ReadOne(tokenizer);
-    } else if (BracketToken* bracket_token = std::get_if<BracketToken>(&current_token)) {
-        if (*bracket_token == BracketToken::CLOSE) {
-            throw SyntaxError("SyntaxError in ReadList_7");
-        } else {
-            head->second_ = ReadList(tokenizer);
+    // ReadList for a list that opens a new level of nesting, rather than the rest of the
+    // current one.
+    Ref<Cell> ReadNested() {
+        if (!Enter()) {
+            return nullptr;
         }
-    } else {
-        throw SyntaxError("SyntaxError in ReadList_8");
+        Ref<Cell> list = ReadList();
+        ++depth_left_;
+        return list;
     }
 
-    tokenizer->Next();
-    current_token = tokenizer->GetToken();
-    if (BracketToken* bracket_token = std::get_if<BracketToken>(&current_token);
-        bracket_token == nullptr) {
-        throw SyntaxError("SyntaxError in ReadList_9");
+    Ref<Object> Intern(const Ref<Object>& datum) {
+        return table_ != nullptr ? table_->Intern(datum) : datum;
     }
 
-    if (tokenizer->IsEnd()) {
-        throw SyntaxError("SyntaxError in ReadList_4");
+    // Reads the datum starting at token into slot, failing with message on anything else.
+    bool ReadElement(const Token& token, Ref<Object>* slot, const char* message) {
+        if (const ConstantToken* number_token = std::get_if<ConstantToken>(&token)) {
+            *slot = MakeRef<Number>(number_token->value);
+        } else if (const SymbolToken* symbol_token = std::get_if<SymbolToken>(&token)) {
+            *slot = MakeRef<Symbol>(symbol_token->name);
+        } else if (const BoolToken* bool_token = std::get_if<BoolToken>(&token)) {
+            *slot = MakeRef<Bool>(bool_token->value);
+        } else if (std::holds_alternative<QuoteToken>(token)) {
+            Ref<Quote> quote = MakeRef<Quote>();
+            quote->next_ = ReadOne();
+            if (!failed_) {
+                quote->next_ = Intern(quote->next_);
+            }
+            *slot = std::move(quote);
+        } else if (token == Token{BracketToken::OPEN}) {
+            *slot = ReadNested();
+        } else {
+            Fail(message);
+        }
+        return !failed_;
     }
 
-    return head;
+    Tokenizer* tokenizer_;
+    HashConsTable* table_;
+    size_t depth_left_;
+    bool failed_ = false;
+    Error error_;
+};
+
+template <class T>
+Ref<T> ValueOrThrow(Reader* reader, Ref<T> result) {
+    if (reader->Failed()) {
+        Throw(reader->GetError());
+    }
+    return result;
 }
+}  // namespace
 
-std::shared_ptr<Object> ReadOne(Tokenizer* tokenizer) {
-    tokenizer->Next();
-    Token current_token = tokenizer->GetToken();
-    if (tokenizer->IsEnd()) {
-        throw SyntaxError("SyntaxError in Read_1");
+Expected<Ref<Object>> TryRead(Tokenizer* tokenizer, size_t max_depth, HashConsTable* table) {
+    Reader reader(tokenizer, max_depth, table);
+    Ref<Object> result = reader.Read();
+    if (!reader.Failed() && tokenizer->GetError() != nullptr) {
+        reader.Fail(tokenizer->GetError());
     }
-    if (ConstantToken* number_token = std::get_if<ConstantToken>(&current_token)) {
-        std::shared_ptr<Number> head = std::make_shared<Number>(number_token->value);
-        return head;
-    } else if (SymbolToken* symbol_token = std::get_if<SymbolToken>(&current_token)) {
-        std::shared_ptr<Symbol> head = std::make_shared<Symbol>(symbol_token->name);
-        return head;
-    } else if (BoolToken* bool_token = std::get_if<BoolToken>(&current_token)) {
-        std::shared_ptr<Bool> head = std::make_shared<Bool>(bool_token->value);
-        return head;
-    } else if (BracketToken* bracket_token = std::get_if<BracketToken>(&current_token)) {
-        if (*bracket_token == BracketToken::CLOSE) {
-            throw SyntaxError("SyntaxError in Read_5");
-        } else {
-            std::shared_ptr<Cell> head = ReadList(tokenizer);
-            return head;
-        }
+    if (reader.Failed()) {
+        return std::move(reader.GetError());
     }
-    throw SyntaxError("SyntaxError in Read_7");
+    return result;
+}
+
+Ref<Object> Read(Tokenizer* tokenizer) {
+    return TryRead(tokenizer).ValueOrThrow();
+}
+
+Ref<Object> ReadOne(Tokenizer* tokenizer) {
+    Reader reader(tokenizer);
+    return ValueOrThrow(&reader, reader.ReadOne());
+}
+
+Ref<Cell> ReadList(Tokenizer* tokenizer) {
+    Reader reader(tokenizer);
+    return ValueOrThrow(&reader, reader.ReadList());
 }
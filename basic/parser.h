@@ -1,10 +1,16 @@
 #pragma once
 
-#include <memory>
-
+#include "error.h"
+#include "hash_cons.h"
 #include "object.h"
 #include <tokenizer.h>
 
-std::shared_ptr<Object> Read(Tokenizer* tokenizer);
-std::shared_ptr<Object> ReadOne(Tokenizer* tokenizer);
-std::shared_ptr<Cell> ReadList(Tokenizer* tokenizer);
\ No newline at end of file
+Ref<Object> Read(Tokenizer* tokenizer);
+Ref<Object> ReadOne(Tokenizer* tokenizer);
+Ref<Cell> ReadList(Tokenizer* tokenizer);
+
+// Same as Read, but returns a syntax error instead of throwing it. Lists and quotes nested
+// deeper than max_depth, unless it is zero, are rejected with a limit error. With a table,
+// quoted data is hash-consed through it.
+Expected<Ref<Object>> TryRead(Tokenizer* tokenizer, size_t max_depth = 0,
+                              HashConsTable* table = nullptr);
@@ -0,0 +1,253 @@
+#include "ports.h"
+#include "parser.h"
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+// Bytes of a mapping read past before its pages are handed back.
+constexpr size_t kReleaseBytes = 8 << 20;
+
+bool IsSpace(char ch) {
+    return ch == ' ' || ch == '\n' || ch == '\t' || ch == '\r' || ch == '\f' || ch == '\v';
+}
+
+bool IsDelimiter(char ch) {
+    return IsSpace(ch) || ch == '(' || ch == ')' || ch == '\'';
+}
+
+// Finds the datum that starts at or after from, its quotes included. Returns false when text
+// ends before the datum does and more may follow. At the end of the input the rest of text
+// counts as the datum, which the reader then rejects; only whitespace leaves an empty datum.
+bool FindDatum(std::string_view text, size_t from, bool at_end, size_t* begin, size_t* end) {
+    size_t position = from;
+    while (position < text.size() && IsSpace(text[position])) {
+        ++position;
+    }
+    *begin = position;
+    while (position < text.size() && (text[position] == '\'' || IsSpace(text[position]))) {
+        ++position;
+    }
+    if (position < text.size() && text[position] == '(') {
+        int64_t depth = 0;
+        for (; position < text.size(); ++position) {
+            if (text[position] == '(') {
+                ++depth;
+            } else if (text[position] == ')' && --depth == 0) {
+                *end = position + 1;
+                return true;
+            }
+        }
+    } else if (position < text.size() && text[position] == ')') {
+        *end = position + 1;
+        return true;
+    } else {
+        while (position < text.size() && !IsDelimiter(text[position])) {
+            ++position;
+        }
+        if (position < text.size()) {
+            *end = position;
+            return true;
+        }
+    }
+    *end = text.size();
+    return at_end;
+}
+}  // namespace
+
+OutputPort::OutputPort(size_t buffer_bytes) : buffer_bytes_(std::max<size_t>(buffer_bytes, 1)) {
+    buffer_.reserve(buffer_bytes_);
+}
+
+void OutputPort::Write(std::string_view text) {
+    if (buffer_.size() + text.size() < buffer_bytes_) {
+        buffer_ += text;
+    } else if (text.size() < buffer_bytes_) {
+        buffer_ += text;
+        Drain({});
+    } else {
+        Drain(text);
+    }
+}
+
+bool OutputPort::Flush() {
+    if (!buffer_.empty()) {
+        Drain({});
+    }
+    return !failed_;
+}
+
+FileOutputPort::FileOutputPort(int fd, size_t buffer_bytes) : OutputPort(buffer_bytes), fd_(fd) {
+}
+
+FileOutputPort::~FileOutputPort() {
+    Flush();
+}
+
+void FileOutputPort::Drain(std::string_view extra) {
+    iovec parts[] = {{buffer_.data(), buffer_.size()},
+                     {const_cast<char*>(extra.data()), extra.size()}};
+    iovec* part = parts;
+    iovec* end = parts + 2;
+    while (!failed_) {
+        while (part != end && part->iov_len == 0) {
+            ++part;
+        }
+        if (part == end) {
+            break;
+        }
+        ssize_t written = ::writev(fd_, part, end - part);
+        if (written < 0) {
+            failed_ = errno != EINTR;
+            continue;
+        }
+        for (; written > 0; ++part) {
+            size_t step = std::min<size_t>(written, part->iov_len);
+            part->iov_base = static_cast<char*>(part->iov_base) + step;
+            part->iov_len -= step;
+            written -= step;
+            if (part->iov_len != 0) {
+                break;
+            }
+        }
+    }
+    buffer_.clear();
+}
+
+StringOutputPort::StringOutputPort(size_t buffer_bytes) : OutputPort(buffer_bytes) {
+}
+
+std::string StringOutputPort::GetString() const {
+    std::string result;
+    result.reserve(GetSize());
+    for (const std::string& block : blocks_) {
+        result += block;
+    }
+    result += buffer_;
+    return result;
+}
+
+size_t StringOutputPort::GetSize() const {
+    return block_bytes_ + buffer_.size();
+}
+
+void StringOutputPort::Clear() {
+    blocks_.clear();
+    block_bytes_ = 0;
+    buffer_.clear();
+}
+
+void StringOutputPort::Drain(std::string_view extra) {
+    block_bytes_ += buffer_.size() + extra.size();
+    blocks_.push_back(std::move(buffer_));
+    buffer_.clear();
+    buffer_.reserve(buffer_bytes_);
+    if (!extra.empty()) {
+        blocks_.emplace_back(extra);
+    }
+}
+
+Expected<std::unique_ptr<InputPort>> InputPort::Open(const std::string& path,
+                                                     const InputPortOptions& options) {
+    if (options.map) {
+        auto file = MappedFile::Open(path);
+        if (!file) {
+            return file.GetError();
+        }
+        return std::unique_ptr<InputPort>(new InputPort(-1, std::move(*file), options));
+    }
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return Error{ErrorKind::kRuntime, path + ": " + std::strerror(errno)};
+    }
+    return std::unique_ptr<InputPort>(new InputPort(fd, std::nullopt, options));
+}
+
+InputPort::InputPort(int fd, std::optional<MappedFile> file, const InputPortOptions& options)
+    : fd_(fd), file_(std::move(file)), options_(options) {
+    options_.buffer_bytes = std::max<size_t>(options_.buffer_bytes, 1);
+    if (file_) {
+        window_ = file_->GetBytes();
+        eof_ = true;
+    }
+}
+
+InputPort::~InputPort() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool InputPort::Read(Ref<Object>* datum) {
+    size_t begin;
+    size_t end;
+    while (!error_ && !FindDatum(window_, position_, eof_, &begin, &end)) {
+        Refill();
+    }
+    if (error_ || begin == end) {
+        return false;
+    }
+
+    session_.Reset(window_.substr(begin, end - begin));
+    auto read = TryRead(session_.GetTokenizer(), options_.max_depth);
+    if (!read) {
+        error_ = read.GetError();
+        error_->offset += window_offset_ + begin;
+        return false;
+    }
+    *datum = std::move(*read);
+    position_ = end;
+    if (file_ && position_ - released_ >= kReleaseBytes) {
+        file_->Release(position_);
+        released_ = position_;
+    }
+    return true;
+}
+
+bool InputPort::AtEnd() {
+    while (!error_) {
+        while (position_ < window_.size() && IsSpace(window_[position_])) {
+            ++position_;
+        }
+        if (position_ < window_.size()) {
+            return false;
+        }
+        if (eof_) {
+            return true;
+        }
+        Refill();
+    }
+    return false;
+}
+
+const Error* InputPort::GetError() const {
+    return error_ ? &*error_ : nullptr;
+}
+
+// Reads at least a buffer's worth, and as much as is kept when that is more, so that a datum
+// longer than the buffer is scanned a linear number of times.
+void InputPort::Refill() {
+    buffer_.erase(0, position_);
+    window_offset_ += position_;
+    position_ = 0;
+
+    size_t size = buffer_.size();
+    size_t chunk = std::max(options_.buffer_bytes, size);
+    buffer_.resize(size + chunk);
+    ssize_t read;
+    do {
+        read = ::read(fd_, buffer_.data() + size, chunk);
+    } while (read < 0 && errno == EINTR);
+    if (read < 0) {
+        error_ = Error{ErrorKind::kRuntime, std::strerror(errno), window_offset_ + size};
+        read = 0;
+    }
+    buffer_.resize(size + read);
+    eof_ = read == 0;
+    window_ = buffer_;
+}
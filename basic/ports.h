@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "binary.h"
+#include "error.h"
+#include "object.h"
+#include "session.h"
+
+// Destination of display, write and newline. Text is collected in a user-space buffer and
+// handed on in large blocks once the buffer holds buffer_bytes: a FileOutputPort writes them to
+// a descriptor, a StringOutputPort keeps them. Text too large for the buffer goes along with
+// what is buffered in the same step instead of being copied in.
+//
+// A port is used by one thread at a time; interpreters sharing one must take turns.
+class OutputPort {
+public:
+    explicit OutputPort(size_t buffer_bytes);
+    virtual ~OutputPort() = default;
+
+    OutputPort(const OutputPort&) = delete;
+    OutputPort& operator=(const OutputPort&) = delete;
+
+    // The printer appends to the buffer in place and calls Commit() once done.
+    std::string* GetBuffer() {
+        return &buffer_;
+    }
+
+    void Commit() {
+        if (buffer_.size() >= buffer_bytes_) {
+            Drain({});
+        }
+    }
+
+    void Write(std::string_view text);
+
+    // Hands on what is buffered. Returns false if the port failed to write, now or before.
+    bool Flush();
+
+protected:
+    // Passes the buffer and then extra on, leaving the buffer empty.
+    virtual void Drain(std::string_view extra) = 0;
+
+    std::string buffer_;
+    const size_t buffer_bytes_;
+    bool failed_ = false;
+};
+
+// Writes to a descriptor it does not own, one writev(2) per drain. The destructor flushes.
+class FileOutputPort final : public OutputPort {
+public:
+    explicit FileOutputPort(int fd, size_t buffer_bytes = 64 << 10);
+    ~FileOutputPort() override;
+
+private:
+    void Drain(std::string_view extra) override;
+
+    int fd_;
+};
+
+// Accumulates text in memory. Full buffers are kept as blocks rather than grown, so nothing is
+// copied again until GetString() joins them.
+class StringOutputPort final : public OutputPort {
+public:
+    explicit StringOutputPort(size_t buffer_bytes = 64 << 10);
+
+    std::string GetString() const;
+    size_t GetSize() const;
+    void Clear();
+
+private:
+    void Drain(std::string_view extra) override;
+
+    std::vector<std::string> blocks_;
+    size_t block_bytes_ = 0;
+};
+
+struct InputPortOptions {
+    // Bytes read from the file at a time. A datum that does not fit grows the buffer to its size.
+    size_t buffer_bytes = 64 << 10;
+    // Maps the file instead of reading it. Pages behind the datums read are handed back to the
+    // kernel as the port moves on.
+    bool map = false;
+    // Applies to every datum, see TryRead.
+    size_t max_depth = 0;
+};
+
+// Source of read: the datums of a file, one per Read. The port reads ahead a buffer at a time
+// and finds where the next datum ends before parsing it, so its memory follows the longest datum
+// rather than the size of the file. Datums are cut like DataLoader cuts them, so a quote
+// prefixes the datum after it and unbalanced parens end up in a datum the reader rejects.
+//
+// Datums are allocated on the calling thread like any other object, in the collected heap when
+// one is current.
+class InputPort {
+public:
+    static Expected<std::unique_ptr<InputPort>> Open(const std::string& path,
+                                                     const InputPortOptions& options = {});
+    ~InputPort();
+
+    InputPort(const InputPort&) = delete;
+    InputPort& operator=(const InputPort&) = delete;
+
+    // Moves the next datum into *datum. Returns false at the end of the file and once a datum
+    // fails to read or parse, see GetError.
+    bool Read(Ref<Object>* datum);
+
+    // Whether only whitespace is left, reading ahead as far as needed to tell.
+    bool AtEnd();
+
+    // The error that stopped the port, with its offset in the file.
+    const Error* GetError() const;
+
+private:
+    InputPort(int fd, std::optional<MappedFile> file, const InputPortOptions& options);
+
+    // Reads more of the file into the window, keeping the bytes from the cursor on.
+    void Refill();
+
+    int fd_;
+    std::optional<MappedFile> file_;
+    InputPortOptions options_;
+    std::string buffer_;
+    // The bytes at hand, of buffer_ or of the mapping, and where they are in the file.
+    std::string_view window_;
+    size_t window_offset_ = 0;
+    size_t position_ = 0;
+    size_t released_ = 0;
+    bool eof_ = false;
+    std::optional<Error> error_;
+    Session session_;
+};
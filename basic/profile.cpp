@@ -0,0 +1,191 @@
+#include "profile.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace {
+constexpr std::string_view kOtherBuiltins = "(other)";
+// Lists longer than this all land in the last bucket, no need to walk them further.
+constexpr uint64_t kMaxCountedLength = uint64_t{1} << (kProfileBuckets - 2);
+
+uint64_t ReadCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+size_t GetBucket(uint64_t value) {
+    return std::min<size_t>(std::bit_width(value), kProfileBuckets - 1);
+}
+
+// Cells of a list; an improper tail counts as one more element.
+uint64_t CountElements(const Object* list) {
+    uint64_t count = 0;
+    while (list != nullptr && count < kMaxCountedLength) {
+        ++count;
+        if (!Is<Cell>(list)) {
+            break;
+        }
+        list = static_cast<const Cell*>(list)->GetSecond().Get();
+    }
+    return count;
+}
+
+std::string FormatBucket(size_t bucket) {
+    uint64_t start = Profile::GetBucketStart(bucket);
+    if (bucket + 1 == kProfileBuckets) {
+        return std::to_string(start) + "+";
+    }
+    uint64_t end = Profile::GetBucketStart(bucket + 1) - 1;
+    return start == end ? std::to_string(start) : std::to_string(start) + "-" + std::to_string(end);
+}
+
+void AppendHistogram(const char* label, const std::array<uint64_t, kProfileBuckets>& counts,
+                     std::string* out) {
+    *out += "  ";
+    *out += label;
+    for (size_t i = 0; i < kProfileBuckets; ++i) {
+        if (counts[i] != 0) {
+            *out += ' ' + FormatBucket(i) + ':' + std::to_string(counts[i]);
+        }
+    }
+    *out += '\n';
+}
+
+void AppendJsonArray(const std::array<uint64_t, kProfileBuckets>& counts, std::string* out) {
+    *out += '[';
+    for (size_t i = 0; i < kProfileBuckets; ++i) {
+        *out += (i == 0 ? "" : ", ") + std::to_string(counts[i]);
+    }
+    *out += ']';
+}
+
+void AppendJsonString(std::string_view value, std::string* out) {
+    *out += '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            *out += '\\';
+        }
+        *out += c;
+    }
+    *out += '"';
+}
+}  // namespace
+
+uint64_t Profile::GetBucketStart(size_t bucket) {
+    return bucket == 0 ? 0 : uint64_t{1} << (bucket - 1);
+}
+
+std::string Profile::ToText() const {
+    std::chrono::nanoseconds total{0};
+    for (const BuiltinProfile& builtin : builtins) {
+        total += builtin.exclusive;
+    }
+
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-16s %12s %12s %12s %7s\n", "builtin", "calls", "incl ms",
+                  "excl ms", "excl %");
+    std::string out = line;
+    for (const BuiltinProfile& builtin : builtins) {
+        double share = total.count() > 0 ? 100.0 * builtin.exclusive.count() / total.count() : 0;
+        std::snprintf(line, sizeof(line), "%-16s %12llu %12.3f %12.3f %7.1f\n",
+                      builtin.name.c_str(), static_cast<unsigned long long>(builtin.calls),
+                      builtin.inclusive.count() / 1e6, builtin.exclusive.count() / 1e6, share);
+        out += line;
+        AppendHistogram("arguments", builtin.argument_counts, &out);
+        if (builtin.list_lengths != decltype(builtin.list_lengths){}) {
+            AppendHistogram("lists    ", builtin.list_lengths, &out);
+        }
+    }
+    return out;
+}
+
+std::string Profile::ToJson() const {
+    std::string out = "{\"bucket_starts\": [";
+    for (size_t i = 0; i < kProfileBuckets; ++i) {
+        out += (i == 0 ? "" : ", ") + std::to_string(GetBucketStart(i));
+    }
+    out += "], \"builtins\": [";
+    for (size_t i = 0; i < builtins.size(); ++i) {
+        const BuiltinProfile& builtin = builtins[i];
+        out += i == 0 ? "{\"name\": " : ", {\"name\": ";
+        AppendJsonString(builtin.name, &out);
+        out += ", \"calls\": " + std::to_string(builtin.calls);
+        out += ", \"inclusive_ns\": " + std::to_string(builtin.inclusive.count());
+        out += ", \"exclusive_ns\": " + std::to_string(builtin.exclusive.count());
+        out += ", \"argument_counts\": ";
+        AppendJsonArray(builtin.argument_counts, &out);
+        out += ", \"list_lengths\": ";
+        AppendJsonArray(builtin.list_lengths, &out);
+        out += '}';
+    }
+    return out + "]}";
+}
+
+Profiler::Profiler() : start_cycles_(ReadCycles()), start_time_(std::chrono::steady_clock::now()) {
+}
+
+void Profiler::Enter() {
+    frames_.push_back({.start = ReadCycles()});
+}
+
+void Profiler::Leave(std::string_view builtin, const Object* arguments, const Object* result) {
+    uint64_t cycles = ReadCycles() - frames_.back().start;
+    uint64_t children = frames_.back().children;
+    frames_.pop_back();
+    if (!frames_.empty()) {
+        frames_.back().children += cycles;
+    }
+
+    Counters* counters = GetCounters(builtin);
+    ++counters->calls;
+    counters->inclusive_cycles += cycles;
+    counters->exclusive_cycles += cycles - std::min(children, cycles);
+    ++counters->argument_counts[GetBucket(CountElements(arguments))];
+    if (Is<Cell>(result)) {
+        ++counters->list_lengths[GetBucket(CountElements(result))];
+    }
+}
+
+Profiler::Counters* Profiler::GetCounters(std::string_view builtin) {
+    if (auto it = builtins_.find(builtin); it != builtins_.end()) {
+        return &it->second;
+    }
+    if (builtins_.size() + 1 >= kMaxBuiltins) {
+        builtin = kOtherBuiltins;
+    }
+    return &builtins_.try_emplace(std::string(builtin)).first->second;
+}
+
+Profile Profiler::GetProfile() const {
+    uint64_t cycles = ReadCycles() - start_cycles_;
+    auto elapsed = std::chrono::steady_clock::now() - start_time_;
+    double ns_per_cycle =
+        cycles > 0 ? std::chrono::duration<double, std::nano>(elapsed).count() / cycles : 1;
+    auto to_ns = [ns_per_cycle](uint64_t count) {
+        return std::chrono::nanoseconds(static_cast<int64_t>(count * ns_per_cycle));
+    };
+
+    Profile profile;
+    for (const auto& [name, counters] : builtins_) {
+        profile.builtins.push_back({.name = name,
+                                    .calls = counters.calls,
+                                    .inclusive = to_ns(counters.inclusive_cycles),
+                                    .exclusive = to_ns(counters.exclusive_cycles),
+                                    .argument_counts = counters.argument_counts,
+                                    .list_lengths = counters.list_lengths});
+    }
+    std::sort(profile.builtins.begin(), profile.builtins.end(),
+              [](const BuiltinProfile& lhs, const BuiltinProfile& rhs) {
+                  return lhs.exclusive != rhs.exclusive ? lhs.exclusive > rhs.exclusive
+                                                        : lhs.name < rhs.name;
+              });
+    return profile;
+}
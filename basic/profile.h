@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "object.h"
+
+// Set to 0 by the SCHEME_PROFILING CMake option to leave the profiler out of Evaluate.
+#ifndef SCHEME_PROFILING
+#define SCHEME_PROFILING 1
+#endif
+
+inline constexpr bool kProfilingBuilt = SCHEME_PROFILING;
+
+// Histograms count zero in bucket 0 and values in [2^(i-1), 2^i) in bucket i; the last bucket
+// takes everything above.
+inline constexpr size_t kProfileBuckets = 17;
+
+struct BuiltinProfile {
+    std::string name;
+    uint64_t calls = 0;
+    // Inclusive time counts the arguments the builtin evaluated, exclusive time does not. A
+    // builtin nested in itself counts the inner call twice towards its inclusive time.
+    std::chrono::nanoseconds inclusive{0};
+    std::chrono::nanoseconds exclusive{0};
+    std::array<uint64_t, kProfileBuckets> argument_counts{};
+    // Lengths of the lists the builtin returned.
+    std::array<uint64_t, kProfileBuckets> list_lengths{};
+};
+
+struct Profile {
+    // Smallest value of a histogram bucket.
+    static uint64_t GetBucketStart(size_t bucket);
+
+    std::string ToText() const;
+    std::string ToJson() const;
+
+    // Largest exclusive time first.
+    std::vector<BuiltinProfile> builtins;
+};
+
+// Per-builtin counters of one interpreter, fed by Evaluate around every call. Time is read from
+// the time-stamp counter and converted to nanoseconds with the rate observed since the profiler
+// was created.
+class Profiler {
+public:
+    Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    void Enter();
+    void Leave(std::string_view builtin, const Object* arguments, const Object* result);
+
+    Profile GetProfile() const;
+
+private:
+    // Calls to names past this many distinct ones are counted together, so programs calling
+    // arbitrary undefined symbols cannot grow the table.
+    static constexpr size_t kMaxBuiltins = 256;
+
+    struct Counters {
+        uint64_t calls = 0;
+        uint64_t inclusive_cycles = 0;
+        uint64_t exclusive_cycles = 0;
+        std::array<uint64_t, kProfileBuckets> argument_counts{};
+        std::array<uint64_t, kProfileBuckets> list_lengths{};
+    };
+
+    struct Frame {
+        uint64_t start = 0;
+        uint64_t children = 0;
+    };
+
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const {
+            return std::hash<std::string_view>()(name);
+        }
+    };
+
+    Counters* GetCounters(std::string_view builtin);
+
+    std::unordered_map<std::string, Counters, NameHash, std::equal_to<>> builtins_;
+    std::vector<Frame> frames_;
+    uint64_t start_cycles_;
+    std::chrono::steady_clock::time_point start_time_;
+};
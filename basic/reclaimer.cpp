@@ -0,0 +1,165 @@
+#include "reclaimer.h"
+
+#include <utility>
+#include <vector>
+
+namespace {
+thread_local std::vector<const Object*> release_queue;
+thread_local bool releasing = false;
+
+class ChildReleaser : public ObjectVisitor {
+public:
+    void Visit(Ref<Object>& slot) override {
+        Object* child = slot.Detach();
+        if (child != nullptr && child->DropRef()) {
+            release_queue.push_back(child);
+        }
+    }
+};
+}  // namespace
+
+void Object::Destroy(const Object* object) {
+    release_queue.push_back(object);
+    if (releasing) {
+        return;
+    }
+
+    releasing = true;
+    ChildReleaser releaser;
+    while (!release_queue.empty()) {
+        Object* current = const_cast<Object*>(release_queue.back());
+        release_queue.pop_back();
+        current->VisitChildren(&releaser);
+        delete current;
+    }
+    releasing = false;
+}
+
+Reclaimer::Reclaimer() : thread_([this] { Work(); }) {
+}
+
+Reclaimer::~Reclaimer() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    has_work_.notify_one();
+    thread_.join();
+}
+
+Reclaimer::Account::Account(Reclaimer* reclaimer, uint64_t id) : reclaimer_(reclaimer), id_(id) {
+}
+
+Reclaimer::Account::~Account() {
+    Close();
+}
+
+Reclaimer::Account::Account(Account&& other) noexcept
+    : reclaimer_(std::exchange(other.reclaimer_, nullptr)), id_(std::exchange(other.id_, 0)) {
+}
+
+Reclaimer::Account& Reclaimer::Account::operator=(Account&& other) noexcept {
+    if (this != &other) {
+        Close();
+        reclaimer_ = std::exchange(other.reclaimer_, nullptr);
+        id_ = std::exchange(other.id_, 0);
+    }
+    return *this;
+}
+
+void Reclaimer::Account::Retire(Ref<Object> graph) {
+    if (reclaimer_ != nullptr) {
+        reclaimer_->Enqueue(std::move(graph), id_);
+    }
+}
+
+void Reclaimer::Account::Settle() {
+    if (reclaimer_ == nullptr) {
+        return;
+    }
+    std::lock_guard lock(reclaimer_->mutex_);
+    Freed& freed = reclaimer_->freed_[id_];
+    for (size_t i = 0; i < kObjectTypeCount; ++i) {
+        allocation_counters.types[i].live -= std::exchange(freed.live[i], 0);
+    }
+    allocation_counters.live_bytes -= std::exchange(freed.live_bytes, 0);
+}
+
+void Reclaimer::Account::Close() {
+    if (reclaimer_ != nullptr) {
+        std::lock_guard lock(reclaimer_->mutex_);
+        reclaimer_->freed_.erase(id_);
+        reclaimer_ = nullptr;
+    }
+}
+
+Reclaimer::Account Reclaimer::OpenAccount() {
+    std::lock_guard lock(mutex_);
+    uint64_t id = next_account_++;
+    freed_.emplace(id, Freed{});
+    return Account(this, id);
+}
+
+void Reclaimer::Retire(Ref<Object> graph) {
+    Enqueue(std::move(graph), 0);
+}
+
+void Reclaimer::Enqueue(Ref<Object> graph, uint64_t account) {
+    if (graph == nullptr) {
+        return;
+    }
+    {
+        std::lock_guard lock(mutex_);
+        queue_.push_back({graph.Detach(), account});
+        ++retired_count_;
+    }
+    has_work_.notify_one();
+}
+
+void Reclaimer::Flush() {
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [this] { return queue_.empty() && !busy_; });
+}
+
+size_t Reclaimer::GetRetiredCount() const {
+    std::lock_guard lock(mutex_);
+    return retired_count_;
+}
+
+void Reclaimer::Work() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+        has_work_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            return;
+        }
+
+        Retired retired = queue_.front();
+        queue_.pop_front();
+        busy_ = true;
+        lock.unlock();
+
+        // The releases are counted on this thread, then moved over to the account.
+        AllocationCounters before = allocation_counters;
+        retired.graph->DecRef();
+        Freed freed;
+        for (size_t i = 0; i < kObjectTypeCount; ++i) {
+            freed.live[i] = before.types[i].live - allocation_counters.types[i].live;
+            allocation_counters.types[i].live = before.types[i].live;
+        }
+        freed.live_bytes = before.live_bytes - allocation_counters.live_bytes;
+        allocation_counters.live_bytes = before.live_bytes;
+
+        lock.lock();
+        if (auto it = freed_.find(retired.account); it != freed_.end()) {
+            for (size_t i = 0; i < kObjectTypeCount; ++i) {
+                it->second.live[i] += freed.live[i];
+            }
+            it->second.live_bytes += freed.live_bytes;
+        }
+        busy_ = false;
+        if (queue_.empty()) {
+            idle_.notify_all();
+        }
+    }
+}
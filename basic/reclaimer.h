@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "allocation.h"
+#include "object.h"
+
+// Objects are destroyed through a per-thread release queue: when the last reference to an object
+// goes away, its children are unlinked and queued instead of being released recursively, so
+// dropping a long list takes constant stack.
+//
+// Reclaimer moves that work off the calling thread. Retired graphs are destroyed on a background
+// thread, so handing over a large result costs the same as handing over a small one. A graph
+// must be retired as a whole: since counters are not atomic, no other reference into it may stay
+// on the retiring thread. Shared graphs (see Share()) are fine either way.
+//
+// What a graph frees is not counted against the reclaimer's thread. Graphs retired through an
+// Account have it counted there instead, until the account is settled on the thread whose
+// counts should come down; interpreters settle theirs at the start of every run. Until then
+// the graph shows as live. Graphs retired directly are not counted anywhere.
+class Reclaimer {
+public:
+    // Frees counted for one owner, such as an interpreter. Accounts are never reused, so counts
+    // that arrive after an account is closed are dropped rather than picked up by another.
+    class Account {
+    public:
+        Account() = default;
+        ~Account();
+
+        Account(Account&& other) noexcept;
+        Account& operator=(Account&& other) noexcept;
+
+        // Does nothing on an account that is not open.
+        void Retire(Ref<Object> graph);
+
+        // Takes what was freed so far off the live counts of the calling thread.
+        void Settle();
+
+    private:
+        friend class Reclaimer;
+
+        Account(Reclaimer* reclaimer, uint64_t id);
+        void Close();
+
+        Reclaimer* reclaimer_ = nullptr;
+        uint64_t id_ = 0;
+    };
+
+    Reclaimer();
+    ~Reclaimer();
+
+    Reclaimer(const Reclaimer&) = delete;
+    Reclaimer& operator=(const Reclaimer&) = delete;
+
+    // The account must be closed before the reclaimer goes away.
+    Account OpenAccount();
+
+    void Retire(Ref<Object> graph);
+
+    // Blocks until every graph retired so far is destroyed.
+    void Flush();
+
+    size_t GetRetiredCount() const;
+
+private:
+    struct Retired {
+        Object* graph;
+        // Zero when retired directly.
+        uint64_t account;
+    };
+
+    struct Freed {
+        std::array<int64_t, kObjectTypeCount> live = {};
+        int64_t live_bytes = 0;
+    };
+
+    void Enqueue(Ref<Object> graph, uint64_t account);
+    void Work();
+
+    mutable std::mutex mutex_;
+    std::condition_variable has_work_;
+    std::condition_variable idle_;
+    std::deque<Retired> queue_;
+    // One entry per open account.
+    std::unordered_map<uint64_t, Freed> freed_;
+    uint64_t next_account_ = 1;
+    size_t retired_count_ = 0;
+    bool busy_ = false;
+    bool stop_ = false;
+    std::thread thread_;
+};
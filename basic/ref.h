@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// Intrusive reference-counting handle. T must provide IncRef() and DecRef() const methods,
+// DecRef() being responsible for destroying the object when the last reference goes away.
+// Unlike std::shared_ptr the counter lives inside the object, so a raw pointer can always be
+// turned back into an owning Ref.
+template <class T>
+class Ref {
+public:
+    Ref() = default;
+
+    Ref(std::nullptr_t) {
+    }
+
+    explicit Ref(T* ptr) : ptr_(ptr) {
+        if (ptr_ != nullptr) {
+            ptr_->IncRef();
+        }
+    }
+
+    Ref(const Ref& other) : Ref(other.ptr_) {
+    }
+
+    Ref(Ref&& other) noexcept : ptr_(std::exchange(other.ptr_, nullptr)) {
+    }
+
+    template <class U, class = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    Ref(const Ref<U>& other) : Ref(other.Get()) {
+    }
+
+    template <class U, class = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    Ref(Ref<U>&& other) noexcept : ptr_(other.Detach()) {
+    }
+
+    ~Ref() {
+        if (ptr_ != nullptr) {
+            ptr_->DecRef();
+        }
+    }
+
+    Ref& operator=(const Ref& other) {
+        Ref(other).Swap(*this);
+        return *this;
+    }
+
+    Ref& operator=(Ref&& other) noexcept {
+        Ref(std::move(other)).Swap(*this);
+        return *this;
+    }
+
+    Ref& operator=(std::nullptr_t) {
+        Reset();
+        return *this;
+    }
+
+    void Reset() {
+        Ref().Swap(*this);
+    }
+
+    void Swap(Ref& other) noexcept {
+        std::swap(ptr_, other.ptr_);
+    }
+
+    // Gives up ownership without touching the counter.
+    T* Detach() {
+        return std::exchange(ptr_, nullptr);
+    }
+
+    T* Get() const {
+        return ptr_;
+    }
+
+    T* operator->() const {
+        return ptr_;
+    }
+
+    T& operator*() const {
+        return *ptr_;
+    }
+
+    explicit operator bool() const {
+        return ptr_ != nullptr;
+    }
+
+    bool operator==(std::nullptr_t) const {
+        return ptr_ == nullptr;
+    }
+
+    template <class U>
+    bool operator==(const Ref<U>& other) const {
+        return ptr_ == other.Get();
+    }
+
+private:
+    T* ptr_ = nullptr;
+};
+
+template <class T, class... Args>
+Ref<T> MakeRef(Args&&... args) {
+    return Ref<T>(new T(std::forward<Args>(args)...));
+}
@@ -1,17 +1,273 @@
+// Script runner: evaluates the top-level forms of FILE, or of stdin when FILE is missing or "-",
+// one after another in a single interpreter, and prints the result of each on a line of its own.
+// Results that print as nothing, such as those of display and newline, take no line.
+//
+//   scheme [FILE] [--queue N] [--chunk-bytes N] [--input DATA] [--map-input]
+//
+// Forms are read and parsed on a second thread and handed over through a queue of --queue
+// forms, 4096 by default, so the next forms are parsed while the current one is evaluated.
+// Regular files, stdin included, are mapped; other input is read --chunk-bytes at a time, 1 MiB
+// by default, and parsed up to its last complete form. Results and what the forms display share
+// one output port on stdout, which goes out in one write(2) when its 1 MiB buffer fills up and
+// at the end, and for streamed input also whenever the queue runs dry, so that an interactive
+// session sees its results.
+//
+// --input opens DATA as the port read takes its datums from, reading it a buffer at a time or,
+// with --map-input, through a mapping.
+//
+// A form that fails to evaluate is reported on stderr and the run goes on with the next one; a
+// form that does not parse ends the run. The exit status is 1 if any form failed.
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "../data_loader.h"
 #include "../scheme.h"
-#include <sstream>
+#include "../spsc_queue.h"
+
+namespace {
+
+struct Options {
+    std::string path = "-";
+    size_t queue = 4096;
+    size_t chunk_bytes = 1 << 20;
+    std::string input_path;
+    bool map_input = false;
+};
+
+using FormQueue = SpscQueue<Ref<Object>>;
+
+// Parses all of text as a decimal number.
+bool ParseSize(std::string_view text, size_t* value) {
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), *value);
+    return error == std::errc() && end == text.data() + text.size();
+}
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+    bool has_path = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--queue" && has_value) {
+            if (!ParseSize(argv[++i], &options->queue)) {
+                return false;
+            }
+        } else if (arg == "--chunk-bytes" && has_value) {
+            if (!ParseSize(argv[++i], &options->chunk_bytes)) {
+                return false;
+            }
+        } else if (arg == "--input" && has_value) {
+            options->input_path = argv[++i];
+        } else if (arg == "--map-input") {
+            options->map_input = true;
+        } else if (!has_path && (arg == "-" || !arg.starts_with("--"))) {
+            options->path = arg;
+            has_path = true;
+        } else {
+            return false;
+        }
+    }
+    return options->chunk_bytes > 0;
+}
+
+bool IsSpace(char ch) {
+    return ch == ' ' || ch == '\n' || ch == '\t' || ch == '\r' || ch == '\f' || ch == '\v';
+}
+
+// Finds the longest prefix of a growing buffer that ends between two top-level forms, so that a
+// form cut off by the end of a read is left for the next one. An atom counts as complete once a
+// space follows it, a list once it is closed; a quote belongs to the form after it. Each call
+// goes on from where the last one stopped, so a form spanning many reads is scanned once.
+class BoundaryFinder {
+public:
+    // Returns the length of the prefix. text is the buffer passed last time, with more appended
+    // and without the bytes dropped since.
+    size_t FindLast(std::string_view text) {
+        for (; scanned_ < text.size(); ++scanned_) {
+            char ch = text[scanned_];
+            if (ch == '(') {
+                ++depth_;
+            } else if (ch == ')') {
+                // An unbalanced paren is a form of its own, which the reader rejects.
+                if (--depth_ <= 0) {
+                    depth_ = 0;
+                    boundary_ = scanned_ + 1;
+                }
+            } else if (depth_ == 0 && IsSpace(ch) && !IsSpace(last_) && last_ != '\'') {
+                boundary_ = scanned_;
+            }
+            if (depth_ == 0 && !IsSpace(ch)) {
+                last_ = ch;
+            }
+        }
+        return boundary_;
+    }
+
+    // The buffer lost its first bytes, at most up to the last boundary found.
+    void Drop(size_t bytes) {
+        scanned_ -= bytes;
+        boundary_ -= bytes;
+    }
+
+private:
+    size_t scanned_ = 0;
+    size_t boundary_ = 0;
+    int64_t depth_ = 0;
+    char last_ = ' ';
+};
+
+// Pushes the forms of text, which starts at offset in the input. Returns false on the first
+// form that does not parse.
+bool PushForms(std::string_view text, size_t offset, FormQueue* queue,
+               std::optional<Error>* error) {
+    DataLoader loader(text, nullptr);
+    for (Ref<Object> form; loader.Next(&form);) {
+        queue->Push(std::move(form));
+    }
+    if (loader.GetError() != nullptr) {
+        *error = *loader.GetError();
+        (*error)->offset += offset;
+        return false;
+    }
+    return true;
+}
+
+// Reads input that cannot be mapped, such as a pipe, a chunk at a time.
+void PushStream(int fd, size_t chunk_bytes, FormQueue* queue, std::optional<Error>* error) {
+    std::string buffer;
+    BoundaryFinder finder;
+    size_t offset = 0;
+    while (true) {
+        size_t size = buffer.size();
+        buffer.resize(size + chunk_bytes);
+        ssize_t read;
+        do {
+            read = ::read(fd, buffer.data() + size, chunk_bytes);
+        } while (read < 0 && errno == EINTR);
+        if (read < 0) {
+            *error = Error{ErrorKind::kRuntime, std::string("stdin: ") + std::strerror(errno)};
+            return;
+        }
+        buffer.resize(size + read);
+        if (read == 0) {
+            PushForms(buffer, offset, queue, error);
+            return;
+        }
+
+        size_t boundary = finder.FindLast(buffer);
+        if (!PushForms(std::string_view(buffer).substr(0, boundary), offset, queue, error)) {
+            return;
+        }
+        queue->Notify();
+        buffer.erase(0, boundary);
+        finder.Drop(boundary);
+        offset += boundary;
+    }
+}
+
+// Pipes and terminals are streamed, anything else is mapped.
+bool IsStreamed(const Options& options) {
+    struct stat status;
+    return options.path == "-" &&
+           (::fstat(STDIN_FILENO, &status) != 0 || !S_ISREG(status.st_mode));
+}
+
+void PushInput(const Options& options, FormQueue* queue, std::optional<Error>* error) {
+    if (IsStreamed(options)) {
+        PushStream(STDIN_FILENO, options.chunk_bytes, queue, error);
+        return;
+    }
+    auto file = MappedFile::Open(options.path == "-" ? "/dev/stdin" : options.path);
+    if (!file) {
+        *error = file.GetError();
+        return;
+    }
+    PushForms(file->GetBytes(), 0, queue, error);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    static constexpr const char* kErrorNames[] = {"SyntaxError", "RuntimeError", "NameError",
+                                                  "LimitError"};
+
+    Options options;
+    if (!ParseOptions(argc, argv, &options)) {
+        std::cerr << "usage: scheme [FILE] [--queue N] [--chunk-bytes N] [--input DATA] "
+                     "[--map-input]\n";
+        return 2;
+    }
+    std::unique_ptr<InputPort> input;
+    if (!options.input_path.empty()) {
+        auto opened = InputPort::Open(options.input_path, {.map = options.map_input});
+        if (!opened) {
+            std::cerr << "scheme: " << opened.GetError().message << '\n';
+            return 1;
+        }
+        input = std::move(*opened);
+    }
 
-int main() {
-    std::string input = "(1 333 23 12 22)";
-    std::stringstream ss{input};
-    Tokenizer tokenizer(&ss);
-    std::shared_ptr<Object> head = Read(&tokenizer);
-    Interpreter interp;
-    std::vector<int> int_vec = interp.ToIntVector(As<Cell>(head));
+    // Streamed input may be typed in, so its results go out whenever the reader falls behind.
+    bool streamed = IsStreamed(options);
+    FormQueue queue(options.queue);
+    // Written by the reader before it closes the queue.
+    std::optional<Error> read_error;
+    std::jthread reader([&] {
+        PushInput(options, &queue, &read_error);
+        queue.Close();
+    });
 
-    for (int a : int_vec) {
-        std::cout << a << ' ';
+    FileOutputPort output(STDOUT_FILENO, 1 << 20);
+    Interpreter interpreter;
+    interpreter.SetOutputPort(&output);
+    interpreter.SetInputPort(input.get());
+    uint64_t forms = 0;
+    bool failed = false;
+    for (Ref<Object> form;;) {
+        if (!queue.TryPop(&form)) {
+            if (streamed) {
+                output.Flush();
+            }
+            if (!queue.Pop(&form)) {
+                break;
+            }
+        }
+        ++forms;
+        auto result = interpreter.TryRunProgram(std::move(form));
+        if (result && !result->empty()) {
+            output.Write(*result);
+            output.Write("\n");
+        } else if (!result) {
+            failed = true;
+            output.Flush();
+            const Error& error = result.GetError();
+            std::cerr << "scheme: form " << forms << ": "
+                      << kErrorNames[static_cast<int>(error.kind)] << ": " << error.message << '\n';
+        }
+    }
+
+    if (read_error && read_error->kind == ErrorKind::kRuntime) {
+        std::cerr << "scheme: " << read_error->message << '\n';
+        failed = true;
+    } else if (read_error) {
+        std::cerr << "scheme: " << (options.path == "-" ? "stdin" : options.path) << ": "
+                  << kErrorNames[static_cast<int>(read_error->kind)] << ": "
+                  << read_error->message << " at byte " << read_error->offset << '\n';
+        failed = true;
+    }
+    if (!output.Flush()) {
+        std::cerr << "scheme: write error\n";
+        failed = true;
     }
-    return 0;
+    return failed ? 1 : 0;
 }
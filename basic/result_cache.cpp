@@ -0,0 +1,25 @@
+#include "result_cache.h"
+
+namespace {
+// Counts the list node and the index entry along with the strings.
+constexpr size_t kEntryOverhead = 128;
+}  // namespace
+
+ResultCache::ResultCache(size_t max_bytes, size_t shard_count) : cache_(max_bytes, shard_count) {
+}
+
+bool ResultCache::Lookup(std::string_view key, std::string* out) {
+    return cache_.Lookup(key, [out](const std::string& result) { out->append(result); });
+}
+
+void ResultCache::Insert(std::string_view key, std::string_view result) {
+    cache_.Insert(key, std::string(result), key.size() + result.size() + kEntryOverhead);
+}
+
+void ResultCache::Clear() {
+    cache_.Clear();
+}
+
+ResultCacheStats ResultCache::GetStats() const {
+    return cache_.GetStats();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "lru_cache.h"
+
+using ResultCacheStats = CacheStats;
+
+// Printed results of earlier runs, keyed by the request's normalized token stream (see
+// Interpreter::SetResultCache). The least recently used entries are evicted to stay within
+// max_bytes. Interpreters on different threads can share one cache.
+class ResultCache {
+public:
+    explicit ResultCache(size_t max_bytes, size_t shard_count = 16);
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    // Appends the cached result for key to out; returns false on a miss.
+    bool Lookup(std::string_view key, std::string* out);
+
+    // Results that do not fit in a shard's share of the budget are not stored.
+    void Insert(std::string_view key, std::string_view result);
+
+    void Clear();
+
+    ResultCacheStats GetStats() const;
+
+private:
+    ShardedLruCache<std::string> cache_;
+};
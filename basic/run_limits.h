@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Bounds for a single run. Zero means unlimited. A run that hits one fails with LimitError.
+struct RunLimits {
+    // Calls evaluated.
+    uint64_t max_steps = 0;
+    // Bytes of objects allocated during the run, freed ones included. Checked every few steps
+    // and once the program has been read, so a run may overshoot it a little.
+    size_t max_bytes = 0;
+    // Bytes of objects alive at once beyond those alive when the run started, checked like
+    // max_bytes.
+    size_t max_live_bytes = 0;
+    // Nesting of lists being read and of calls being evaluated.
+    size_t max_depth = 0;
+};
+
+// Lets another thread stop a run. The run notices within a few dozen evaluation steps.
+class CancellationToken {
+public:
+    void Cancel() {
+        cancelled_.store(true, std::memory_order_relaxed);
+    }
+
+    void Reset() {
+        cancelled_.store(false, std::memory_order_relaxed);
+    }
+
+    bool IsCancelled() const {
+        return cancelled_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<bool> cancelled_ = false;
+};
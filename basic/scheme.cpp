@@ -1,15 +1,29 @@
 #include "scheme.h"
 #include "error.h"
 
-#include <memory>
-#include <sstream>
-#include <set>
-#include <functional>
+#include <charconv>
+#include <climits>
+#include <chrono>
+#include <cstdint>
 #include <map>
+#include <set>
 #include <cassert>
 #include <string>
 
 namespace {
+class ScratchGuard {
+public:
+    explicit ScratchGuard(Session* session) : session_(session) {
+    }
+
+    ~ScratchGuard() {
+        session_->ClearScratch();
+    }
+
+private:
+    Session* session_;
+};
+
 int Sum(const int a, const int b) {
     return a + b;
 }
@@ -43,43 +57,61 @@ bool LE(const int a, const int b) {
 bool EQ(const int a, const int b) {
     return a == b;
 }
-bool IsNumber(const std::shared_ptr<Object> object) {
+bool IsNumber(const Ref<Object>& object) {
     return Is<Number>(object);
 }
 int Abs(const int a) {
     return std::abs(a);
 }
-void PredicateCorrectnessCheck(const std::string& func_name, std::shared_ptr<Object> head) {
-    if (head == nullptr) {
-        throw RuntimeError("1 argument is expected for " + func_name);
-    }
-
-    if (!Is<Cell>(head)) {
-        throw RuntimeError("Invalid call for " + func_name);
-    }
-
-    if (As<Cell>(head)->GetSecond() != nullptr) {
-        throw RuntimeError("Too many arguments for " + func_name);
+// Whether operation would overflow int on a and b, which is undefined behavior.
+bool Overflows(Interpreter::Operation operation, const int a, const int b) {
+    int result;
+    if (operation == Sum) {
+        return __builtin_add_overflow(a, b, &result);
+    } else if (operation == Sub) {
+        return __builtin_sub_overflow(a, b, &result);
+    } else if (operation == Prod) {
+        return __builtin_mul_overflow(a, b, &result);
     }
+    return false;
+}
+void AppendNumber(const int value, std::string* out) {
+    char buffer[16];
+    auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out->append(buffer, end);
+}
+// What builtins run for their side effects return. The reader never produces an empty symbol.
+Ref<Symbol> MakeUnspecified() {
+    return MakeRef<Symbol>(std::string());
+}
+// What read returns at the end of its port. The tokenizer does not take '[' into a symbol.
+constexpr std::string_view kEofName = "#[eof]";
+bool IsEof(const Ref<Object>& object) {
+    Symbol* symbol = As<Symbol>(object);
+    return symbol != nullptr && symbol->GetName() == kEofName;
 }
 }  // namespace
 
-static const std::map<std::string, std::function<bool(int, int)>> kCompOperations = {
+static const std::map<std::string, Interpreter::Comparator> kCompOperations = {
     {">=", GEQ}, {">", GR}, {"<=", LEQ}, {"<", LE}, {"=", EQ}};
-static const std::map<std::string, std::function<int(int, int)>> kIntOperations = {
+static const std::map<std::string, Interpreter::Operation> kIntOperations = {
     {"+", Sum}, {"-", Sub}, {"*", Prod}, {"/", Div}, {"max", Max}, {"min", Min}};
+// Builtins with side effects or with results that depend on more than their arguments. An
+// expression naming one of them is never served from the result cache.
+static const std::set<std::string, std::less<>> kImpureBuiltins = {"display", "write", "newline",
+                                                                    "read"};
 
-std::shared_ptr<Object> Interpreter::GetAST(std::shared_ptr<Object> head) {
+Ref<Object> Interpreter::GetAST(const Ref<Object>& head) {
     if (head == nullptr) {
-        throw RuntimeError("Cannot call without command");
+        return Fail("Cannot call without command");
     }
 
     if (Is<Number>(head) || Is<Symbol>(head) || Is<Bool>(head)) {
         return head;
     }
 
-    if (Is<Quote>(head)) {
-        return As<Quote>(head)->next_;
+    if (Quote* quote = As<Quote>(head)) {
+        return quote->next_;
     }
 
     assert(Is<Cell>(head));
@@ -87,614 +119,1341 @@ std::shared_ptr<Object> Interpreter::GetAST(std::shared_ptr<Object> head) {
     return Evaluate(As<Cell>(head));
 }
 
-std::shared_ptr<Object> Interpreter::Evaluate(std::shared_ptr<Cell> head) {
+Ref<Object> Interpreter::Evaluate(Cell* head) {
+    if (steps_until_check_-- == 0 && !Refuel()) {
+        return nullptr;
+    }
+    if (depth_left_ == 0) {
+        return Fail("Evaluation is nested too deeply", ErrorKind::kLimit);
+    }
+
+    const Cell* caller = current_call_;
+    current_call_ = head;
+    --depth_left_;
+    Ref<Object> result = instrumented_ ? InstrumentedCall(head) : EvaluateCall(head);
+    ++depth_left_;
+    current_call_ = caller;
+    return result;
+}
+
+Ref<Object> Interpreter::EvaluateCall(Cell* head) {
     if (head == nullptr) {
-        throw RuntimeError("Cannot call without command");
+        return Fail("Cannot call without command");
     }
 
-    if (!Is<Symbol>(head->GetFirst())) {
-        throw RuntimeError("Cannot call without command");
+    Symbol* symbol = As<Symbol>(head->GetFirst());
+    if (symbol == nullptr) {
+        return Fail("Cannot call without command");
     }
 
-    std::string func_name = As<Symbol>(head->GetFirst())->GetName();
+    const std::string& func_name = symbol->GetName();
+    const Ref<Object>& arguments = head->GetSecond();
 
     if (auto cmp_iter = kCompOperations.find(func_name); cmp_iter != kCompOperations.end()) {
-        return CmpHandler(head->GetSecond(), kCompOperations.at(func_name));
+        return CmpHandler(arguments, cmp_iter->second);
     } else if (auto int_iter = kIntOperations.find(func_name); int_iter != kIntOperations.end()) {
-        return IntHandler(head->GetSecond(), kIntOperations.at(func_name));
+        return IntHandler(arguments, int_iter->second);
     } else if (func_name == "number?") {
-        return NumberHandler(head->GetSecond());
+        return NumberHandler(arguments);
     } else if (func_name == "abs") {
-        return AbsHandler(head->GetSecond());
+        return AbsHandler(arguments);
     } else if (func_name == "quote") {
-        if (!Is<Cell>(head->GetSecond())) {
-            throw RuntimeError("Invalid quote use");
+        Cell* quoted = As<Cell>(arguments);
+        if (quoted == nullptr) {
+            return Fail("Invalid quote use");
         }
 
-        if (As<Cell>(head->GetSecond())->GetSecond() != nullptr) {
-            throw RuntimeError("Invalid number of arguments for quote");
+        if (quoted->GetSecond() != nullptr) {
+            return Fail("Invalid number of arguments for quote");
         }
 
-        return As<Cell>(head->GetSecond())->GetFirst();
+        return quoted->GetFirst();
     } else if (func_name == "and") {
-        return AndHandler(head->GetSecond());
+        return AndHandler(arguments);
     } else if (func_name == "or") {
-        return OrHandler(head->GetSecond());
+        return OrHandler(arguments);
     } else if (func_name == "not") {
-        return NotHandler(head->GetSecond());
+        return NotHandler(arguments);
     } else if (func_name == "boolean?") {
-        return BooleanHandler(head->GetSecond());
+        return BooleanHandler(arguments);
     } else if (func_name == "pair?") {
-        return PairHandler(head->GetSecond());
+        return PairHandler(arguments);
     } else if (func_name == "null?") {
-        return NullHandler(head->GetSecond());
+        return NullHandler(arguments);
     } else if (func_name == "list?") {
-        return IsListHandler(head->GetSecond());
+        return IsListHandler(arguments);
     } else if (func_name == "cons") {
-        return ConsHandler(head->GetSecond());
+        return ConsHandler(arguments);
     } else if (func_name == "car") {
-        return CarHandler(head->GetSecond());
+        return CarHandler(arguments);
     } else if (func_name == "cdr") {
-        return CdrHandler(head->GetSecond());
+        return CdrHandler(arguments);
     } else if (func_name == "list") {
-        return ListHandler(head->GetSecond());
+        return ListHandler(arguments);
     } else if (func_name == "list-ref") {
-        return ListRefHandler(head->GetSecond());
+        return ListRefHandler(arguments);
     } else if (func_name == "list-tail") {
-        return ListTailHandler(head->GetSecond());
+        return ListTailHandler(arguments);
+    } else if (func_name == "display" || func_name == "write") {
+        return DisplayHandler(arguments, func_name);
+    } else if (func_name == "newline") {
+        return NewlineHandler(arguments);
+    } else if (func_name == "read") {
+        return ReadHandler(arguments);
+    } else if (func_name == "eof-object?") {
+        return EofObjectHandler(arguments);
     }
 
-    throw RuntimeError("passed through in Evaluate");
+    return Fail("passed through in Evaluate");
 }
 
-std::vector<int> Interpreter::ToIntVector(std::shared_ptr<Object> head) {
+Ref<Object> Interpreter::InstrumentedCall(Cell* head) {
+    Symbol* symbol = head != nullptr ? As<Symbol>(head->GetFirst()) : nullptr;
+    if (symbol == nullptr) {
+        return EvaluateCall(head);
+    }
+    if (profiler_ != nullptr) {
+        profiler_->Enter();
+    }
+    if (tracer_ != nullptr) {
+        tracer_->Begin(symbol->GetName(), head->GetSourceOffset());
+    }
+    Ref<Object> result = EvaluateCall(head);
+    if (tracer_ != nullptr) {
+        tracer_->End();
+    }
+    if (profiler_ != nullptr) {
+        profiler_->Leave(symbol->GetName(), head->GetSecond().Get(), result.Get());
+    }
+    return result;
+}
+
+// Keep in sync with EvaluateCall: a builtin is eager when its handler evaluates every argument
+// in order, so the arguments can be evaluated up front.
+Interpreter::ArgumentMode Interpreter::GetArgumentMode(const Cell* head) const {
+    const Symbol* symbol = As<Symbol>(head->GetFirst());
+    if (symbol == nullptr) {
+        return ArgumentMode::kDirect;
+    }
+
+    const std::string& func_name = symbol->GetName();
+    if (func_name == "and") {
+        return ArgumentMode::kAnd;
+    } else if (func_name == "or") {
+        return ArgumentMode::kOr;
+    } else if (kCompOperations.contains(func_name) || kIntOperations.contains(func_name) ||
+               func_name == "number?" || func_name == "abs" || func_name == "not" ||
+               func_name == "boolean?" || func_name == "pair?" || func_name == "null?" ||
+               func_name == "list?" || func_name == "cons" || func_name == "car" ||
+               func_name == "cdr" || func_name == "list-ref" || func_name == "list-tail" ||
+               func_name == "display" || func_name == "write" || func_name == "newline" ||
+               func_name == "read" || func_name == "eof-object?") {
+        return ArgumentMode::kEager;
+    }
+    return ArgumentMode::kDirect;
+}
+
+std::vector<int> Interpreter::ToIntVector(const Ref<Object>& head) {
+    std::vector<int>& scratch = session_.GetIntScratch();
+    failed_ = false;
+    size_t start = CollectInts(head);
+    ThrowIfFailed();
+    std::vector<int> result(scratch.begin() + start, scratch.end());
+    scratch.resize(start);
+    return result;
+}
+
+size_t Interpreter::CollectInts(const Ref<Object>& head) {
+    std::vector<int>& result = session_.GetIntScratch();
+    size_t start = result.size();
+
     if (head == nullptr) {
-        return {};
+        return start;
     }
 
     if (Is<Symbol>(head) || Is<Bool>(head)) {
-        throw RuntimeError("Should be only integers in arithmetic functions");
+        Fail("Should be only integers in arithmetic functions");
+        return start;
     }
 
-    if (Is<Quote>(head)) {
-        if (Is<Number>(As<Quote>(head)->next_)) {
-            return {As<Number>(As<Quote>(head)->next_)->GetValue()};
+    if (Quote* quote = As<Quote>(head)) {
+        if (Number* number = As<Number>(quote->next_)) {
+            result.push_back(number->GetValue());
+            return start;
         } else {
-            throw RuntimeError("Should be only integers in arithmetic functions");
+            Fail("Should be only integers in arithmetic functions");
+            return start;
         }
     }
 
-    if (Is<Number>(head)) {
-        return {As<Number>(head)->GetValue()};
+    if (Number* number = As<Number>(head)) {
+        result.push_back(number->GetValue());
+        return start;
     }
 
     assert(Is<Cell>(head));
 
-    std::vector<int> result;
-
-    while (head != nullptr) {
-        if (Is<Number>(head)) {
-            result.push_back(As<Number>(head)->GetValue());
+    Object* current = head.Get();
+    while (current != nullptr) {
+        if (Number* number = As<Number>(current)) {
+            result.push_back(number->GetValue());
             break;
-        } else if (Is<Quote>(head)) {
-            if (Is<Number>(As<Quote>(head)->next_)) {
-                return {As<Number>(As<Quote>(head)->next_)->GetValue()};
+        } else if (Quote* quote = As<Quote>(current)) {
+            if (Number* number = As<Number>(quote->next_)) {
+                result.resize(start);
+                result.push_back(number->GetValue());
+                return start;
             } else {
-                throw RuntimeError("Should be only integers in arithmetic functions");
+                Fail("Should be only integers in arithmetic functions");
+                return start;
             }
-        } else if (!Is<Cell>(head)) {
-            throw RuntimeError("Should be only integers in arithmetic functions");
+        } else if (!Is<Cell>(current)) {
+            Fail("Should be only integers in arithmetic functions");
+            return start;
         }
 
-        assert(Is<Cell>(head));
+        Cell* cell = As<Cell>(current);
 
-        std::shared_ptr<Object> left_son = GetAST(As<Cell>(head)->GetFirst());
+        Ref<Object> left_son = GetAST(cell->GetFirst());
+        if (failed_) {
+            return start;
+        }
+        Number* number = As<Number>(left_son);
 
-        if (!Is<Number>(left_son)) {
-            throw RuntimeError("Should be only integers in arithmetic functions");
+        if (number == nullptr) {
+            Fail("Should be only integers in arithmetic functions");
+            return start;
         }
 
-        result.push_back(As<Number>(left_son)->GetValue());
+        result.push_back(number->GetValue());
 
-        head = As<Cell>(head)->GetSecond();
+        current = cell->GetSecond().Get();
     }
 
-    return result;
+    return start;
 }
 
-std::shared_ptr<Bool> Interpreter::CmpHandler(std::shared_ptr<Object> head,
-                                              std::function<bool(int, int)> comparator) {
-    std::vector<int> values = ToIntVector(head);
+Ref<Bool> Interpreter::CmpHandler(const Ref<Object>& head, Comparator comparator) {
+    std::vector<int>& values = session_.GetIntScratch();
+    size_t start = CollectInts(head);
+    if (failed_) {
+        return nullptr;
+    }
 
     bool result = true;
-    for (size_t i = 0; i + 1 < values.size(); ++i) {
+    for (size_t i = start; i + 1 < values.size(); ++i) {
         result = result & comparator(values[i], values[i + 1]);
     }
 
-    return std::make_shared<Bool>(result);
+    values.resize(start);
+    return MakeRef<Bool>(result);
 }
 
-std::shared_ptr<Number> Interpreter::IntHandler(std::shared_ptr<Object> head,
-                                                std::function<int(int, int)> comparator) {
-    std::vector<int> values = ToIntVector(head);
+Ref<Number> Interpreter::IntHandler(const Ref<Object>& head, Operation operation) {
+    std::vector<int>& values = session_.GetIntScratch();
+    size_t start = CollectInts(head);
+    if (failed_) {
+        return nullptr;
+    }
+    size_t count = values.size() - start;
 
-    if (values.empty()) {
-        if (*comparator.target<int (*)(int, int)>() == Sum) {
-            return std::make_shared<Number>(0);
-        } else if (*comparator.target<int (*)(int, int)>() == Prod) {
-            return std::make_shared<Number>(1);
+    if (count == 0) {
+        if (operation == Sum) {
+            return MakeRef<Number>(0);
+        } else if (operation == Prod) {
+            return MakeRef<Number>(1);
         } else {
-            throw RuntimeError("Not enough arguments for arithmetic function");
+            return Fail("Not enough arguments for arithmetic function");
         }
     }
 
-    if (values.size() < 2 && (*comparator.target<int (*)(int, int)>() == Sub ||
-                              *comparator.target<int (*)(int, int)>() == Div)) {
-        throw RuntimeError("Not enough arguments for arithmetic function");
+    if (count < 2 && (operation == Sub || operation == Div)) {
+        return Fail("Not enough arguments for arithmetic function");
     }
 
-    int result = values[0];
-    for (size_t i = 1; i < values.size(); ++i) {
-        result = comparator(result, values[i]);
+    int result = values[start];
+    for (size_t i = start + 1; i < values.size(); ++i) {
+        // Both trap on x86 instead of producing a value.
+        if (operation == Div && (values[i] == 0 || (result == INT_MIN && values[i] == -1))) {
+            return Fail(values[i] == 0 ? "Division by zero" : "Division overflow");
+        }
+        if (Overflows(operation, result, values[i])) {
+            return Fail("Integer overflow");
+        }
+        result = operation(result, values[i]);
     }
 
-    return std::make_shared<Number>(result);
+    values.resize(start);
+    return MakeRef<Number>(result);
 }
 
-std::shared_ptr<Bool> Interpreter::NumberHandler(std::shared_ptr<Object> head) {
-    PredicateCorrectnessCheck("number?", head);
+Ref<Bool> Interpreter::NumberHandler(const Ref<Object>& head) {
+    if (!PredicateCorrectnessCheck("number?", head)) {
+        return nullptr;
+    }
 
-    std::shared_ptr<Object> argument = GetAST(As<Cell>(head)->GetFirst());
+    Ref<Object> argument = GetAST(As<Cell>(head)->GetFirst());
+    if (failed_) {
+        return nullptr;
+    }
 
-    return std::make_shared<Bool>(IsNumber(argument));
+    return MakeRef<Bool>(IsNumber(argument));
 }
 
-std::shared_ptr<Number> Interpreter::AbsHandler(std::shared_ptr<Object> head) {
-    PredicateCorrectnessCheck("abs", head);
+Ref<Number> Interpreter::AbsHandler(const Ref<Object>& head) {
+    if (!PredicateCorrectnessCheck("abs", head)) {
+        return nullptr;
+    }
+
+    Ref<Object> argument = GetAST(As<Cell>(head)->GetFirst());
+    if (failed_) {
+        return nullptr;
+    }
+    Number* number = As<Number>(argument);
+
+    if (number == nullptr) {
+        return Fail("Expected number for abs");
+    }
+    if (number->GetValue() == INT_MIN) {
+        return Fail("Integer overflow");
+    }
 
-    std::shared_ptr<Object> argument = GetAST(As<Cell>(head)->GetFirst());
+    return MakeRef<Number>(Abs(number->GetValue()));
+}
 
-    if (!Is<Number>(argument)) {
-        throw RuntimeError("Expected number for abs");
+Ref<Object> Interpreter::DisplayHandler(const Ref<Object>& head, std::string_view func_name) {
+    if (!PredicateCorrectnessCheck(func_name, head)) {
+        return nullptr;
+    }
+    if (output_port_ == nullptr) {
+        return Fail("No output port for " + std::string(func_name));
     }
 
-    return std::make_shared<Number>(Abs(As<Number>(argument)->GetValue()));
+    Ref<Object> argument = GetAST(As<Cell>(head)->GetFirst());
+    if (failed_) {
+        return nullptr;
+    }
+    std::string* buffer = output_port_->GetBuffer();
+    size_t size = buffer->size();
+    Print(argument, buffer);
+    if (failed_) {
+        buffer->resize(size);
+        return nullptr;
+    }
+    output_port_->Commit();
+    return MakeUnspecified();
 }
 
-std::string Interpreter::ASTToString(std::shared_ptr<Object> head) {
+Ref<Object> Interpreter::NewlineHandler(const Ref<Object>& head) {
+    if (head != nullptr) {
+        return Fail("Too many arguments for newline");
+    }
+    if (output_port_ == nullptr) {
+        return Fail("No output port for newline");
+    }
+    *output_port_->GetBuffer() += '\n';
+    output_port_->Commit();
+    return MakeUnspecified();
+}
+
+Ref<Object> Interpreter::ReadHandler(const Ref<Object>& head) {
+    if (head != nullptr) {
+        return Fail("Too many arguments for read");
+    }
+    if (input_port_ == nullptr) {
+        return Fail("No input port for read");
+    }
+
+    Ref<Object> datum;
+    if (input_port_->Read(&datum)) {
+        return datum;
+    }
+    if (const Error* error = input_port_->GetError()) {
+        return Fail(error->message + " at byte " + std::to_string(error->offset), error->kind);
+    }
+    return MakeRef<Symbol>(std::string(kEofName));
+}
+
+Ref<Bool> Interpreter::EofObjectHandler(const Ref<Object>& head) {
+    if (!PredicateCorrectnessCheck("eof-object?", head)) {
+        return nullptr;
+    }
+
+    Ref<Object> argument = GetAST(As<Cell>(head)->GetFirst());
+    if (failed_) {
+        return nullptr;
+    }
+
+    return MakeRef<Bool>(IsEof(argument));
+}
+
+std::string Interpreter::ASTToString(const Ref<Object>& head) {
+    std::string ans;
+    failed_ = false;
+    Print(head, &ans);
+    ThrowIfFailed();
+    return ans;
+}
+
+std::string Interpreter::CellToString(Cell* head) {
+    std::string ans;
+    failed_ = false;
+    PrintCell(head, &ans);
+    ThrowIfFailed();
+    return ans;
+}
+
+void Interpreter::Print(const Ref<Object>& head, std::string* out) {
     if (head == nullptr) {
-        return "()";
+        *out += "()";
+        return;
     }
 
-    if (Is<Number>(head)) {
-        return std::to_string(As<Number>(head)->GetValue());
-    } else if (Is<Symbol>(head)) {
-        return As<Symbol>(head)->GetName();
-    } else if (Is<Bool>(head)) {
-        return As<Bool>(head)->GetValue() ? "#t" : "#f";
+    if (Number* number = As<Number>(head)) {
+        AppendNumber(number->GetValue(), out);
+    } else if (Symbol* symbol = As<Symbol>(head)) {
+        *out += symbol->GetName();
+    } else if (Bool* boolean = As<Bool>(head)) {
+        *out += boolean->GetValue() ? "#t" : "#f";
     } else if (Is<Quote>(head)) {
-        throw RuntimeError("Invalid AST passed to ASTToString");
+        Fail("Invalid AST passed to ASTToString");
+        return;
     } else {
-        std::string ans;
-        ans += "(";
-        ans += CellToString(As<Cell>(head));
-        ans += ")";
-        return ans;
+        *out += '(';
+        PrintCell(As<Cell>(head), out);
+        if (failed_) {
+            return;
+        }
+        *out += ')';
     }
 }
 
-std::string Interpreter::CellToString(std::shared_ptr<Cell> head) {
+void Interpreter::PrintCell(Cell* head, std::string* out) {
     if (!head->HasSon()) {
-        return "()";
+        *out += "()";
+        return;
     }
 
-    std::string ans;
+    bool is_first = true;
 
-    std::shared_ptr<Object> current = head;
+    Object* current = head;
     while (current != nullptr) {
-        if (Is<Number>(current)) {
-            ans += " . ";
-            ans += std::to_string(As<Number>(current)->GetValue());
+        if (Number* number = As<Number>(current)) {
+            *out += " . ";
+            AppendNumber(number->GetValue(), out);
             break;
-        } else if (Is<Symbol>(current)) {
-            ans += " . ";
-            ans += As<Symbol>(current)->GetName();
+        } else if (Symbol* symbol = As<Symbol>(current)) {
+            *out += " . ";
+            *out += symbol->GetName();
             break;
-        } else if (Is<Bool>(current)) {
-            ans += " . ";
-            ans += As<Bool>(current)->GetValue() ? "#t" : "#f";
+        } else if (Bool* boolean = As<Bool>(current)) {
+            *out += " . ";
+            *out += boolean->GetValue() ? "#t" : "#f";
             break;
         } else if (Is<Quote>(current)) {
-            throw RuntimeError("Invalid AST passed to CellToString");
+            Fail("Invalid AST passed to CellToString");
+            return;
         }
 
         assert(Is<Cell>(current));
 
-        std::shared_ptr<Object> left_son = As<Cell>(current)->GetFirst();
-
-        if (Is<Number>(left_son)) {
-            ans += ans.empty() ? "" : " ";
-            ans += std::to_string(As<Number>(left_son)->GetValue());
-        } else if (Is<Symbol>(left_son)) {
-            ans += ans.empty() ? "" : " ";
-            ans += As<Symbol>(left_son)->GetName();
-        } else if (Is<Bool>(left_son)) {
-            ans += ans.empty() ? "" : " ";
-            ans += As<Bool>(left_son)->GetValue() ? "#t" : "#f";
+        const Ref<Object>& left_son = As<Cell>(current)->GetFirst();
+
+        if (!is_first) {
+            *out += ' ';
+        }
+        is_first = false;
+
+        if (left_son == nullptr) {
+            *out += "()";
+        } else if (Number* number = As<Number>(left_son)) {
+            AppendNumber(number->GetValue(), out);
+        } else if (Symbol* symbol = As<Symbol>(left_son)) {
+            *out += symbol->GetName();
+        } else if (Bool* boolean = As<Bool>(left_son)) {
+            *out += boolean->GetValue() ? "#t" : "#f";
         } else if (Is<Quote>(left_son)) {
-            throw RuntimeError("Invalid AST passed to CellToString");
+            Fail("Invalid AST passed to CellToString");
+            return;
         } else {
-            ans += ans.empty() ? "(" : " (";
-            ans += CellToString(As<Cell>(left_son));
-            ans += ")";
+            *out += '(';
+            PrintCell(As<Cell>(left_son), out);
+            if (failed_) {
+                return;
+            }
+            *out += ')';
         }
 
-        current = As<Cell>(current)->GetSecond();
+        current = As<Cell>(current)->GetSecond().Get();
     }
-
-    return ans;
 }
 
 std::string Interpreter::Run(const std::string& input) {
-    std::stringstream ss{input};
-    Tokenizer tokenizer(&ss);
-    std::shared_ptr<Object> head = Read(&tokenizer);
+    return std::string(RunInPlace(input));
+}
+
+std::string_view Interpreter::RunInPlace(std::string_view input) {
+    return TryRun(input).ValueOrThrow();
+}
+
+Expected<std::string_view> Interpreter::TryRun(std::string_view input) {
+    std::string& output = session_.GetOutput();
+    output.clear();
+    if (!RunInto(input, &output)) {
+        return std::move(error_);
+    }
+    return std::string_view(output);
+}
+
+Expected<std::string_view> Interpreter::TryRunProgram(Ref<Object> program) {
+    std::string& output = session_.GetOutput();
+    output.clear();
+    AllocationWindow window;
+    bool ok;
+    {
+        PhaseClock clock(latency_shard_);
+        TraceScope run_scope(tracer_, "run");
+        StartMeters();
+        Heap::Scope heap_scope(heap_.get());
+        failed_ = false;
+        ok = EvaluateProgram(std::move(program), 0, &clock, &output);
+        if (ok) {
+            Safepoint();
+        }
+    }
+    last_run_allocations_ = window.Finish();
+    allocations_.Add(last_run_allocations_);
+    if (!ok) {
+        return std::move(error_);
+    }
+    return std::string_view(output);
+}
+
+const BatchResult& Interpreter::RunBatch(std::span<const std::string_view> inputs) {
+    static constexpr BatchStatus kStatuses[] = {
+        BatchStatus::kSyntaxError, BatchStatus::kRuntimeError, BatchStatus::kNameError,
+        BatchStatus::kLimitError};
+
+    batch_.buffer.clear();
+    batch_.items.clear();
+    batch_.items.reserve(inputs.size());
+
+    for (std::string_view input : inputs) {
+        size_t offset = batch_.buffer.size();
+        BatchStatus status = BatchStatus::kOk;
+        if (!RunInto(input, &batch_.buffer)) {
+            status = kStatuses[static_cast<int>(error_.kind)];
+            batch_.buffer.resize(offset);
+            batch_.buffer += error_.message;
+        }
+        batch_.items.push_back({offset, batch_.buffer.size() - offset, status});
+    }
+    return batch_;
+}
+
+bool Interpreter::RunInto(std::string_view input, std::string* output) {
+    std::chrono::steady_clock::time_point start;
+    if (workload_recorder_ != nullptr) {
+        start = std::chrono::steady_clock::now();
+    }
+    size_t output_start = output->size();
+    AllocationWindow window;
+    bool ok = EvaluateInput(input, output);
+    last_run_allocations_ = window.Finish();
+    allocations_.Add(last_run_allocations_);
+    if (workload_recorder_ != nullptr) {
+        workload_recorder_->Append(
+            {.start = start - workload_recorder_->GetStart(),
+             .duration = std::chrono::steady_clock::now() - start,
+             .failed = !ok,
+             .error_kind = error_.kind,
+             .input = input,
+             .output = ok ? std::string_view(*output).substr(output_start) : error_.message});
+    }
+    return ok;
+}
+
+bool Interpreter::EvaluateInput(std::string_view input, std::string* output) {
+    PhaseClock clock(latency_shard_);
+    TraceScope run_scope(tracer_, "run");
+    size_t output_start = output->size();
+    StartMeters();
+    failed_ = false;
+    // A cache hit runs no steps, so cancellation is polled before the lookup.
+    if (!CheckLimits()) {
+        return false;
+    }
+    const std::string* cache_key = nullptr;
+    if (result_cache_ != nullptr) {
+        session_.Reset(input);
+        std::string& key = session_.GetCacheKey();
+        if (BuildCacheKey(&key)) {
+            if (result_cache_->Lookup(key, output)) {
+                return true;
+            }
+            cache_key = &key;
+        }
+    }
+
+    Heap::Scope heap_scope(heap_.get());
+    session_.Reset(input);
+    Expected<Ref<Object>> program = ReadProgram(input);
+    if (!program) {
+        error_ = program.GetError();
+        return false;
+    }
+    clock.Lap(Phase::kRead);
+    if (!EvaluateProgram(std::move(*program), input.size(), &clock, output)) {
+        return false;
+    }
+    if (cache_key != nullptr) {
+        result_cache_->Insert(*cache_key, std::string_view(*output).substr(output_start));
+    }
+    Safepoint();
+    return true;
+}
+
+// Evaluates and prints a program that has been read. source_size is the length of its source,
+// which counts towards the reclaimer's threshold.
+bool Interpreter::EvaluateProgram(Ref<Object> head, size_t source_size, PhaseClock* clock,
+                                  std::string* output) {
+    size_t output_start = output->size();
+    // Arguments collected by a failed call must not outlive the roots.
+    ScratchGuard scratch_guard(&session_);
+    Heap::Root parse_root(heap_.get(), &head);
+    if (!CheckLimits()) {
+        return false;
+    }
+    Safepoint();
+
+    Ref<Object> new_head;
+    {
+        TraceScope scope(tracer_, "evaluate");
+        new_head = GetAST(head);
+    }
+    if (failed_) {
+        return false;
+    }
+    Heap::Root result_root(heap_.get(), &new_head);
+    Safepoint();
+    clock->Lap(Phase::kEvaluate);
+
+    {
+        TraceScope scope(tracer_, "print");
+        Print(new_head, output);
+    }
+    if (failed_) {
+        return false;
+    }
+    clock->Lap(Phase::kPrint);
+
+    if (reclaimer_ != nullptr && heap_ == nullptr &&
+        source_size + output->size() - output_start >= reclaim_min_size_) {
+        // The result may share cells with the program, so both go in one graph.
+        Ref<Cell> graph = MakeRef<Cell>();
+        graph->first_ = std::move(head);
+        graph->second_ = std::move(new_head);
+        reclaim_account_.Retire(std::move(graph));
+    }
+    return true;
+}
+
+// Cached programs are read into reference counted objects even when the collected heap is on,
+// because only those can be shared.
+Expected<Ref<Object>> Interpreter::ReadProgram(std::string_view input) {
+    TraceScope scope(tracer_, "read");
+    if (parse_cache_ == nullptr) {
+        return TryRead(session_.GetTokenizer(), limits_.max_depth, hash_cons_.get());
+    }
+
+    Ref<Object> program;
+    if (parse_cache_->Lookup(input, &program)) {
+        return program;
+    }
+    Heap::Scope plain_scope(nullptr);
+    uint64_t bytes_before = allocated_object_bytes;
+    Expected<Ref<Object>> read =
+        TryRead(session_.GetTokenizer(), limits_.max_depth, hash_cons_.get());
+    if (read) {
+        parse_cache_->Insert(input, *read, allocated_object_bytes - bytes_before);
+    }
+    return read;
+}
+
+// Renders the tokens of the current input canonically, so inputs that differ only in spacing or
+// in how numbers are spelled share a key. Returns false when the result must not be cached: the
+// input does not tokenize or names an impure builtin.
+bool Interpreter::BuildCacheKey(std::string* key) {
+    Tokenizer* tokenizer = session_.GetTokenizer();
+    key->clear();
+    for (; !tokenizer->IsEnd(); tokenizer->Next()) {
+        const Token& token = *tokenizer->TryGetToken();
+        if (const ConstantToken* constant = std::get_if<ConstantToken>(&token)) {
+            AppendNumber(constant->value, key);
+        } else if (const BracketToken* bracket = std::get_if<BracketToken>(&token)) {
+            *key += *bracket == BracketToken::OPEN ? '(' : ')';
+        } else if (const SymbolToken* symbol = std::get_if<SymbolToken>(&token)) {
+            if (kImpureBuiltins.contains(symbol->name)) {
+                return false;
+            }
+            *key += symbol->name;
+        } else if (const BoolToken* boolean = std::get_if<BoolToken>(&token)) {
+            *key += boolean->value ? "#t" : "#f";
+        } else if (std::holds_alternative<QuoteToken>(token)) {
+            *key += '\'';
+        } else {
+            *key += '.';
+        }
+        *key += ' ';
+    }
+    return tokenizer->GetError() == nullptr;
+}
+
+std::string_view BatchResult::Get(size_t index) const {
+    return std::string_view(buffer).substr(items[index].offset, items[index].size);
+}
+
+void Interpreter::EnableGc(const GcOptions& options) {
+    heap_ = std::make_unique<Heap>(options);
+}
+
+GcStats Interpreter::GetGcStats() const {
+    if (heap_ == nullptr) {
+        return {};
+    }
+    return heap_->GetStats();
+}
+
+void Interpreter::EnableHashConsing() {
+    if (hash_cons_ == nullptr) {
+        hash_cons_ = std::make_unique<HashConsTable>();
+    }
+}
 
-    std::shared_ptr<Object> new_head = GetAST(head);
+HashConsStats Interpreter::GetHashConsStats() const {
+    if (hash_cons_ == nullptr) {
+        return {};
+    }
+    return hash_cons_->GetStats();
+}
 
-    return ASTToString(new_head);
+void Interpreter::EnableProfiling() {
+    if (kProfilingBuilt && profiler_ == nullptr) {
+        profiler_ = std::make_unique<Profiler>();
+        instrumented_ = true;
+    }
 }
 
-std::shared_ptr<Object> Interpreter::AndHandler(std::shared_ptr<Object> head) {
+void Interpreter::DisableProfiling() {
+    profiler_.reset();
+    instrumented_ = tracer_ != nullptr;
+}
+
+Profile Interpreter::GetProfile() const {
+    if (profiler_ == nullptr) {
+        return {};
+    }
+    return profiler_->GetProfile();
+}
+
+void Interpreter::SetTracer(Tracer* tracer) {
+    tracer_ = tracer;
+    instrumented_ = profiler_ != nullptr || tracer_ != nullptr;
+}
+
+void Interpreter::SetReclaimer(Reclaimer* reclaimer, size_t min_size) {
+    reclaimer_ = reclaimer;
+    reclaim_account_ = reclaimer != nullptr ? reclaimer->OpenAccount() : Reclaimer::Account();
+    reclaim_min_size_ = min_size;
+}
+
+void Interpreter::SetResultCache(ResultCache* cache) {
+    result_cache_ = cache;
+}
+
+void Interpreter::SetParseCache(ParseCache* cache) {
+    parse_cache_ = cache;
+}
+
+void Interpreter::SetLatencyRecorder(LatencyRecorder* recorder) {
+    if (recorder != latency_recorder_) {
+        latency_recorder_ = recorder;
+        latency_shard_ = recorder != nullptr ? recorder->AddShard() : nullptr;
+    }
+}
+
+void Interpreter::SetWorkloadRecorder(WorkloadRecorder* recorder) {
+    workload_recorder_ = recorder;
+}
+
+void Interpreter::SetOutputPort(OutputPort* port) {
+    output_port_ = port;
+}
+
+void Interpreter::SetInputPort(InputPort* port) {
+    input_port_ = port;
+}
+
+const AllocationStats& Interpreter::GetAllocationStats() const {
+    return allocations_;
+}
+
+const AllocationStats& Interpreter::GetLastRunAllocationStats() const {
+    return last_run_allocations_;
+}
+
+uint64_t Interpreter::GetLastRunSteps() const {
+    // Steps handed out minus those left in the current chunk. A failed refuel leaves the chunk
+    // counter wrapped around, with nothing left in it.
+    uint64_t unused = steps_until_check_ != UINT32_MAX ? steps_until_check_ : 0;
+    return steps_at_start_ - steps_left_ - unused;
+}
+
+void Interpreter::SetLimits(const RunLimits& limits) {
+    limits_ = limits;
+}
+
+void Interpreter::SetCancellationToken(const CancellationToken* token) {
+    cancellation_ = token;
+}
+
+void Interpreter::StartMeters() {
+    steps_left_ = limits_.max_steps != 0 ? limits_.max_steps : UINT64_MAX;
+    steps_at_start_ = steps_left_;
+    steps_until_check_ = 0;
+    depth_left_ = limits_.max_depth != 0 ? limits_.max_depth : SIZE_MAX;
+    bytes_at_start_ = allocated_object_bytes;
+    if (reclaimer_ != nullptr) {
+        reclaim_account_.Settle();
+    }
+    live_bytes_at_start_ = allocation_counters.live_bytes;
+}
+
+bool Interpreter::CheckLimits() {
+    if (cancellation_ != nullptr && cancellation_->IsCancelled()) {
+        Fail("Run cancelled", ErrorKind::kLimit);
+        return false;
+    }
+    if (limits_.max_bytes != 0 && allocated_object_bytes - bytes_at_start_ > limits_.max_bytes) {
+        Fail("Memory limit exceeded", ErrorKind::kLimit);
+        return false;
+    }
+    if (limits_.max_live_bytes != 0 &&
+        allocation_counters.live_bytes - live_bytes_at_start_ >
+            static_cast<int64_t>(limits_.max_live_bytes)) {
+        Fail("Live memory limit exceeded", ErrorKind::kLimit);
+        return false;
+    }
+    return true;
+}
+
+// Slow path of the step counter: checks the limits and hands out the next chunk of steps, the
+// current one included.
+bool Interpreter::Refuel() {
+    static constexpr uint32_t kStepsPerCheck = 64;
+
+    if (!CheckLimits()) {
+        return false;
+    }
+    if (steps_left_ == 0) {
+        Fail("Step limit exceeded", ErrorKind::kLimit);
+        return false;
+    }
+    uint32_t steps = static_cast<uint32_t>(std::min<uint64_t>(steps_left_, kStepsPerCheck));
+    steps_left_ -= steps;
+    steps_until_check_ = steps - 1;
+    return true;
+}
+
+std::nullptr_t Interpreter::Fail(std::string message, ErrorKind kind) {
+    failed_ = true;
+    error_.kind = kind;
+    error_.message = std::move(message);
+    error_.offset = current_call_ != nullptr ? current_call_->GetSourceOffset() : 0;
+    return nullptr;
+}
+
+void Interpreter::ThrowIfFailed() {
+    if (failed_) {
+        failed_ = false;
+        session_.ClearScratch();
+        Throw(error_);
+    }
+}
+
+bool Interpreter::PredicateCorrectnessCheck(std::string_view func_name, const Ref<Object>& head) {
     if (head == nullptr) {
-        return std::make_shared<Bool>(true);
+        Fail("1 argument is expected for " + std::string(func_name));
+        return false;
+    }
+
+    if (!Is<Cell>(head)) {
+        Fail("Invalid call for " + std::string(func_name));
+        return false;
+    }
+
+    if (As<Cell>(head)->GetSecond() != nullptr) {
+        Fail("Too many arguments for " + std::string(func_name));
+        return false;
+    }
+
+    return true;
+}
+
+void Interpreter::Safepoint() {
+    if (heap_ != nullptr) {
+        heap_->Safepoint();
+    }
+}
+
+Ref<Object> Interpreter::AndHandler(const Ref<Object>& head) {
+    if (head == nullptr) {
+        return MakeRef<Bool>(true);
     }
 
     if (Is<Number>(head) || Is<Symbol>(head) || Is<Bool>(head)) {
         return head;
     }
 
-    if (Is<Quote>(head)) {
-        if (As<Quote>(head)->next_ == nullptr) {
-            throw RuntimeError("Invalid syntax");
+    if (Quote* quote = As<Quote>(head)) {
+        if (quote->next_ == nullptr) {
+            return Fail("Invalid syntax");
         } else {
-            return As<Quote>(head)->next_;
+            return quote->next_;
         }
     }
 
     assert(Is<Cell>(head));
 
-    std::shared_ptr<Object> last_element = nullptr;
+    Ref<Object> last_element = nullptr;
 
-    while (head != nullptr) {
-        if (Is<Number>(head) || Is<Symbol>(head) || Is<Bool>(head)) {
-            return head;
-        } else if (Is<Quote>(head)) {
-            if (As<Quote>(head)->next_ == nullptr) {
-                throw RuntimeError("Invalid syntax");
+    Object* current = head.Get();
+    while (current != nullptr) {
+        if (Is<Number>(current) || Is<Symbol>(current) || Is<Bool>(current)) {
+            return Ref<Object>(current);
+        } else if (Quote* quote = As<Quote>(current)) {
+            if (quote->next_ == nullptr) {
+                return Fail("Invalid syntax");
             }
-            if (Is<Bool>(As<Quote>(head)->next_) && !As<Bool>(As<Quote>(head)->next_)->GetValue()) {
-                return std::make_shared<Bool>(false);
+            if (Bool* boolean = As<Bool>(quote->next_); boolean && !boolean->GetValue()) {
+                return MakeRef<Bool>(false);
             } else {
-                return As<Quote>(head)->next_;
+                return quote->next_;
             }
         }
 
-        assert(Is<Cell>(head));
+        assert(Is<Cell>(current));
 
-        std::shared_ptr<Object> left_son = GetAST(As<Cell>(head)->GetFirst());
+        Ref<Object> left_son = GetAST(As<Cell>(current)->GetFirst());
+        if (failed_) {
+            return nullptr;
+        }
 
-        if (Is<Bool>(left_son) && !As<Bool>(left_son)->GetValue()) {
+        if (Bool* boolean = As<Bool>(left_son); boolean && !boolean->GetValue()) {
             return left_son;
         }
 
-        last_element = left_son;
+        last_element = std::move(left_son);
 
-        head = As<Cell>(head)->GetSecond();
+        current = As<Cell>(current)->GetSecond().Get();
     }
 
     return last_element;
 }
 
-std::shared_ptr<Object> Interpreter::OrHandler(std::shared_ptr<Object> head) {
+Ref<Object> Interpreter::OrHandler(const Ref<Object>& head) {
     if (head == nullptr) {
-        return std::make_shared<Bool>(false);
+        return MakeRef<Bool>(false);
     }
 
     if (Is<Number>(head) || Is<Symbol>(head) || Is<Bool>(head)) {
         return head;
     }
 
-    if (Is<Quote>(head)) {
-        if (As<Quote>(head)->next_ == nullptr) {
-            throw RuntimeError("Invalid syntax");
+    if (Quote* quote = As<Quote>(head)) {
+        if (quote->next_ == nullptr) {
+            return Fail("Invalid syntax");
         } else {
-            return As<Quote>(head)->next_;
+            return quote->next_;
         }
     }
 
     assert(Is<Cell>(head));
 
-    std::shared_ptr<Object> last_element = nullptr;
+    Ref<Object> last_element = nullptr;
 
-    while (head != nullptr) {
-        if (Is<Number>(head) || Is<Symbol>(head) || Is<Bool>(head)) {
-            return head;
-        } else if (Is<Quote>(head)) {
-            if (As<Quote>(head)->next_ == nullptr) {
-                throw RuntimeError("Invalid syntax");
+    Object* current = head.Get();
+    while (current != nullptr) {
+        if (Is<Number>(current) || Is<Symbol>(current) || Is<Bool>(current)) {
+            return Ref<Object>(current);
+        } else if (Quote* quote = As<Quote>(current)) {
+            if (quote->next_ == nullptr) {
+                return Fail("Invalid syntax");
             }
-            return As<Quote>(head)->next_;
+            return quote->next_;
         }
 
-        assert(Is<Cell>(head));
+        assert(Is<Cell>(current));
 
-        std::shared_ptr<Object> left_son = GetAST(As<Cell>(head)->GetFirst());
+        Ref<Object> left_son = GetAST(As<Cell>(current)->GetFirst());
+        if (failed_) {
+            return nullptr;
+        }
 
-        if (!(Is<Bool>(left_son) && !As<Bool>(left_son)->GetValue())) {
+        if (Bool* boolean = As<Bool>(left_son); !(boolean && !boolean->GetValue())) {
             return left_son;
         }
 
-        last_element = left_son;
+        last_element = std::move(left_son);
 
-        head = As<Cell>(head)->GetSecond();
+        current = As<Cell>(current)->GetSecond().Get();
     }
 
     return last_element;
 }
 
-std::shared_ptr<Bool> Interpreter::NotHandler(std::shared_ptr<Object> head) {
-    PredicateCorrectnessCheck("not", head);
+Ref<Bool> Interpreter::NotHandler(const Ref<Object>& head) {
+    if (!PredicateCorrectnessCheck("not", head)) {
+        return nullptr;
+    }
 
-    std::shared_ptr<Object> argument = GetAST(As<Cell>(head)->GetFirst());
+    Ref<Object> argument = GetAST(As<Cell>(head)->GetFirst());
+    if (failed_) {
+        return nullptr;
+    }
 
-    if (Is<Bool>(argument) && !As<Bool>(argument)->GetValue()) {
-        return std::make_shared<Bool>(true);
+    if (Bool* boolean = As<Bool>(argument); boolean && !boolean->GetValue()) {
+        return MakeRef<Bool>(true);
     } else {
-        return std::make_shared<Bool>(false);
+        return MakeRef<Bool>(false);
     }
 }
 
-std::shared_ptr<Bool> Interpreter::BooleanHandler(std::shared_ptr<Object> head) {
-    PredicateCorrectnessCheck("boolean?", head);
+Ref<Bool> Interpreter::BooleanHandler(const Ref<Object>& head) {
+    if (!PredicateCorrectnessCheck("boolean?", head)) {
+        return nullptr;
+    }
 
-    std::shared_ptr<Object> argument = GetAST(As<Cell>(head)->GetFirst());
+    Ref<Object> argument = GetAST(As<Cell>(head)->GetFirst());
+    if (failed_) {
+        return nullptr;
+    }
 
-    return std::make_shared<Bool>(Is<Bool>(argument));
+    return MakeRef<Bool>(Is<Bool>(argument));
 }
 
-std::shared_ptr<Bool> Interpreter::PairHandler(std::shared_ptr<Object> head) {
-    PredicateCorrectnessCheck("pair?", head);
+Ref<Bool> Interpreter::PairHandler(const Ref<Object>& head) {
+    if (!PredicateCorrectnessCheck("pair?", head)) {
+        return nullptr;
+    }
 
-    std::shared_ptr<Object> argument = GetAST(As<Cell>(head)->GetFirst());
+    Ref<Object> argument = GetAST(As<Cell>(head)->GetFirst());
+    if (failed_) {
+        return nullptr;
+    }
 
-    if (!Is<Cell>(argument) || !As<Cell>(argument)->HasSon()) {
-        return std::make_shared<Bool>(false);
+    if (Cell* cell = As<Cell>(argument); !cell || !cell->HasSon()) {
+        return MakeRef<Bool>(false);
     } else {
-        return std::make_shared<Bool>(true);
+        return MakeRef<Bool>(true);
     }
 }
 
-std::shared_ptr<Bool> Interpreter::NullHandler(std::shared_ptr<Object> head) {
-    PredicateCorrectnessCheck("null?", head);
+Ref<Bool> Interpreter::NullHandler(const Ref<Object>& head) {
+    if (!PredicateCorrectnessCheck("null?", head)) {
+        return nullptr;
+    }
 
-    std::shared_ptr<Object> argument = GetAST(As<Cell>(head)->GetFirst());
+    Ref<Object> argument = GetAST(As<Cell>(head)->GetFirst());
+    if (failed_) {
+        return nullptr;
+    }
 
     if (argument == nullptr) {
-        return std::make_shared<Bool>(true);
+        return MakeRef<Bool>(true);
     } else {
-        return std::make_shared<Bool>(false);
+        return MakeRef<Bool>(false);
     }
 }
 
-std::shared_ptr<Bool> Interpreter::IsListHandler(std::shared_ptr<Object> head) {
-    PredicateCorrectnessCheck("list?", head);
+Ref<Bool> Interpreter::IsListHandler(const Ref<Object>& head) {
+    if (!PredicateCorrectnessCheck("list?", head)) {
+        return nullptr;
+    }
 
-    std::shared_ptr<Object> argument = GetAST(As<Cell>(head)->GetFirst());
+    Ref<Object> argument = GetAST(As<Cell>(head)->GetFirst());
+    if (failed_) {
+        return nullptr;
+    }
 
     if (argument == nullptr) {
-        return std::make_shared<Bool>(true);
+        return MakeRef<Bool>(true);
     }
 
     if (!Is<Cell>(argument)) {
-        return std::make_shared<Bool>(false);
+        return MakeRef<Bool>(false);
     }
 
-    while (argument != nullptr) {
-        if (!Is<Cell>(argument)) {
-            return std::make_shared<Bool>(false);
+    Object* current = argument.Get();
+    while (current != nullptr) {
+        if (!Is<Cell>(current)) {
+            return MakeRef<Bool>(false);
         }
 
-        assert(Is<Cell>(argument));
+        assert(Is<Cell>(current));
 
-        argument = As<Cell>(argument)->GetSecond();
+        current = As<Cell>(current)->GetSecond().Get();
     }
 
-    return std::make_shared<Bool>(true);
+    return MakeRef<Bool>(true);
+}
+
+std::vector<Ref<Object>> Interpreter::ToObjVector(const Ref<Object>& head) {
+    std::vector<Ref<Object>>& scratch = session_.GetObjectScratch();
+    failed_ = false;
+    size_t start = CollectObjects(head);
+    ThrowIfFailed();
+    std::vector<Ref<Object>> result(std::make_move_iterator(scratch.begin() + start),
+                                    std::make_move_iterator(scratch.end()));
+    scratch.resize(start);
+    return result;
 }
 
-std::vector<std::shared_ptr<Object>> Interpreter::ToObjVector(std::shared_ptr<Object> head) {
+size_t Interpreter::CollectObjects(const Ref<Object>& head) {
+    std::vector<Ref<Object>>& result = session_.GetObjectScratch();
+    size_t start = result.size();
+
     if (head == nullptr) {
-        return {};
+        return start;
     }
 
     if (Is<Number>(head) || Is<Symbol>(head) || Is<Bool>(head)) {
-        return {head};
+        result.push_back(head);
+        return start;
     }
 
-    if (Is<Quote>(head)) {
-        if (As<Quote>(head)->next_ == nullptr) {
-            throw RuntimeError("Syntax error");
+    if (Quote* quote = As<Quote>(head)) {
+        if (quote->next_ == nullptr) {
+            Fail("Syntax error");
+            return start;
         } else {
-            return {As<Quote>(head)->next_};
+            result.push_back(quote->next_);
+            return start;
         }
     }
 
     assert(Is<Cell>(head));
 
-    std::vector<std::shared_ptr<Object>> result;
-
-    while (head != nullptr) {
-        if (Is<Number>(head) || Is<Symbol>(head) || Is<Bool>(head)) {
-            result.push_back(head);
+    Object* current = head.Get();
+    while (current != nullptr) {
+        if (Is<Number>(current) || Is<Symbol>(current) || Is<Bool>(current)) {
+            result.emplace_back(current);
+            break;
         }
 
-        if (Is<Quote>(head)) {
-            if (As<Quote>(head)->next_ == nullptr) {
-                throw RuntimeError("Syntax error");
+        if (Quote* quote = As<Quote>(current)) {
+            if (quote->next_ == nullptr) {
+                Fail("Syntax error");
+                return start;
             } else {
-                result.push_back(As<Quote>(head)->next_);
+                result.push_back(quote->next_);
+                break;
             }
         }
 
-        assert(Is<Cell>(head));
-
-        std::shared_ptr<Object> left_son = GetAST(As<Cell>(head)->GetFirst());
+        assert(Is<Cell>(current));
 
-        result.push_back(left_son);
+        Ref<Object> element = GetAST(As<Cell>(current)->GetFirst());
+        if (failed_) {
+            return start;
+        }
+        result.push_back(std::move(element));
 
-        head = As<Cell>(head)->GetSecond();
+        current = As<Cell>(current)->GetSecond().Get();
     }
 
-    return result;
+    return start;
 }
 
-void Interpreter::ToList(std::vector<std::shared_ptr<Object>>& vec, std::shared_ptr<Cell> head) {
-    if (vec.empty()) {
-        head = nullptr;
-    }
-
-    std::shared_ptr<Cell> cur = head;
-    for (size_t i = 0; i < vec.size(); ++i) {
-        cur->first_ = vec[i];
-        cur->second_ = std::make_shared<Cell>();
-        cur = As<Cell>(cur->second_);
+Ref<Object> Interpreter::ToList(const std::vector<Ref<Object>>& vec) {
+    Ref<Object> head;
+    for (size_t i = vec.size(); i-- > 0;) {
+        Ref<Cell> cell = MakeRef<Cell>();
+        cell->first_ = vec[i];
+        cell->second_ = std::move(head);
+        head = std::move(cell);
     }
+    return head;
 }
 
-std::shared_ptr<Cell> Interpreter::ConsHandler(std::shared_ptr<Object> head) {
-    std::vector<std::shared_ptr<Object>> elements = ToObjVector(head);
-    if (elements.size() != 2) {
-        throw RuntimeError("Invalid number of arguments for cons");
+Ref<Cell> Interpreter::ConsHandler(const Ref<Object>& head) {
+    std::vector<Ref<Object>>& elements = session_.GetObjectScratch();
+    size_t start = CollectObjects(head);
+    if (failed_) {
+        return nullptr;
+    }
+    if (elements.size() - start != 2) {
+        return Fail("Invalid number of arguments for cons");
     }
 
-    std::shared_ptr<Cell> new_head = std::make_shared<Cell>();
-    new_head->first_ = elements[0];
-    new_head->second_ = elements[1];
+    Ref<Cell> new_head = MakeRef<Cell>();
+    new_head->first_ = std::move(elements[start]);
+    new_head->second_ = std::move(elements[start + 1]);
+    elements.resize(start);
 
     return new_head;
 }
 
-std::shared_ptr<Object> Interpreter::CarHandler(std::shared_ptr<Object> head) {
-    PredicateCorrectnessCheck("car", head);
+Ref<Object> Interpreter::CarHandler(const Ref<Object>& head) {
+    if (!PredicateCorrectnessCheck("car", head)) {
+        return nullptr;
+    }
 
-    std::shared_ptr<Object> first_arg = GetAST(As<Cell>(head)->GetFirst());
+    Ref<Object> first_arg = GetAST(As<Cell>(head)->GetFirst());
+    if (failed_) {
+        return nullptr;
+    }
+    Cell* cell = As<Cell>(first_arg);
 
-    if (!Is<Cell>(first_arg)) {
-        throw RuntimeError("Invalid call for car");
+    if (cell == nullptr) {
+        return Fail("Invalid call for car");
     }
 
-    return As<Cell>(first_arg)->GetFirst();
+    return cell->GetFirst();
 }
 
-std::shared_ptr<Object> Interpreter::CdrHandler(std::shared_ptr<Object> head) {
-    PredicateCorrectnessCheck("cdr", head);
+Ref<Object> Interpreter::CdrHandler(const Ref<Object>& head) {
+    if (!PredicateCorrectnessCheck("cdr", head)) {
+        return nullptr;
+    }
 
-    std::shared_ptr<Object> first_arg = GetAST(As<Cell>(head)->GetFirst());
+    Ref<Object> first_arg = GetAST(As<Cell>(head)->GetFirst());
+    if (failed_) {
+        return nullptr;
+    }
+    Cell* cell = As<Cell>(first_arg);
 
-    if (!Is<Cell>(first_arg)) {
-        throw RuntimeError("Invalid call for car");
+    if (cell == nullptr) {
+        return Fail("Invalid call for car");
     }
 
-    return As<Cell>(first_arg)->GetSecond();
+    return cell->GetSecond();
 }
 
-std::shared_ptr<Cell> Interpreter::ListHandler(std::shared_ptr<Object> head) {
+Ref<Cell> Interpreter::ListHandler(const Ref<Object>& head) {
     if (head == nullptr) {
         return nullptr;
     }
     if (!Is<Cell>(head)) {
-        throw RuntimeError("Invalid call for list");
+        return Fail("Invalid call for list");
     }
-    return As<Cell>(head);
+    return Ref<Cell>(As<Cell>(head));
 }
 
-std::shared_ptr<Object> Interpreter::ListRefHandler(std::shared_ptr<Object> head) {
-    std::vector<std::shared_ptr<Object>> elements = ToObjVector(head);
-    if (elements.size() != 2) {
-        throw RuntimeError("Invalid number of arguments for list-ref");
+Ref<Object> Interpreter::ListRefHandler(const Ref<Object>& head) {
+    std::vector<Ref<Object>>& elements = session_.GetObjectScratch();
+    size_t start = CollectObjects(head);
+    if (failed_) {
+        return nullptr;
     }
+    if (elements.size() - start != 2) {
+        return Fail("Invalid number of arguments for list-ref");
+    }
+
+    Ref<Object> list = std::move(elements[start]);
+    Ref<Object> index_object = std::move(elements[start + 1]);
+    elements.resize(start);
 
-    std::shared_ptr<Object> ptr_to_check = elements[0];
+    Object* ptr_to_check = list.Get();
     if (ptr_to_check != nullptr) {
         if (!Is<Cell>(ptr_to_check)) {
-            throw RuntimeError("Invalid arguments for list-ref");
+            return Fail("Invalid arguments for list-ref");
         }
 
         while (ptr_to_check != nullptr) {
             if (!Is<Cell>(ptr_to_check)) {
-                throw RuntimeError("Invalid arguments for list-ref");
+                return Fail("Invalid arguments for list-ref");
             }
 
             assert(Is<Cell>(ptr_to_check));
 
-            ptr_to_check = As<Cell>(ptr_to_check)->GetSecond();
+            ptr_to_check = As<Cell>(ptr_to_check)->GetSecond().Get();
         }
+    }
 
-        if (!Is<Number>(elements[1])) {
-            throw RuntimeError("Invalid arguments for list-ref");
-        }
+    Number* index = As<Number>(index_object);
+    if (index == nullptr) {
+        return Fail("Invalid arguments for list-ref");
     }
 
-    std::vector<std::shared_ptr<Object>> list_elems = ToObjVector(elements[0]);
+    size_t list_start = CollectObjects(list);
+    if (failed_) {
+        return nullptr;
+    }
+    size_t list_size = elements.size() - list_start;
 
-    if (As<Number>(elements[1])->GetValue() < 0 ||
-        (list_elems.size() <= As<Number>(elements[1])->GetValue())) {
-        throw RuntimeError("Invalid index in list-ref");
+    if (index->GetValue() < 0 || (list_size <= static_cast<size_t>(index->GetValue()))) {
+        return Fail("Invalid index in list-ref");
     }
 
-    return list_elems[As<Number>(elements[1])->GetValue()];
+    Ref<Object> result = std::move(elements[list_start + index->GetValue()]);
+    elements.resize(list_start);
+    return result;
 }
 
-std::shared_ptr<Object> Interpreter::ListTailHandler(std::shared_ptr<Object> head) {
-    std::vector<std::shared_ptr<Object>> elements = ToObjVector(head);
-    if (elements.size() != 2) {
-        throw RuntimeError("Invalid number of arguments for list-ref");
+Ref<Object> Interpreter::ListTailHandler(const Ref<Object>& head) {
+    std::vector<Ref<Object>>& elements = session_.GetObjectScratch();
+    size_t start = CollectObjects(head);
+    if (failed_) {
+        return nullptr;
+    }
+    if (elements.size() - start != 2) {
+        return Fail("Invalid number of arguments for list-ref");
     }
 
-    std::shared_ptr<Object> ptr_to_check = elements[0];
+    Ref<Object> list = std::move(elements[start]);
+    Ref<Object> index_object = std::move(elements[start + 1]);
+    elements.resize(start);
+
+    Object* ptr_to_check = list.Get();
     if (ptr_to_check != nullptr) {
         if (!Is<Cell>(ptr_to_check)) {
-            throw RuntimeError("Invalid arguments for list-ref");
+            return Fail("Invalid arguments for list-ref");
         }
 
         while (ptr_to_check != nullptr) {
             if (!Is<Cell>(ptr_to_check)) {
-                throw RuntimeError("Invalid arguments for list-ref");
+                return Fail("Invalid arguments for list-ref");
             }
 
             assert(Is<Cell>(ptr_to_check));
 
-            ptr_to_check = As<Cell>(ptr_to_check)->GetSecond();
+            ptr_to_check = As<Cell>(ptr_to_check)->GetSecond().Get();
         }
+    }
 
-        if (!Is<Number>(elements[1])) {
-            throw RuntimeError("Invalid arguments for list-ref");
-        }
+    Number* index = As<Number>(index_object);
+    if (index == nullptr) {
+        return Fail("Invalid arguments for list-ref");
     }
 
-    std::vector<std::shared_ptr<Object>> list_elems = ToObjVector(elements[0]);
+    size_t list_start = CollectObjects(list);
+    if (failed_) {
+        return nullptr;
+    }
+    size_t list_size = elements.size() - list_start;
+    elements.resize(list_start);
 
-    if (As<Number>(elements[1])->GetValue() > list_elems.size()) {
-        throw RuntimeError("Invalid index in list-tail");
+    if (index->GetValue() < 0 || static_cast<size_t>(index->GetValue()) > list_size) {
+        return Fail("Invalid index in list-tail");
     }
 
-    size_t skipped_count = 0;
-    std::shared_ptr<Cell> new_head = As<Cell>(elements[0]);
-    while (skipped_count < As<Number>(elements[1])->GetValue()) {
-        new_head = As<Cell>(new_head->GetSecond());
+    int skipped_count = 0;
+    Object* new_head = list.Get();
+    while (skipped_count < index->GetValue()) {
+        new_head = As<Cell>(new_head)->GetSecond().Get();
         ++skipped_count;
     }
 
-    return new_head;
-}
\ No newline at end of file
+    return Ref<Object>(new_head);
+}
@@ -1,45 +1,269 @@
 #pragma once
+#include "async.h"
+#include "error.h"
+#include "heap.h"
+#include "latency.h"
+#include "parse_cache.h"
 #include "parser.h"
+#include "ports.h"
+#include "profile.h"
+#include "reclaimer.h"
+#include "result_cache.h"
+#include "run_limits.h"
+#include "session.h"
 #include "tokenizer.h"
+#include "trace.h"
+#include "workload.h"
 #include "parser.h"
 
+#include <cstdint>
+#include <memory>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <functional>
 
+enum class BatchStatus : uint8_t { kOk, kSyntaxError, kRuntimeError, kNameError, kLimitError };
+
+struct BatchItem {
+    size_t offset;
+    size_t size;
+    BatchStatus status;
+};
+
+// Outcome of RunBatch: the printed result or the error message of every item, back to back in
+// one buffer.
+struct BatchResult {
+    std::string_view Get(size_t index) const;
+
+    std::string buffer;
+    std::vector<BatchItem> items;
+};
+
+// Handlers borrow their arguments: the AST passed in is kept alive by the caller, so a handler
+// only takes a reference when a value escapes into a new cell or into its result.
+//
+// Evaluation does not throw: a failing handler records the error and returns null, and every
+// caller bails out as soon as it sees the failure. TryRun hands the error back to the caller;
+// Run, RunInPlace and the To*/*ToString helpers turn it into the matching exception.
+//
+// By default objects are reference counted. EnableGc() switches Run to a per-interpreter
+// collected heap; the parsed program and the result are its roots while Run is in progress.
+//
+// display, write and newline print to the output port set with SetOutputPort and fail without
+// one. They return the unspecified value, a symbol with an empty name that prints as nothing.
+// read takes the next datum from the input port set with SetInputPort, or the eof object,
+// printed #[eof], at its end. The reader produces neither symbol.
+//
+// RunAsync evaluates with an explicit stack of pending calls instead of recursing, so it can
+// suspend between two calls and let the scheduler run other requests on the same thread.
+//
+// An Interpreter is not thread-safe, but distinct interpreters share no mutable state and can be
+// used from different threads at the same time. Objects must not cross from one interpreter to
+// another unless they were Share()d first. A server runs one interpreter per worker thread.
 class Interpreter {
 public:
+    using Comparator = bool (*)(int, int);
+    using Operation = int (*)(int, int);
+
     std::string Run(const std::string&);
 
-    std::shared_ptr<Object> GetAST(std::shared_ptr<Object> head);
-    std::shared_ptr<Object> Evaluate(std::shared_ptr<Cell> head);
-    std::string ASTToString(std::shared_ptr<Object> head);
-    std::string CellToString(std::shared_ptr<Cell> head);
-
-    std::vector<int> ToIntVector(std::shared_ptr<Object> head);
-    std::vector<std::shared_ptr<Object>> ToObjVector(std::shared_ptr<Object> head);
-    void ToList(std::vector<std::shared_ptr<Object>>& vec, std::shared_ptr<Cell> head);
-
-    std::shared_ptr<Bool> CmpHandler(std::shared_ptr<Object> head,
-                                     std::function<bool(int, int)> comparator);
-    std::shared_ptr<Number> IntHandler(std::shared_ptr<Object> head,
-                                       std::function<int(int, int)> comparator);
-    std::shared_ptr<Bool> NumberHandler(std::shared_ptr<Object> head);
-    std::shared_ptr<Number> AbsHandler(std::shared_ptr<Object> head);
-
-    std::shared_ptr<Object> AndHandler(std::shared_ptr<Object> head);
-    std::shared_ptr<Object> OrHandler(std::shared_ptr<Object> head);
-    std::shared_ptr<Bool> NotHandler(std::shared_ptr<Object> head);
-    std::shared_ptr<Bool> BooleanHandler(std::shared_ptr<Object> head);
-
-    std::shared_ptr<Bool> PairHandler(std::shared_ptr<Object> head);
-    std::shared_ptr<Bool> NullHandler(std::shared_ptr<Object> head);
-    std::shared_ptr<Bool> IsListHandler(std::shared_ptr<Object> head);
-
-    std::shared_ptr<Cell> ConsHandler(std::shared_ptr<Object> head);
-    std::shared_ptr<Object> CarHandler(std::shared_ptr<Object> head);
-    std::shared_ptr<Object> CdrHandler(std::shared_ptr<Object> head);
-    std::shared_ptr<Cell> ListHandler(std::shared_ptr<Object> head);
-    std::shared_ptr<Object> ListRefHandler(std::shared_ptr<Object> head);
-    std::shared_ptr<Object> ListTailHandler(std::shared_ptr<Object> head);
+    // Same as Run, but prints into the session's output buffer. The view stays valid until the
+    // next call; a warmed-up interpreter serves typical requests without allocating.
+    std::string_view RunInPlace(std::string_view input);
+
+    // Non-throwing RunInPlace. Malformed input costs about as much as a successful run.
+    Expected<std::string_view> TryRun(std::string_view input);
+
+    // TryRun for a program read elsewhere, such as by a DataLoader or on another thread; the
+    // interpreter takes it over. There is no source to look up in the caches or to record, so
+    // only the limits, the heap and the latency and allocation meters apply. Objects read on
+    // another thread were counted by that thread's allocation counters, so they show up here as
+    // freed without having been allocated.
+    Expected<std::string_view> TryRunProgram(Ref<Object> program);
+
+    // Evaluates independent expressions, recording a failure in the item instead of throwing.
+    // The result is reused by the next call.
+    const BatchResult& RunBatch(std::span<const std::string_view> inputs);
+
+    // Coroutine flavour of TryRun that yields to the scheduler every GetSliceSteps() steps.
+    // Results match TryRun, except that a call whose arguments fail reports the argument's error
+    // even where the synchronous path would reject the call first. Only one RunAsync may be in
+    // flight per interpreter; interleave requests by giving each one its own interpreter.
+    Task<Expected<std::string>> RunAsync(Scheduler* scheduler, std::string input);
+
+    void EnableGc(const GcOptions& options = {});
+    GcStats GetGcStats() const;
+
+    // Hash-conses quoted data read from now on, so repeated sublists and symbols share storage.
+    void EnableHashConsing();
+    HashConsStats GetHashConsStats() const;
+
+    // Records calls, time and argument sizes per builtin until disabled, which drops the
+    // counters. Does nothing when the profiler is not built in.
+    void EnableProfiling();
+    void DisableProfiling();
+    Profile GetProfile() const;
+
+    // Records the runs that follow into the tracer until it is reset to null. Switch it per
+    // request to trace a sample of them.
+    void SetTracer(Tracer* tracer);
+
+    // min_size is compared with the length of the source plus the printed result. What the
+    // reclaimer frees comes off the live counts of the allocation stats at the start of the next
+    // run, see Reclaimer::Account. The reclaimer must outlive the interpreter or be reset first.
+    void SetReclaimer(Reclaimer* reclaimer, size_t min_size = 1 << 16);
+
+    // Runs look up their normalized token stream in the cache first and store successful
+    // results in it, unless the expression names an impure builtin. The cache may be shared
+    // with interpreters on other threads and must outlive the runs it is set for. A hit is not
+    // charged against the limits, which only apply to runs that evaluate; cancellation is still
+    // checked first.
+    void SetResultCache(ResultCache* cache);
+
+    // Runs take their program from the cache when the same source was read before, and add
+    // what they read to it. Like the result cache it can be shared between threads. With the
+    // collected heap enabled, programs are still read into reference counted objects.
+    void SetParseCache(ParseCache* cache);
+
+    // Run, RunInPlace, TryRun and RunBatch time their phases into a shard of the recorder, which
+    // must outlive the interpreter's runs. Setting the same recorder again keeps the shard.
+    void SetLatencyRecorder(LatencyRecorder* recorder);
+
+    // Run, RunInPlace, TryRun and RunBatch append every input with its outcome and timing to the
+    // recorder, which may be shared between threads and must outlive the runs it is set for.
+    void SetWorkloadRecorder(WorkloadRecorder* recorder);
+
+    // Where display, write and newline print. The port must outlive the runs it is set for;
+    // runs do not flush it.
+    void SetOutputPort(OutputPort* port);
+
+    // Where read takes its datums from; it must outlive the runs it is set for.
+    void SetInputPort(InputPort* port);
+
+    // Objects allocated by Run, RunInPlace, TryRun and RunBatch, per type: over all runs of the
+    // interpreter and over the last one. Live counts are what the runs left behind, such as
+    // programs kept by a parse cache. Peaks are the most live bytes a run reached above what
+    // was live when it started, the highest over all runs for the interpreter.
+    const AllocationStats& GetAllocationStats() const;
+    const AllocationStats& GetLastRunAllocationStats() const;
+
+    // Calls evaluated by the last run, as counted against RunLimits::max_steps; zero when its
+    // result came from the cache.
+    uint64_t GetLastRunSteps() const;
+
+    // Applies to every following run.
+    void SetLimits(const RunLimits& limits);
+
+    // The token is polled while a run evaluates and must outlive the runs it is set for.
+    void SetCancellationToken(const CancellationToken* token);
+
+    Ref<Object> GetAST(const Ref<Object>& head);
+    Ref<Object> Evaluate(Cell* head);
+    std::string ASTToString(const Ref<Object>& head);
+    std::string CellToString(Cell* head);
+
+    std::vector<int> ToIntVector(const Ref<Object>& head);
+    std::vector<Ref<Object>> ToObjVector(const Ref<Object>& head);
+    // Builds a new proper list of the elements; null when there are none.
+    Ref<Object> ToList(const std::vector<Ref<Object>>& vec);
+
+    Ref<Bool> CmpHandler(const Ref<Object>& head, Comparator comparator);
+    Ref<Number> IntHandler(const Ref<Object>& head, Operation operation);
+    Ref<Bool> NumberHandler(const Ref<Object>& head);
+    Ref<Number> AbsHandler(const Ref<Object>& head);
+
+    Ref<Object> AndHandler(const Ref<Object>& head);
+    Ref<Object> OrHandler(const Ref<Object>& head);
+    Ref<Bool> NotHandler(const Ref<Object>& head);
+    Ref<Bool> BooleanHandler(const Ref<Object>& head);
+
+    Ref<Bool> PairHandler(const Ref<Object>& head);
+    Ref<Bool> NullHandler(const Ref<Object>& head);
+    Ref<Bool> IsListHandler(const Ref<Object>& head);
+
+    Ref<Cell> ConsHandler(const Ref<Object>& head);
+    Ref<Object> CarHandler(const Ref<Object>& head);
+    Ref<Object> CdrHandler(const Ref<Object>& head);
+    Ref<Cell> ListHandler(const Ref<Object>& head);
+    Ref<Object> ListRefHandler(const Ref<Object>& head);
+    Ref<Object> ListTailHandler(const Ref<Object>& head);
+
+    // write and display print alike: there are no strings or characters to tell them apart.
+    Ref<Object> DisplayHandler(const Ref<Object>& head, std::string_view func_name);
+    Ref<Object> NewlineHandler(const Ref<Object>& head);
+    Ref<Object> ReadHandler(const Ref<Object>& head);
+    Ref<Bool> EofObjectHandler(const Ref<Object>& head);
+
+private:
+    // How the explicit-stack evaluator treats the arguments of a call: evaluate all of them
+    // before the call, evaluate them until one settles and/or, or let the handler see them as is.
+    enum class ArgumentMode : uint8_t { kDirect, kEager, kAnd, kOr };
+    struct AsyncFrame;
+
+    Ref<Object> EvaluateCall(Cell* head);
+    // Evaluates the call between the profiler's and the tracer's hooks.
+    Ref<Object> InstrumentedCall(Cell* head);
+    ArgumentMode GetArgumentMode(const Cell* head) const;
+    size_t CollectInts(const Ref<Object>& head);
+    size_t CollectObjects(const Ref<Object>& head);
+    void Print(const Ref<Object>& head, std::string* out);
+    void PrintCell(Cell* head, std::string* out);
+
+    bool RunInto(std::string_view input, std::string* output);
+    bool EvaluateInput(std::string_view input, std::string* output);
+    bool EvaluateProgram(Ref<Object> head, size_t source_size, PhaseClock* clock,
+                         std::string* output);
+    Expected<Ref<Object>> ReadProgram(std::string_view input);
+    bool BuildCacheKey(std::string* key);
+    void Safepoint();
+
+    bool PushFrame(Cell* call, std::vector<AsyncFrame>* frames);
+    bool EvaluateSlice(std::vector<AsyncFrame>* frames, Ref<Object>* result, uint32_t steps);
+
+    // Records a runtime error at the call being evaluated; returns null for the handler to pass on.
+    std::nullptr_t Fail(std::string message, ErrorKind kind = ErrorKind::kRuntime);
+    void StartMeters();
+    bool CheckLimits();
+    bool Refuel();
+    void ThrowIfFailed();
+    bool PredicateCorrectnessCheck(std::string_view func_name, const Ref<Object>& head);
+
+    std::unique_ptr<Heap> heap_;
+    std::unique_ptr<HashConsTable> hash_cons_;
+    std::unique_ptr<Profiler> profiler_;
+    Tracer* tracer_ = nullptr;
+    // Whether the profiler or the tracer is on, so Evaluate checks a single flag.
+    bool instrumented_ = false;
+    Reclaimer* reclaimer_ = nullptr;
+    Reclaimer::Account reclaim_account_;
+    size_t reclaim_min_size_ = 0;
+    ResultCache* result_cache_ = nullptr;
+    ParseCache* parse_cache_ = nullptr;
+    LatencyRecorder* latency_recorder_ = nullptr;
+    LatencyRecorder::Shard* latency_shard_ = nullptr;
+    WorkloadRecorder* workload_recorder_ = nullptr;
+    OutputPort* output_port_ = nullptr;
+    InputPort* input_port_ = nullptr;
+
+    bool failed_ = false;
+    Error error_;
+    const Cell* current_call_ = nullptr;
+
+    // Limits are checked when the steps handed out in chunks run out, so the common path of
+    // Evaluate only decrements a counter and compares the depth.
+    RunLimits limits_;
+    const CancellationToken* cancellation_ = nullptr;
+    uint64_t steps_left_ = UINT64_MAX;
+    uint64_t steps_at_start_ = UINT64_MAX;
+    uint32_t steps_until_check_ = 0;
+    size_t depth_left_ = SIZE_MAX;
+    uint64_t bytes_at_start_ = 0;
+    int64_t live_bytes_at_start_ = 0;
+
+    AllocationStats allocations_;
+    AllocationStats last_run_allocations_;
+
+    BatchResult batch_;
+    Session session_;
 };
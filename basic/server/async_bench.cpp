@@ -0,0 +1,105 @@
+// Latency of short requests mixed with long ones on one thread, evaluated with RunAsync.
+//
+//   scheme_async_bench [clients] [requests_per_client]
+//
+// Every client owns an Interpreter and sends its requests one after another; one in twenty is
+// long. Prints p50/p99 latency of short and long requests for several step budgets per slice,
+// the first of which never yields and so shows what a run-to-completion server would do.
+// Reading a request is not sliced, so a long request still holds the thread while it is parsed.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../async.h"
+#include "../scheme.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* kShortRequests[] = {
+    "(+ 1 2 3 (* 4 5) 6 7 8 9 10)",
+    "(list-tail '(1 2 3 4 5 6 7 8 9 10) 4)",
+    "(max (- 50 20) (* 7 3) (abs -7) (/ 100 5))",
+    "(and (< 1 5 100) (list? '(1 2 3)) (not #f) (= 3 3))",
+    "(car (cdr (cons 1 (cons 2 '(3 4 5)))))",
+};
+
+// About 20000 evaluation steps.
+std::string MakeLongRequest() {
+    std::string request = "(+";
+    for (int i = 0; i < 4000; ++i) {
+        request += " (* 2 (+ 1 (- 3 2)) (abs -1))";
+    }
+    request += ')';
+    return request;
+}
+
+struct Latencies {
+    std::vector<double> short_us;
+    std::vector<double> long_us;
+};
+
+Task<void> Client(Scheduler* scheduler, Interpreter* interpreter, size_t client, size_t requests,
+                  const std::string* long_request, Latencies* latencies) {
+    for (size_t i = 0; i < requests; ++i) {
+        bool is_long = (client + i) % 20 == 0;
+        std::string request = is_long ? *long_request
+                                      : kShortRequests[(client + i) % std::size(kShortRequests)];
+        // A request arrives at the back of the queue and waits for the ones ahead of it.
+        auto start = Clock::now();
+        co_await scheduler->Yield();
+        Expected<std::string> result = co_await interpreter->RunAsync(scheduler, request);
+        std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+        if (!result) {
+            std::fprintf(stderr, "%s\n", result.GetError().message.c_str());
+        }
+        (is_long ? latencies->long_us : latencies->short_us).push_back(elapsed.count());
+    }
+}
+
+double Percentile(std::vector<double>* values, double fraction) {
+    if (values->empty()) {
+        return 0;
+    }
+    size_t index = std::min(values->size() - 1, static_cast<size_t>(fraction * values->size()));
+    std::nth_element(values->begin(), values->begin() + index, values->end());
+    return (*values)[index];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t clients = argc > 1 ? std::stoul(argv[1]) : 32;
+    size_t requests = argc > 2 ? std::stoul(argv[2]) : 200;
+    const std::string long_request = MakeLongRequest();
+
+    std::printf("%12s %12s %12s %12s %12s %12s\n", "slice_steps", "short_p50", "short_p99",
+                "long_p50", "long_p99", "requests/s");
+    for (uint32_t slice_steps : {UINT32_MAX, 4096u, 1024u, 256u, 64u}) {
+        std::vector<Interpreter> interpreters(clients);
+        Scheduler scheduler(slice_steps);
+        Latencies latencies;
+        for (size_t client = 0; client < clients; ++client) {
+            scheduler.Spawn(Client(&scheduler, &interpreters[client], client, requests,
+                                   &long_request, &latencies));
+        }
+
+        auto start = Clock::now();
+        scheduler.Run();
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+
+        double total = static_cast<double>(latencies.short_us.size() + latencies.long_us.size());
+        std::printf("%12s %10.1fus %10.1fus %10.1fus %10.1fus %12.0f\n",
+                    slice_steps == UINT32_MAX ? "unlimited" : std::to_string(slice_steps).c_str(),
+                    Percentile(&latencies.short_us, 0.5), Percentile(&latencies.short_us, 0.99),
+                    Percentile(&latencies.long_us, 0.5), Percentile(&latencies.long_us, 0.99),
+                    total / elapsed.count());
+    }
+    return 0;
+}
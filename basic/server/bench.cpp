@@ -0,0 +1,87 @@
+// Throughput of the evaluation pool from one up to N worker threads.
+//
+//   scheme_server_bench [max_threads] [requests]
+//
+// Every worker evaluates with its own Interpreter, as scheme_server does. Prints requests per
+// second, the speedup over one thread and the parallel efficiency for each thread count.
+
+#include <chrono>
+#include <cstdio>
+#include <latch>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../error.h"
+#include "../scheme.h"
+#include "../thread_pool.h"
+
+namespace {
+
+std::vector<std::string> MakeRequests(size_t count) {
+    static const char* kTemplates[] = {
+        "(+ {} 2 3 {} 5 6 7 8 9 10)",
+        "(list-tail '(1 2 3 4 5 6 7 8 {} {}) 4)",
+        "(max (- {} 20) (* {} 3) (abs -7) (/ 100 5))",
+        "(and (< 1 {} 100) (list? '(1 2 3)) (not #f) (= {} {}))",
+        "(car (cdr (cons 1 (cons {} (list 3 {} 5)))))",
+    };
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> value(1, 1000);
+    std::vector<std::string> requests;
+    requests.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string request;
+        for (const char* c = kTemplates[i % std::size(kTemplates)]; *c != '\0'; ++c) {
+            if (c[0] == '{' && c[1] == '}') {
+                request += std::to_string(value(gen));
+                ++c;
+            } else {
+                request += *c;
+            }
+        }
+        requests.push_back(std::move(request));
+    }
+    return requests;
+}
+
+double Measure(const std::vector<std::string>& requests, size_t threads) {
+    WorkStealingPool pool(threads);
+    std::latch done(requests.size());
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& request : requests) {
+        pool.Submit([&request, &done] {
+            thread_local Interpreter interpreter;
+            try {
+                interpreter.RunInPlace(request);
+            } catch (const std::exception&) {
+            }
+            done.count_down();
+        });
+    }
+    done.wait();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return requests.size() / elapsed.count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t max_threads = argc > 1 ? std::stoul(argv[1]) : std::thread::hardware_concurrency();
+    size_t count = argc > 2 ? std::stoul(argv[2]) : 200000;
+    max_threads = std::max<size_t>(max_threads, 1);
+
+    auto requests = MakeRequests(count);
+    std::printf("%8s %14s %8s %10s\n", "threads", "requests/s", "speedup", "efficiency");
+    double base = 0;
+    for (size_t threads = 1; threads <= max_threads; ++threads) {
+        double rate = Measure(requests, threads);
+        if (threads == 1) {
+            base = rate;
+        }
+        std::printf("%8zu %14.0f %8.2f %9.0f%%\n", threads, rate, rate / base,
+                    100 * rate / base / threads);
+    }
+    return 0;
+}
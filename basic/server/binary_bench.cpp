@@ -0,0 +1,106 @@
+// Load speed of binary images against tokenizing and reading the same data as text.
+//
+//   scheme_binary_bench [records]
+//
+// Generates records like (reading sensor-7 1700000123 (ok 21 -3 #t)), writes them as text and
+// as a binary image, then times reading the text, loading the mapped image into objects, and
+// summing the numbers of the image through lazy views without building any objects.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../binary.h"
+#include "../parser.h"
+
+namespace {
+
+std::string MakeRecord(std::mt19937* gen) {
+    static const char* kStatuses[] = {"ok", "ok", "ok", "warn", "fail"};
+    std::string record = "(reading sensor-" + std::to_string((*gen)() % 500) + ' ';
+    record += std::to_string(1700000000 + (*gen)() % 100000000) + " (";
+    record += kStatuses[(*gen)() % std::size(kStatuses)];
+    for (int i = 0; i < 8; ++i) {
+        record += ' ' + std::to_string(static_cast<int>((*gen)() % 2001) - 1000);
+    }
+    record += (*gen)() % 2 ? " #t))" : " #f))";
+    return record;
+}
+
+int64_t SumNumbers(BinaryNode node) {
+    int64_t sum = 0;
+    while (node.GetKind() == BinaryNode::Kind::kCell) {
+        sum += SumNumbers(node.GetFirst());
+        node = node.GetSecond();
+    }
+    return node.GetKind() == BinaryNode::Kind::kNumber ? sum + node.GetNumber() : sum;
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t records = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 500000;
+
+    std::mt19937 gen(42);
+    std::vector<std::string> lines;
+    size_t text_bytes = 0;
+    BinaryWriter writer;
+    for (size_t i = 0; i < records; ++i) {
+        lines.push_back(MakeRecord(&gen));
+        text_bytes += lines.back().size() + 1;
+        std::stringstream stream(lines.back());
+        Tokenizer tokenizer(&stream);
+        writer.Add(Read(&tokenizer));
+    }
+
+    const char* path = "scheme_binary_bench.bin";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << writer.Finish();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t read = 0;
+    for (const std::string& line : lines) {
+        std::stringstream stream(line);
+        Tokenizer tokenizer(&stream);
+        read += TryRead(&tokenizer).HasValue();
+    }
+    double text_seconds = SecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    auto file = MappedFile::Open(path);
+    auto image = BinaryImage::Open(file.ValueOrThrow().GetBytes());
+    size_t loaded = 0;
+    for (size_t i = 0; i < image.ValueOrThrow().GetTreeCount(); ++i) {
+        loaded += image->Load(i).HasValue();
+    }
+    double load_seconds = SecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    int64_t sum = 0;
+    for (size_t i = 0; i < image->GetTreeCount(); ++i) {
+        sum += SumNumbers(image->GetTree(i));
+    }
+    double view_seconds = SecondsSince(start);
+    std::remove(path);
+
+    size_t image_bytes = file->GetBytes().size();
+    std::printf("%zu records: text %.1f MB, image %.1f MB\n", records, text_bytes / 1e6,
+                image_bytes / 1e6);
+    std::printf("%12s %10s %12s\n", "mode", "ms", "records/s");
+    std::printf("%12s %10.1f %12.0f\n", "text read", text_seconds * 1e3, read / text_seconds);
+    std::printf("%12s %10.1f %12.0f\n", "image load", load_seconds * 1e3, loaded / load_seconds);
+    std::printf("%12s %10.1f %12.0f  (sum %lld)\n", "image view", view_seconds * 1e3,
+                image->GetTreeCount() / view_seconds, static_cast<long long>(sum));
+    return 0;
+}
@@ -0,0 +1,132 @@
+// Memory taken by parsed requests with and without hash-consing of quoted data.
+//
+//   scheme_hash_cons_bench [file]
+//
+// Reads one request per line from file, or generates dashboard-like requests whose quoted
+// tables repeat rows, statuses and sensor names. All parsed programs are kept alive, as a
+// parse cache would, and the distinct objects reachable from them are counted.
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "../hash_cons.h"
+#include "../parser.h"
+
+namespace {
+
+std::vector<std::string> MakeRequests(size_t count) {
+    static const char* kStatuses[] = {"ok", "ok", "ok", "warn", "fail"};
+    static const char* kRows[] = {"(0 0 0)", "(0 0 0)", "(0 0 0)", "(1 0 0)", "(0 1 0)",
+                                  "(0 0 1)"};
+    std::mt19937 gen(42);
+    std::vector<std::string> requests;
+    for (size_t i = 0; i < count; ++i) {
+        std::string request = "(list-tail '(";
+        for (int row = 0; row < 40; ++row) {
+            request += "(sensor-" + std::to_string(gen() % 20) + ' ';
+            request += kStatuses[gen() % std::size(kStatuses)];
+            request += ' ';
+            request += kRows[gen() % std::size(kRows)];
+            request += ") ";
+        }
+        request += ") " + std::to_string(gen() % 40) + ')';
+        requests.push_back(std::move(request));
+    }
+    return requests;
+}
+
+struct Footprint {
+    size_t objects = 0;
+    size_t bytes = 0;
+};
+
+// Distinct objects reachable from the programs and the heap memory they own.
+Footprint Measure(const std::vector<Ref<Object>>& programs) {
+    class Walker : public ObjectVisitor {
+    public:
+        void Visit(Ref<Object>& slot) override {
+            if (slot != nullptr && seen.insert(slot.Get()).second) {
+                stack.push_back(slot.Get());
+            }
+        }
+
+        std::unordered_set<Object*> seen;
+        std::vector<Object*> stack;
+    };
+
+    Walker walker;
+    Footprint footprint;
+    for (Ref<Object> program : programs) {
+        walker.Visit(program);
+        while (!walker.stack.empty()) {
+            Object* object = walker.stack.back();
+            walker.stack.pop_back();
+            ++footprint.objects;
+            if (Is<Cell>(object)) {
+                footprint.bytes += sizeof(Cell);
+            } else if (Symbol* symbol = As<Symbol>(object)) {
+                footprint.bytes += sizeof(Symbol);
+                if (symbol->GetName().capacity() >= sizeof(std::string)) {
+                    footprint.bytes += symbol->GetName().capacity() + 1;
+                }
+            } else if (Is<Quote>(object)) {
+                footprint.bytes += sizeof(Quote);
+            } else {
+                footprint.bytes += sizeof(Number);
+            }
+            object->VisitChildren(&walker);
+        }
+    }
+    return footprint;
+}
+
+std::vector<Ref<Object>> ReadAll(const std::vector<std::string>& requests, HashConsTable* table,
+                                 double* seconds) {
+    std::vector<Ref<Object>> programs;
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& request : requests) {
+        std::stringstream stream(request);
+        Tokenizer tokenizer(&stream);
+        auto program = TryRead(&tokenizer, 0, table);
+        if (program) {
+            programs.push_back(std::move(*program));
+        }
+    }
+    *seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return programs;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::vector<std::string> requests;
+    if (argc > 1) {
+        std::ifstream file(argv[1]);
+        for (std::string line; std::getline(file, line);) {
+            requests.push_back(std::move(line));
+        }
+    } else {
+        requests = MakeRequests(5000);
+    }
+
+    double plain_seconds = 0;
+    double consed_seconds = 0;
+    Footprint plain = Measure(ReadAll(requests, nullptr, &plain_seconds));
+    HashConsTable table;
+    Footprint consed = Measure(ReadAll(requests, &table, &consed_seconds));
+
+    std::printf("%12s %12s %12s %10s\n", "mode", "objects", "bytes", "read_ms");
+    std::printf("%12s %12zu %12zu %10.1f\n", "plain", plain.objects, plain.bytes,
+                plain_seconds * 1e3);
+    std::printf("%12s %12zu %12zu %10.1f\n", "hash-consed", consed.objects, consed.bytes,
+                consed_seconds * 1e3);
+    std::printf("saved %.1f%% of the bytes over %zu requests\n",
+                100.0 * (1 - static_cast<double>(consed.bytes) / plain.bytes), requests.size());
+    return 0;
+}
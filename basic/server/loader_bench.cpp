@@ -0,0 +1,79 @@
+// Throughput of DataLoader over a generated data dump, doubling the number of threads.
+//
+//   scheme_loader_bench [megabytes] [max_threads]
+//
+// Writes records like (reading sensor-7 1700000123 (ok 21 -3 #t)), one per line, to a
+// temporary file and loads it back without a pool, then with every pool size up to max_threads,
+// dropping each datum once it is read.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "../data_loader.h"
+
+namespace {
+
+std::string MakeRecord(std::mt19937* gen) {
+    static const char* kStatuses[] = {"ok", "ok", "ok", "warn", "fail"};
+    std::string record = "(reading sensor-" + std::to_string((*gen)() % 500) + ' ';
+    record += std::to_string(1700000000 + (*gen)() % 100000000) + " (";
+    record += kStatuses[(*gen)() % std::size(kStatuses)];
+    for (int i = 0; i < 8; ++i) {
+        record += ' ' + std::to_string(static_cast<int>((*gen)() % 2001) - 1000);
+    }
+    record += (*gen)() % 2 ? " #t))\n" : " #f))\n";
+    return record;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 256;
+    size_t max_threads =
+        argc > 2 ? std::strtoull(argv[2], nullptr, 10) : std::thread::hardware_concurrency();
+
+    const char* path = "scheme_loader_bench.scm";
+    size_t bytes = 0;
+    {
+        std::mt19937 gen(42);
+        std::ofstream out(path, std::ios::binary);
+        while (bytes < megabytes << 20) {
+            std::string record = MakeRecord(&gen);
+            bytes += record.size();
+            out << record;
+        }
+    }
+
+    std::printf("%zu MB\n%8s %10s %10s %12s\n", bytes >> 20, "threads", "ms", "MB/s", "datums");
+    for (size_t threads = 0; threads <= max_threads; threads = std::max<size_t>(2 * threads, 1)) {
+        std::optional<WorkStealingPool> pool;
+        if (threads > 0) {
+            pool.emplace(threads);
+        }
+        auto start = std::chrono::steady_clock::now();
+        auto opened = DataLoader::Open(path, pool ? &*pool : nullptr);
+        DataLoader* loader = opened.ValueOrThrow().get();
+        size_t datums = 0;
+        Ref<Object> datum;
+        while (loader->Next(&datum)) {
+            ++datums;
+        }
+        if (loader->GetError() != nullptr) {
+            std::fprintf(stderr, "%s\n", loader->GetError()->message.c_str());
+            return 1;
+        }
+        double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%8zu %10.1f %10.1f %12zu\n", threads, seconds * 1e3, bytes / seconds / 1e6,
+                    datums);
+    }
+    std::remove(path);
+    return 0;
+}
@@ -0,0 +1,558 @@
+// Evaluation server: reads requests from stdin or from clients of a Unix domain socket and
+// evaluates them on a work-stealing pool, one Interpreter per worker thread.
+//
+//   scheme_server [--threads N] [--socket PATH] [--framing line|length] [--tagged] [--window N]
+//                 [--max-frame-bytes N] [--cache-bytes N] [--metrics PATH] [--trace-every N]
+//                 [--trace-dir DIR] [--record PATH]
+//
+// With line framing every request and response is a single line. With length framing each
+// one is preceded by its size in bytes as a decimal number on a line of its own. A request, or
+// a line, longer than --max-frame-bytes, 16 MiB by default, ends its connection. Responses
+// come back in request order, or as soon as they are ready with --tagged, prefixed by the
+// zero-based index of the request on its connection and a space. --cache-bytes puts a result
+// cache of that size shared by the workers in front of evaluation; its counters are printed to
+// stderr on exit. --metrics writes phase latency quantiles in the Prometheus text format to the
+// file, or to stdout for "-", every ten seconds and on exit. --trace-every N writes a Chrome
+// trace of every N-th request to DIR/trace-<number>.json, the current directory by default.
+// --record appends every request with its result and timing to a workload log for
+// scheme_replay.
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../error.h"
+#include "../latency.h"
+#include "../result_cache.h"
+#include "../scheme.h"
+#include "../thread_pool.h"
+#include "../workload.h"
+
+namespace {
+
+enum class Framing { kLine, kLength };
+
+struct Options {
+    size_t threads = std::thread::hardware_concurrency();
+    std::string socket_path;
+    Framing framing = Framing::kLine;
+    bool tagged = false;
+    // Requests of a connection that may be in flight at once.
+    size_t window = 1024;
+    // Largest request, or frame header, a connection may send.
+    size_t max_frame_bytes = 16 << 20;
+    size_t cache_bytes = 0;
+    std::string metrics_path;
+    uint64_t trace_every = 0;
+    std::string trace_dir = ".";
+    std::string record_path;
+};
+
+ResultCache* result_cache = nullptr;
+LatencyRecorder* latency_recorder = nullptr;
+WorkloadRecorder* workload_recorder = nullptr;
+const Options* server_options = nullptr;
+std::atomic<uint64_t> request_count = 0;
+
+bool WriteAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t written = write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(written);
+    }
+    return true;
+}
+
+class FrameReader {
+public:
+    FrameReader(int fd, Framing framing, size_t max_frame_bytes)
+        : fd_(fd), framing_(framing), max_frame_bytes_(max_frame_bytes) {
+    }
+
+    // Throws SyntaxError on a malformed header and on a frame larger than max_frame_bytes.
+
+    bool Next(std::string* frame) {
+        if (framing_ == Framing::kLine) {
+            if (!ReadLine(frame)) {
+                return false;
+            }
+            if (!frame->empty() && frame->back() == '\r') {
+                frame->pop_back();
+            }
+            return true;
+        }
+
+        std::string header;
+        if (!ReadLine(&header)) {
+            return false;
+        }
+        size_t size = 0;
+        auto [end, ec] = std::from_chars(header.data(), header.data() + header.size(), size);
+        if (ec != std::errc() || end != header.data() + header.size()) {
+            throw SyntaxError("bad frame header: " + header);
+        }
+        if (size > max_frame_bytes_) {
+            throw SyntaxError("frame of " + header + " bytes is over the limit");
+        }
+        return ReadExactly(size, frame);
+    }
+
+private:
+    bool Fill() {
+        if (begin_ > buffer_.size() / 2) {
+            buffer_.erase(0, begin_);
+            begin_ = 0;
+        }
+        char chunk[1 << 16];
+        while (true) {
+            ssize_t count = read(fd_, chunk, sizeof(chunk));
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                return false;
+            }
+            buffer_.append(chunk, count);
+            return true;
+        }
+    }
+
+    bool ReadLine(std::string* line) {
+        // Relative to begin_, which Fill may move.
+        size_t scanned = 0;
+        while (true) {
+            size_t newline = buffer_.find('\n', begin_ + scanned);
+            if (newline != std::string::npos) {
+                line->assign(buffer_, begin_, newline - begin_);
+                begin_ = newline + 1;
+                return true;
+            }
+            scanned = buffer_.size() - begin_;
+            if (scanned > max_frame_bytes_) {
+                throw SyntaxError("line is over the frame limit");
+            }
+            if (!Fill()) {
+                // The last line may lack its terminator.
+                if (begin_ == buffer_.size()) {
+                    return false;
+                }
+                line->assign(buffer_, begin_);
+                begin_ = buffer_.size();
+                return true;
+            }
+        }
+    }
+
+    bool ReadExactly(size_t size, std::string* frame) {
+        while (buffer_.size() - begin_ < size) {
+            if (!Fill()) {
+                return false;
+            }
+        }
+        frame->assign(buffer_, begin_, size);
+        begin_ += size;
+        return true;
+    }
+
+    int fd_;
+    Framing framing_;
+    size_t max_frame_bytes_;
+    std::string buffer_;
+    size_t begin_ = 0;
+};
+
+// Collects responses from the workers and writes them out, reordering them unless tagged.
+class ResponseSink {
+public:
+    ResponseSink(int fd, const Options& options) : fd_(fd), options_(options) {
+    }
+
+    // Blocks the reader while the window is full.
+    void Acquire() {
+        std::unique_lock lock(mutex_);
+        space_.wait(lock, [this] { return in_flight_ < options_.window; });
+        ++in_flight_;
+    }
+
+    // The worker that finds no write going on writes the buffer out with the lock released, and
+    // goes on until what the others appended in the meantime is written too. The others return
+    // right away.
+    void Put(uint64_t id, std::string response) {
+        std::unique_lock lock(mutex_);
+        if (options_.tagged) {
+            Append(id, response);
+            ++next_;
+        } else {
+            ready_.emplace(id, std::move(response));
+            for (auto it = ready_.begin(); it != ready_.end() && it->first == next_;
+                 it = ready_.erase(it)) {
+                Append(next_++, it->second);
+            }
+        }
+        if (writing_) {
+            return;
+        }
+        writing_ = true;
+        while (!buffer_.empty()) {
+            writing_buffer_.swap(buffer_);
+            size_t responses = std::exchange(buffered_, 0);
+            lock.unlock();
+            bool written = WriteAll(fd_, writing_buffer_);
+            writing_buffer_.clear();
+            lock.lock();
+            failed_ = failed_ || !written;
+            // Responses count against the window until written, which bounds the buffer.
+            in_flight_ -= responses;
+            space_.notify_all();
+        }
+        writing_ = false;
+        space_.notify_all();
+    }
+
+    // Waits until count responses have been written.
+    bool Finish(uint64_t count) {
+        std::unique_lock lock(mutex_);
+        space_.wait(lock, [this, count] { return next_ == count && !writing_; });
+        return !failed_;
+    }
+
+private:
+    void Append(uint64_t id, std::string_view response) {
+        char digits[24];
+        char* tag_end = digits;
+        if (options_.tagged) {
+            tag_end = std::to_chars(digits, digits + sizeof(digits) - 1, id).ptr;
+            *tag_end++ = ' ';
+        }
+        std::string_view tag(digits, tag_end - digits);
+        if (options_.framing == Framing::kLength) {
+            char size[24];
+            auto size_end =
+                std::to_chars(size, size + sizeof(size), tag.size() + response.size()).ptr;
+            buffer_.append(size, size_end);
+            buffer_ += '\n';
+            buffer_ += tag;
+            buffer_ += response;
+        } else {
+            buffer_ += tag;
+            buffer_ += response;
+            buffer_ += '\n';
+        }
+        ++buffered_;
+    }
+
+    int fd_;
+    const Options& options_;
+
+    std::mutex mutex_;
+    std::condition_variable space_;
+    std::map<uint64_t, std::string> ready_;
+    std::string buffer_;
+    // Owned by the worker that is writing.
+    std::string writing_buffer_;
+    // Responses in buffer_.
+    size_t buffered_ = 0;
+    uint64_t next_ = 0;
+    size_t in_flight_ = 0;
+    bool writing_ = false;
+    bool failed_ = false;
+};
+
+std::string Evaluate(const std::string& request) {
+    static constexpr std::string_view kErrorPrefixes[] = {"SyntaxError: ", "RuntimeError: ",
+                                                          "NameError: ", "LimitError: "};
+
+    thread_local Interpreter interpreter;
+    thread_local std::unique_ptr<Tracer> tracer;
+    interpreter.SetResultCache(result_cache);
+    interpreter.SetLatencyRecorder(latency_recorder);
+    interpreter.SetWorkloadRecorder(workload_recorder);
+
+    uint64_t number = request_count.fetch_add(1, std::memory_order_relaxed);
+    uint64_t trace_every = server_options->trace_every;
+    bool traced = trace_every != 0 && number % trace_every == 0;
+    if (traced) {
+        if (tracer == nullptr) {
+            tracer = std::make_unique<Tracer>();
+        }
+        tracer->Clear();
+        interpreter.SetTracer(tracer.get());
+    }
+    auto result = interpreter.TryRun(request);
+    if (traced) {
+        interpreter.SetTracer(nullptr);
+        std::string path =
+            server_options->trace_dir + "/trace-" + std::to_string(number) + ".json";
+        std::ofstream(path) << tracer->ToChromeJson();
+    }
+
+    if (result) {
+        return std::string(*result);
+    }
+    const Error& error = result.GetError();
+    std::string response(kErrorPrefixes[static_cast<int>(error.kind)]);
+    response += error.message;
+    return response;
+}
+
+// Serves one stream of requests; returns once every response has been written.
+bool Serve(int in_fd, int out_fd, const Options& options, WorkStealingPool* pool) {
+    FrameReader reader(in_fd, options.framing, options.max_frame_bytes);
+    ResponseSink sink(out_fd, options);
+    uint64_t count = 0;
+    std::string request;
+    try {
+        while (reader.Next(&request)) {
+            sink.Acquire();
+            pool->Submit([&sink, id = count, request = std::move(request)] {
+                sink.Put(id, Evaluate(request));
+            });
+            ++count;
+        }
+    } catch (const SyntaxError& e) {
+        std::cerr << "scheme_server: " << e.what() << '\n';
+    }
+    return sink.Finish(count);
+}
+
+// Threads serving the clients of the socket. Finished ones are joined as new clients connect;
+// the others are shut down for reading, so they finish the requests they have, and joined when
+// the set goes away, before the options and the pool they use do.
+class ClientThreads {
+public:
+    ClientThreads(const Options& options, WorkStealingPool* pool)
+        : options_(options), pool_(pool) {
+    }
+
+    ~ClientThreads() {
+        for (auto& client : clients_) {
+            shutdown(client->fd, SHUT_RD);
+        }
+        for (auto& client : clients_) {
+            client->thread.join();
+            close(client->fd);
+        }
+    }
+
+    ClientThreads(const ClientThreads&) = delete;
+    ClientThreads& operator=(const ClientThreads&) = delete;
+
+    void Start(int fd) {
+        std::erase_if(clients_, [](const std::unique_ptr<Client>& client) {
+            if (!client->done.load(std::memory_order_acquire)) {
+                return false;
+            }
+            client->thread.join();
+            close(client->fd);
+            return true;
+        });
+
+        Client* client = clients_.emplace_back(std::make_unique<Client>()).get();
+        client->fd = fd;
+        client->thread = std::thread([this, client] {
+            Serve(client->fd, client->fd, options_, pool_);
+            // The client sees the end of the responses now rather than once the fd is closed.
+            shutdown(client->fd, SHUT_RDWR);
+            client->done.store(true, std::memory_order_release);
+        });
+    }
+
+private:
+    struct Client {
+        // Closed once the thread is joined, so that shutting it down never hits a reused fd.
+        int fd = -1;
+        std::atomic<bool> done = false;
+        std::thread thread;
+    };
+
+    const Options& options_;
+    WorkStealingPool* pool_;
+    std::vector<std::unique_ptr<Client>> clients_;
+};
+
+int ServeSocket(const Options& options, WorkStealingPool* pool) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (options.socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "scheme_server: socket path is too long\n";
+        return 1;
+    }
+    std::memcpy(address.sun_path, options.socket_path.c_str(), options.socket_path.size() + 1);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(options.socket_path.c_str());
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) ||
+        listen(listener, SOMAXCONN)) {
+        std::cerr << "scheme_server: " << std::strerror(errno) << '\n';
+        return 1;
+    }
+
+    ClientThreads clients(options, pool);
+    while (true) {
+        int client = accept(listener, nullptr, nullptr);
+        if (client >= 0) {
+            clients.Start(client);
+            continue;
+        }
+        if (errno == EINTR || errno == ECONNABORTED) {
+            continue;
+        }
+        std::cerr << "scheme_server: " << std::strerror(errno) << '\n';
+        // Out of descriptors or memory for now: wait for connections to close.
+        if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+        close(listener);
+        return 1;
+    }
+}
+
+// Parses all of text as a decimal number.
+template <class T>
+bool ParseNumber(std::string_view text, T* value) {
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), *value);
+    return error == std::errc() && end == text.data() + text.size();
+}
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--tagged") {
+            options->tagged = true;
+        } else if (arg == "--threads" && has_value) {
+            if (!ParseNumber(argv[++i], &options->threads)) {
+                return false;
+            }
+        } else if (arg == "--window" && has_value) {
+            if (!ParseNumber(argv[++i], &options->window)) {
+                return false;
+            }
+            options->window = std::max<size_t>(options->window, 1);
+        } else if (arg == "--max-frame-bytes" && has_value) {
+            if (!ParseNumber(argv[++i], &options->max_frame_bytes)) {
+                return false;
+            }
+        } else if (arg == "--cache-bytes" && has_value) {
+            if (!ParseNumber(argv[++i], &options->cache_bytes)) {
+                return false;
+            }
+        } else if (arg == "--trace-every" && has_value) {
+            if (!ParseNumber(argv[++i], &options->trace_every)) {
+                return false;
+            }
+        } else if (arg == "--trace-dir" && has_value) {
+            options->trace_dir = argv[++i];
+        } else if (arg == "--record" && has_value) {
+            options->record_path = argv[++i];
+        } else if (arg == "--metrics" && has_value) {
+            options->metrics_path = argv[++i];
+        } else if (arg == "--socket" && has_value) {
+            options->socket_path = argv[++i];
+        } else if (arg == "--framing" && has_value) {
+            std::string_view value = argv[++i];
+            if (value == "line") {
+                options->framing = Framing::kLine;
+            } else if (value == "length") {
+                options->framing = Framing::kLength;
+            } else {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, &options)) {
+        std::cerr << "usage: scheme_server [--threads N] [--socket PATH] "
+                     "[--framing line|length] [--tagged] [--window N] [--max-frame-bytes N] "
+                     "[--cache-bytes N] [--metrics PATH] [--trace-every N] [--trace-dir DIR] [--record PATH]\n";
+        return 2;
+    }
+    server_options = &options;
+
+    std::unique_ptr<ResultCache> cache;
+    if (options.cache_bytes != 0) {
+        cache = std::make_unique<ResultCache>(options.cache_bytes);
+        result_cache = cache.get();
+    }
+
+    std::unique_ptr<WorkloadRecorder> workload;
+    if (!options.record_path.empty()) {
+        auto opened = WorkloadRecorder::Open(options.record_path);
+        if (!opened) {
+            std::cerr << "scheme_server: " << opened.GetError().message << '\n';
+            return 1;
+        }
+        workload = std::move(*opened);
+        workload_recorder = workload.get();
+    }
+
+    LatencyRecorder recorder;
+    std::jthread exporter;
+    if (!options.metrics_path.empty()) {
+        latency_recorder = &recorder;
+        exporter = std::jthread([&options, &recorder](std::stop_token stop) {
+            std::mutex mutex;
+            std::condition_variable_any wake;
+            std::unique_lock lock(mutex);
+            while (!wake.wait_for(lock, stop, std::chrono::seconds(10), [] { return false; }) &&
+                   !stop.stop_requested()) {
+                recorder.ExportPrometheus(options.metrics_path);
+            }
+        });
+    }
+
+    int status = 0;
+    {
+        WorkStealingPool pool(options.threads);
+        if (!options.socket_path.empty()) {
+            status = ServeSocket(options, &pool);
+        } else {
+            status = Serve(STDIN_FILENO, STDOUT_FILENO, options, &pool) ? 0 : 1;
+        }
+    }
+
+    exporter = {};
+    if (latency_recorder != nullptr && !recorder.ExportPrometheus(options.metrics_path)) {
+        std::cerr << "scheme_server: cannot write " << options.metrics_path << '\n';
+    }
+    if (workload != nullptr && !workload->Flush()) {
+        std::cerr << "scheme_server: cannot write " << options.record_path << '\n';
+    }
+    if (cache != nullptr) {
+        ResultCacheStats stats = cache->GetStats();
+        std::cerr << "scheme_server: cache hits " << stats.hits << " misses " << stats.misses
+                  << " evictions " << stats.evictions << " entries " << stats.entries
+                  << " bytes " << stats.bytes << '\n';
+    }
+    return status;
+}
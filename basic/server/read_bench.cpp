@@ -0,0 +1,108 @@
+// Reads a large file of records through an input port, one datum per (read), and sums a field.
+//
+//   scheme_read_bench [megabytes] [buffer_bytes]
+//
+// Writes records like (reading sensor-7 1700000123 (ok 21 -3 #t)), one per line, to a
+// temporary file of 1024 MB by default. Then, once reading it a buffer at a time and once
+// through a mapping, evaluates (car (cdr (cdr (read)))) until the port is at its end and adds up
+// the timestamps, printing the throughput and the peak resident size of the process so far.
+
+#include <sys/resource.h>
+
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+
+#include "../ports.h"
+#include "../scheme.h"
+
+namespace {
+
+std::string MakeRecord(std::mt19937* gen, int64_t* sum) {
+    static const char* kStatuses[] = {"ok", "ok", "ok", "warn", "fail"};
+    int timestamp = 1700000000 + (*gen)() % 100000000;
+    *sum += timestamp;
+    std::string record = "(reading sensor-" + std::to_string((*gen)() % 500) + ' ';
+    record += std::to_string(timestamp) + " (";
+    record += kStatuses[(*gen)() % std::size(kStatuses)];
+    for (int i = 0; i < 8; ++i) {
+        record += ' ' + std::to_string(static_cast<int>((*gen)() % 2001) - 1000);
+    }
+    record += (*gen)() % 2 ? " #t))\n" : " #f))\n";
+    return record;
+}
+
+long GetPeakRssMegabytes() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss >> 10;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1024;
+    size_t buffer_bytes = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 64 << 10;
+
+    const char* path = "scheme_read_bench.scm";
+    size_t bytes = 0;
+    int64_t expected = 0;
+    {
+        std::mt19937 gen(42);
+        std::ofstream out(path, std::ios::binary);
+        while (bytes < megabytes << 20) {
+            std::string record = MakeRecord(&gen, &expected);
+            bytes += record.size();
+            out << record;
+        }
+    }
+
+    std::printf("%zu MB\n%8s %10s %10s %12s %10s\n", bytes >> 20, "mode", "ms", "MB/s", "records",
+                "peak MB");
+    int status = 0;
+    for (bool map : {false, true}) {
+        auto start = std::chrono::steady_clock::now();
+        auto port = InputPort::Open(path, {.buffer_bytes = buffer_bytes, .map = map});
+        if (!port) {
+            std::fprintf(stderr, "%s\n", port.GetError().message.c_str());
+            return 1;
+        }
+        Interpreter interpreter;
+        interpreter.SetInputPort(port->get());
+        Session session;
+        session.Reset("(car (cdr (cdr (read))))");
+        Ref<Object> program = TryRead(session.GetTokenizer()).ValueOrThrow();
+
+        size_t records = 0;
+        int64_t sum = 0;
+        while (!(*port)->AtEnd()) {
+            auto result = interpreter.TryRunProgram(program);
+            int value = 0;
+            if (!result || std::from_chars(result->data(), result->data() + result->size(), value)
+                                   .ec != std::errc()) {
+                std::fprintf(stderr, "record %zu: %s\n", records,
+                             result ? std::string(*result).c_str()
+                                    : result.GetError().message.c_str());
+                return 1;
+            }
+            sum += value;
+            ++records;
+        }
+        double seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%8s %10.1f %10.1f %12zu %10ld\n", map ? "mapped" : "buffered",
+                    seconds * 1e3, bytes / seconds / 1e6, records, GetPeakRssMegabytes());
+        if (sum != expected) {
+            std::fprintf(stderr, "sum %lld, expected %lld\n", static_cast<long long>(sum),
+                         static_cast<long long>(expected));
+            status = 1;
+        }
+    }
+    std::remove(path);
+    return status;
+}
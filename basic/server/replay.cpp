@@ -0,0 +1,143 @@
+// Replays a workload log written by scheme_server --record and reports throughput, latency
+// quantiles and the requests whose results differ from the recorded ones.
+//
+//   scheme_replay LOG [--threads N] [--speed X] [--show-diffs N]
+//
+// Requests are issued at their recorded times divided by --speed, 1 by default, so 10 replays
+// an hour of traffic in six minutes; with --speed 0 they are issued all at once. Each worker
+// thread evaluates in an interpreter of its own. Latency is measured from the time a request
+// was due rather than from when a worker took it, so a replay that falls behind shows in the
+// quantiles; they are printed next to those of the durations recorded. The first --show-diffs
+// mismatches, 10 by default, are printed to stderr, and the exit status is 1 if there were any.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../latency.h"
+#include "../scheme.h"
+#include "../thread_pool.h"
+#include "../workload.h"
+
+namespace {
+
+struct Options {
+    std::string log_path;
+    size_t threads = std::thread::hardware_concurrency();
+    double speed = 1;
+    uint64_t show_diffs = 10;
+};
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--threads" && has_value) {
+            options->threads = std::stoul(argv[++i]);
+        } else if (arg == "--speed" && has_value) {
+            options->speed = std::stod(argv[++i]);
+        } else if (arg == "--show-diffs" && has_value) {
+            options->show_diffs = std::stoull(argv[++i]);
+        } else if (options->log_path.empty() && !arg.starts_with("--")) {
+            options->log_path = arg;
+        } else {
+            return false;
+        }
+    }
+    return !options->log_path.empty() && options->speed >= 0;
+}
+
+std::string Describe(bool failed, ErrorKind kind, std::string_view output) {
+    static constexpr const char* kErrorNames[] = {"SyntaxError: ", "RuntimeError: ",
+                                                  "NameError: ", "LimitError: "};
+    return (failed ? kErrorNames[static_cast<int>(kind)] : "") + std::string(output);
+}
+
+void PrintQuantiles(const char* name, const LatencyHistogram& histogram) {
+    std::printf("%-9s p50 %9.1f us  p90 %9.1f us  p99 %9.1f us  p99.9 %9.1f us  max %9.1f us\n",
+                name, histogram.GetQuantile(0.5) / 1e3, histogram.GetQuantile(0.9) / 1e3,
+                histogram.GetQuantile(0.99) / 1e3, histogram.GetQuantile(0.999) / 1e3,
+                histogram.GetMax() / 1e3);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, &options)) {
+        std::cerr << "usage: scheme_replay LOG [--threads N] [--speed X] [--show-diffs N]\n";
+        return 2;
+    }
+    auto reader = WorkloadReader::Open(options.log_path);
+    if (!reader) {
+        std::cerr << "scheme_replay: " << reader.GetError().message << '\n';
+        return 1;
+    }
+    std::vector<WorkloadRecord> records;
+    LatencyHistogram recorded;
+    for (WorkloadRecord record; reader->Next(&record);) {
+        records.push_back(record);
+        recorded.Record(record.duration.count());
+    }
+    // Runs are appended as they finish, so concurrent ones may be out of order.
+    std::stable_sort(records.begin(), records.end(),
+                     [](const auto& a, const auto& b) { return a.start < b.start; });
+
+    std::vector<LatencyHistogram> histograms(std::max<size_t>(options.threads, 1));
+    std::atomic<uint64_t> mismatches = 0;
+    std::mutex output_mutex;
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        WorkStealingPool pool(options.threads);
+        for (const WorkloadRecord& record : records) {
+            auto due = start;
+            if (options.speed > 0) {
+                due += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    (record.start - records[0].start) / options.speed);
+                std::this_thread::sleep_until(due);
+            }
+            pool.Submit([&, due, record = &record] {
+                thread_local Interpreter interpreter;
+                auto result = interpreter.TryRun(record->input);
+                auto end = std::chrono::steady_clock::now();
+                histograms[WorkStealingPool::CurrentWorker()].Record((end - due).count());
+
+                bool failed = !result;
+                std::string_view output = failed ? result.GetError().message : *result;
+                ErrorKind kind = failed ? result.GetError().kind : ErrorKind::kSyntax;
+                if (failed == record->failed && output == record->output &&
+                    (!failed || kind == record->error_kind)) {
+                    return;
+                }
+                if (mismatches.fetch_add(1, std::memory_order_relaxed) < options.show_diffs) {
+                    std::lock_guard lock(output_mutex);
+                    std::cerr << "mismatch: " << record->input << "\n  recorded: "
+                              << Describe(record->failed, record->error_kind, record->output)
+                              << "\n  replayed: " << Describe(failed, kind, output) << '\n';
+                }
+            });
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    LatencyHistogram replayed;
+    for (const LatencyHistogram& histogram : histograms) {
+        replayed.Merge(histogram);
+    }
+    std::chrono::duration<double> span =
+        records.empty() ? std::chrono::nanoseconds(0) : records.back().start - records[0].start;
+    std::printf("requests  %zu in %.3f s (recorded over %.3f s), %.0f requests/s\n",
+                records.size(), elapsed.count(), span.count(),
+                records.size() / std::max(elapsed.count(), 1e-9));
+    PrintQuantiles("recorded", recorded);
+    PrintQuantiles("replayed", replayed);
+    std::printf("mismatches %llu\n", static_cast<unsigned long long>(mismatches.load()));
+    return mismatches.load() == 0 ? 0 : 1;
+}
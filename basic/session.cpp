@@ -0,0 +1,42 @@
+#include "session.h"
+
+void Session::ViewBuffer::Reset(std::string_view view) {
+    char* begin = const_cast<char*>(view.data());
+    setg(begin, begin, begin + view.size());
+}
+
+Session::Session() : stream_(&buffer_), tokenizer_(&stream_) {
+}
+
+void Session::Reset(std::string_view input) {
+    buffer_.Reset(input);
+    stream_.clear();
+    tokenizer_.Reset();
+
+    ClearScratch();
+}
+
+void Session::ClearScratch() {
+    int_scratch_.clear();
+    object_scratch_.clear();
+}
+
+Tokenizer* Session::GetTokenizer() {
+    return &tokenizer_;
+}
+
+std::vector<int>& Session::GetIntScratch() {
+    return int_scratch_;
+}
+
+std::vector<Ref<Object>>& Session::GetObjectScratch() {
+    return object_scratch_;
+}
+
+std::string& Session::GetOutput() {
+    return output_;
+}
+
+std::string& Session::GetCacheKey() {
+    return cache_key_;
+}
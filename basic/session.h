@@ -0,0 +1,55 @@
+#pragma once
+
+#include <istream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "object.h"
+#include "tokenizer.h"
+
+// Per-interpreter state that survives between requests: the reader over the current input, the
+// scratch vectors used to collect call arguments and the output buffer. Buffers are cleared but
+// keep their capacity, so a warmed-up session serves typical requests without touching the heap.
+class Session {
+public:
+    Session();
+
+    Session(const Session&) = delete;
+    Session& operator=(const Session&) = delete;
+
+    // Points the reader at input, which has to outlive the request, and clears the scratch.
+    void Reset(std::string_view input);
+
+    // Drops the collected arguments, releasing the references they hold.
+    void ClearScratch();
+
+    Tokenizer* GetTokenizer();
+
+    // Arguments are collected on these stacks: a call appends its arguments, uses them and
+    // truncates the stack back, so nested calls share the storage.
+    std::vector<int>& GetIntScratch();
+    std::vector<Ref<Object>>& GetObjectScratch();
+
+    std::string& GetOutput();
+
+    // Normalized token stream of the current input, the key into a ResultCache.
+    std::string& GetCacheKey();
+
+private:
+    // Reads a string_view in place instead of copying it like std::stringstream does.
+    class ViewBuffer : public std::streambuf {
+    public:
+        void Reset(std::string_view view);
+    };
+
+    ViewBuffer buffer_;
+    std::istream stream_;
+    Tokenizer tokenizer_;
+
+    std::vector<int> int_scratch_;
+    std::vector<Ref<Object>> object_scratch_;
+    std::string output_;
+    std::string cache_key_;
+};
@@ -2,6 +2,35 @@ add_library(scheme_basic
     tokenizer.cpp
     parser.cpp
     scheme.cpp
+    heap.cpp
+    reclaimer.cpp
+    session.cpp
+    thread_pool.cpp
+    async.cpp
+    result_cache.cpp
+    parse_cache.cpp
+    hash_cons.cpp
+    binary.cpp
+    data_loader.cpp
+    profile.cpp
+    latency.cpp
+    trace.cpp
+    allocation.cpp
+    workload.cpp
+    ports.cpp
 
         # maybe more .cpp files here
 )
+
+option(SCHEME_PROFILING "Build the per-builtin profiler into the interpreter" ON)
+target_compile_definitions(scheme_basic PUBLIC SCHEME_PROFILING=$<BOOL:${SCHEME_PROFILING}>)
+
+# Instruments the library for the libFuzzer targets, see fuzz/. Needs clang.
+option(SCHEME_LIBFUZZER "Build the libFuzzer targets" OFF)
+if (SCHEME_LIBFUZZER)
+    target_compile_options(scheme_basic PUBLIC -fsanitize=fuzzer-no-link,address)
+    target_link_options(scheme_basic PUBLIC -fsanitize=address)
+endif ()
+
+find_package(Threads REQUIRED)
+target_link_libraries(scheme_basic PUBLIC Threads::Threads)
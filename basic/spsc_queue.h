@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+// Bounded queue from one producer thread to one consumer thread. Values live in a ring of slots
+// indexed by two counters, each written by one side only, so a push or a pop that neither finds
+// the ring full nor empty touches no lock. A side that has to wait sleeps on a condition
+// variable. The other side wakes it after moving a quarter of the capacity rather than after
+// every value, so that a fast side does not hand values over one context switch at a time.
+//
+// A producer that is about to block on something else calls Notify() so the consumer sees what
+// was pushed so far. Close() is called by the producer once it is done; Pop returns false after
+// the values pushed before it. Values are moved across, and everything they own changes threads
+// with them.
+template <class T>
+class SpscQueue {
+public:
+    // The capacity is rounded up to a power of two.
+    explicit SpscQueue(size_t capacity)
+        : capacity_(std::bit_ceil(std::max<size_t>(capacity, 1))),
+          wake_batch_(std::max<size_t>(capacity_ / 4, 1)),
+          slots_(std::make_unique<T[]>(capacity_)) {
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Waits while the queue is full.
+    void Push(T value) {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ == capacity_) {
+            cached_head_ = Wait(&head_, &producer_waiting_, &not_full_, [this, tail] {
+                return tail - head_.load(std::memory_order_seq_cst) < capacity_;
+            });
+        }
+        slots_[tail & (capacity_ - 1)] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_seq_cst);
+        if (((tail + 1) & (wake_batch_ - 1)) == 0) {
+            Wake(&consumer_waiting_, &not_empty_);
+        }
+    }
+
+    // Wakes the consumer for the values pushed so far.
+    void Notify() {
+        Wake(&consumer_waiting_, &not_empty_);
+    }
+
+    // Moves the oldest value into *value, waiting for one. Returns false once the queue is
+    // closed and drained.
+    bool Pop(T* value) {
+        if (TryPop(value)) {
+            return true;
+        }
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        cached_tail_ = Wait(&tail_, &consumer_waiting_, &not_empty_, [this, head] {
+            return head != tail_.load(std::memory_order_seq_cst) ||
+                   closed_.load(std::memory_order_seq_cst);
+        });
+        return TryPop(value);
+    }
+
+    // Pop that returns false instead of waiting when the queue is empty.
+    bool TryPop(T* value) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_) {
+                return false;
+            }
+        }
+        *value = std::move(slots_[head & (capacity_ - 1)]);
+        head_.store(head + 1, std::memory_order_seq_cst);
+        if (((head + 1) & (wake_batch_ - 1)) == 0) {
+            Wake(&producer_waiting_, &not_full_);
+        }
+        return true;
+    }
+
+    void Close() {
+        closed_.store(true, std::memory_order_seq_cst);
+        Wake(&consumer_waiting_, &not_empty_);
+    }
+
+    size_t GetCapacity() const {
+        return capacity_;
+    }
+
+private:
+    // Waits until ready() holds and returns the other side's counter. The flag is raised before
+    // ready() is checked, and the other side checks it after moving its counter across a batch
+    // boundary, so one of them sees the other's store. A full ring always holds a boundary, and
+    // an empty one is left to Notify() and Close(). Waking lowers the flag, so a sleep costs the
+    // other side one notify.
+    template <class Ready>
+    uint64_t Wait(std::atomic<uint64_t>* counter, std::atomic<bool>* waiting,
+                  std::condition_variable* condition, Ready ready) {
+        std::unique_lock lock(mutex_);
+        while (true) {
+            waiting->store(true, std::memory_order_seq_cst);
+            if (ready()) {
+                break;
+            }
+            condition->wait(lock);
+        }
+        waiting->store(false, std::memory_order_relaxed);
+        return counter->load(std::memory_order_acquire);
+    }
+
+    void Wake(std::atomic<bool>* waiting, std::condition_variable* condition) {
+        if (waiting->load(std::memory_order_seq_cst)) {
+            std::lock_guard lock(mutex_);
+            waiting->store(false, std::memory_order_relaxed);
+            condition->notify_one();
+        }
+    }
+
+    const size_t capacity_;
+    const size_t wake_batch_;
+    std::unique_ptr<T[]> slots_;
+
+    // Each counter is written by one side; the other side keeps the last value it read, so it
+    // only loads the shared one again when the ring looks full or empty.
+    alignas(64) std::atomic<uint64_t> head_ = 0;
+    uint64_t cached_tail_ = 0;
+    alignas(64) std::atomic<uint64_t> tail_ = 0;
+    uint64_t cached_head_ = 0;
+    alignas(64) std::atomic<bool> closed_ = false;
+    std::atomic<bool> producer_waiting_ = false;
+    std::atomic<bool> consumer_waiting_ = false;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
@@ -0,0 +1,86 @@
+#include <catch.hpp>
+
+#include <string>
+
+#include <parse_cache.h>
+#include <scheme.h>
+
+TEST_CASE("Runs count the objects they allocate by type") {
+    Interpreter interpreter;
+    REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+
+    // Three cells, the symbol and two numbers are read, the sum is a third number.
+    const AllocationStats& run = interpreter.GetLastRunAllocationStats();
+    REQUIRE(run.Get(ObjectType::kCell).allocated == 3);
+    REQUIRE(run.Get(ObjectType::kSymbol).allocated == 1);
+    REQUIRE(run.Get(ObjectType::kNumber).allocated == 3);
+    REQUIRE(run.Get(ObjectType::kBool).allocated == 0);
+    REQUIRE(run.Get(ObjectType::kNumber).allocated_bytes == 3 * sizeof(Number));
+    REQUIRE(run.total.allocated == 7);
+    REQUIRE(run.total.live == 0);
+    REQUIRE(run.total.live_bytes == 0);
+    REQUIRE(run.total.peak_bytes == static_cast<int64_t>(run.total.allocated_bytes));
+
+    REQUIRE(interpreter.Run("(list 1 2 3 4)") == "(1 2 3 4)");
+    const AllocationStats& total = interpreter.GetAllocationStats();
+    REQUIRE(total.total.allocated == 7 + 10);
+    REQUIRE(total.total.live == 0);
+    REQUIRE(total.Get(ObjectType::kCell).allocated == 3 + 5);
+
+    REQUIRE_THROWS(interpreter.Run("(car '(1 . 2) 3)"));
+    REQUIRE(interpreter.GetLastRunAllocationStats().Get(ObjectType::kQuote).allocated == 1);
+    REQUIRE(interpreter.GetLastRunAllocationStats().total.live == 0);
+
+    std::string text = interpreter.GetAllocationStats().ToString();
+    REQUIRE(text.find("cell") != std::string::npos);
+    REQUIRE(text.find("total") != std::string::npos);
+}
+
+TEST_CASE("Live counts show what runs leave behind") {
+    ParseCache cache(1 << 20);
+    {
+        Interpreter interpreter;
+        interpreter.SetParseCache(&cache);
+        interpreter.Run("(+ 1 2)");
+        REQUIRE(interpreter.GetLastRunAllocationStats().total.live == 6);
+        interpreter.Run("(+ 1 2)");
+        REQUIRE(interpreter.GetLastRunAllocationStats().total.allocated == 1);
+        REQUIRE(interpreter.GetLastRunAllocationStats().total.live == 0);
+    }
+
+    const char* program = "(list 1 2 (+ 3 4) (list 5 6))";
+    Interpreter plain;
+    plain.Run(program);
+    uint64_t per_run = plain.GetLastRunAllocationStats().total.allocated;
+
+    int64_t live = GetThreadAllocations().total.live;
+    {
+        Interpreter interpreter;
+        interpreter.EnableGc({.nursery_bytes = 4096});
+        for (int i = 0; i < 200; ++i) {
+            interpreter.Run(program);
+        }
+        REQUIRE(interpreter.GetAllocationStats().total.allocated == 200 * per_run);
+        REQUIRE(GetThreadAllocations().total.live - live <= 4096 / 16);
+    }
+    // The heap frees what it still holds when it goes away.
+    REQUIRE(GetThreadAllocations().total.live == live);
+}
+
+TEST_CASE("Live memory limit stops a run") {
+    std::string program = "(list";
+    for (int i = 0; i < 1000; ++i) {
+        program += " " + std::to_string(i);
+    }
+    program += ")";
+
+    Interpreter interpreter;
+    interpreter.SetLimits({.max_live_bytes = 1 << 20});
+    REQUIRE_NOTHROW(interpreter.Run(program));
+
+    interpreter.SetLimits({.max_live_bytes = 1 << 10});
+    auto result = interpreter.TryRun(program);
+    REQUIRE_FALSE(result);
+    REQUIRE(result.GetError().kind == ErrorKind::kLimit);
+    REQUIRE(interpreter.GetLastRunAllocationStats().total.live == 0);
+}
@@ -0,0 +1,59 @@
+// Built into an executable of its own, test_scheme_allocations, which replaces the global
+// operator new to count its calls, see counting_new.h.
+
+#include <catch.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <counting_new.h>
+#include <scheme.h>
+
+TEST_CASE("Warmed-up run does not allocate") {
+    const std::vector<std::string> requests = {"(+ 1 2 3)",
+                                               "(- 100 (* 2 3) (/ 10 5))",
+                                               "(max 1 (min 5 7) (abs -4))",
+                                               "(< 1 2 3 4)",
+                                               "(= (+ 2 2) (* 2 2))",
+                                               "(and #t (> 2 1) (<= 1 1))",
+                                               "(or #f (not #t) (number? 5))",
+                                               "(boolean? (>= 3 2))"};
+
+    Interpreter interpreter;
+    std::vector<std::string> expected;
+    for (const auto& request : requests) {
+        expected.emplace_back(interpreter.Run(request));
+    }
+    for (const auto& request : requests) {
+        interpreter.RunInPlace(request);
+    }
+
+    std::vector<std::string_view> results(requests.size());
+    uint64_t allocations = GetNewCount();
+    for (size_t i = 0; i < requests.size(); ++i) {
+        results[i] = interpreter.RunInPlace(requests[i]);
+        if (results[i] != expected[i]) {
+            break;
+        }
+    }
+    allocations = GetNewCount() - allocations;
+
+    REQUIRE(allocations == 0);
+    REQUIRE(results.back() == expected.back());
+}
+
+TEST_CASE("Warmed-up batch does not allocate") {
+    const std::vector<std::string_view> requests = {"(+ 1 2 3)", "(< 1 2 3 4)",
+                                                    "(or #f (not #t) (number? 5))", "(abs -4)"};
+
+    Interpreter interpreter;
+    interpreter.RunBatch(requests);
+
+    uint64_t allocations = GetNewCount();
+    const BatchResult& result = interpreter.RunBatch(requests);
+    allocations = GetNewCount() - allocations;
+
+    REQUIRE(allocations == 0);
+    REQUIRE(result.buffer == "6#t#t4");
+}
@@ -0,0 +1,137 @@
+#include <catch.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <async.h>
+#include <error.h>
+#include <scheme.h>
+
+namespace {
+Task<void> Collect(Interpreter* interpreter, Scheduler* scheduler, std::string input,
+                   std::optional<Expected<std::string>>* result,
+                   std::vector<int>* finished = nullptr, int id = 0) {
+    result->emplace(co_await interpreter->RunAsync(scheduler, std::move(input)));
+    if (finished != nullptr) {
+        finished->push_back(id);
+    }
+}
+
+Expected<std::string> RunAsync(Interpreter* interpreter, std::string input,
+                               uint32_t slice_steps = 2) {
+    Scheduler scheduler(slice_steps);
+    std::optional<Expected<std::string>> result;
+    scheduler.Spawn(Collect(interpreter, &scheduler, std::move(input), &result));
+    scheduler.Run();
+    return std::move(*result);
+}
+
+// (+ (+ 1) (+ 1) ...) makes count + 1 calls.
+std::string MakeWideCall(size_t count) {
+    std::string program = "(+";
+    for (size_t i = 0; i < count; ++i) {
+        program += " (+ 1)";
+    }
+    program += ')';
+    return program;
+}
+}  // namespace
+
+TEST_CASE("RunAsync matches Run") {
+    const char* kPrograms[] = {
+        "5",
+        "'(1 2 . 3)",
+        "(+ 1 (* 2 3) (- 10 (abs -4)))",
+        "(max (min 3 (+ 1 1)) (/ 100 (* 5 5)))",
+        "(and (< 1 (+ 1 1) 3) (not #f) (list? (cons 1 '())))",
+        "(and (= 1 1) (number? #f) (car 5))",
+        "(or (= 1 2) (+ 1 1) (car 5))",
+        "(or #f (> 1 2))",
+        "(and)",
+        "(cons (car '(1 2)) (cdr (cons 3 (cons 4 '()))))",
+        "(list-ref (list-tail '(1 2 3 4) (+ 0 1)) (- 3 1))",
+        "(list 1 (+ 2 3))",
+        "(quote (+ 1 2))",
+        "(pair? (cons (+ 1 1) '()))",
+        "(null? (cdr (cons 1 '())))",
+        "(boolean? (not (= 1 (+ 0 1))))",
+    };
+
+    Interpreter sync;
+    Interpreter async;
+    for (const char* program : kPrograms) {
+        INFO(program);
+        auto result = RunAsync(&async, program);
+        REQUIRE(result);
+        REQUIRE(*result == sync.Run(program));
+    }
+}
+
+TEST_CASE("RunAsync reports errors") {
+    Interpreter interpreter;
+
+    auto syntax = RunAsync(&interpreter, "(+ 1 2");
+    REQUIRE_FALSE(syntax);
+    REQUIRE(syntax.GetError().kind == ErrorKind::kSyntax);
+
+    auto runtime = RunAsync(&interpreter, "(cons (+ 1 2) (- 3 #t))");
+    REQUIRE_FALSE(runtime);
+    REQUIRE(runtime.GetError().kind == ErrorKind::kRuntime);
+    REQUIRE(runtime.GetError().offset == 15);
+
+    auto unknown = RunAsync(&interpreter, "(foo (car 1))");
+    REQUIRE_FALSE(unknown);
+    REQUIRE(unknown.GetError().message == "passed through in Evaluate");
+
+    // The interpreter is fine after a failure.
+    REQUIRE(*RunAsync(&interpreter, "(+ 1 (+ 2 3))") == "6");
+    REQUIRE(interpreter.Run("(+ 1 (+ 2 3))") == "6");
+}
+
+TEST_CASE("RunAsync honours limits") {
+    Interpreter interpreter;
+    interpreter.SetLimits({.max_steps = 100, .max_depth = 50});
+
+    REQUIRE(*RunAsync(&interpreter, MakeWideCall(99)) == "99");
+    auto steps = RunAsync(&interpreter, MakeWideCall(100));
+    REQUIRE_FALSE(steps);
+    REQUIRE(steps.GetError().message == "Step limit exceeded");
+
+    std::string deep = "1";
+    for (int i = 0; i < 49; ++i) {
+        deep = "(+ 1 " + deep + ")";
+    }
+    REQUIRE(*RunAsync(&interpreter, deep) == "50");
+    auto too_deep = RunAsync(&interpreter, "(+ 1 (+ 1 " + deep + "))");
+    REQUIRE_FALSE(too_deep);
+    REQUIRE(too_deep.GetError().kind == ErrorKind::kLimit);
+}
+
+TEST_CASE("Long runs are interleaved with short ones") {
+    Scheduler scheduler(16);
+    Interpreter long_interpreter;
+    Interpreter short_interpreter;
+    std::optional<Expected<std::string>> long_result;
+    std::optional<Expected<std::string>> short_result;
+    std::vector<int> finished;
+
+    scheduler.Spawn(Collect(&long_interpreter, &scheduler, MakeWideCall(1000), &long_result,
+                            &finished, 1));
+    scheduler.Spawn(Collect(&short_interpreter, &scheduler, "(+ 1 (* 2 3))", &short_result,
+                            &finished, 2));
+    scheduler.Run();
+
+    REQUIRE(finished == std::vector<int>{2, 1});
+    REQUIRE(**long_result == "1000");
+    REQUIRE(**short_result == "7");
+}
+
+TEST_CASE("RunAsync with the collected heap") {
+    Interpreter interpreter;
+    interpreter.EnableGc();
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(*RunAsync(&interpreter, "(cons (+ 1 2) (list-tail '(1 2 3) (+ 1 1)))") ==
+                "(3 3)");
+    }
+}
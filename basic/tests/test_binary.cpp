@@ -0,0 +1,223 @@
+#include <catch.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <binary.h>
+#include <parser.h>
+#include <scheme.h>
+
+namespace {
+Ref<Object> ReadText(const std::string& input) {
+    std::stringstream stream(input);
+    Tokenizer tokenizer(&stream);
+    return Read(&tokenizer);
+}
+
+// Structural equality, quotes included, which the printer cannot show.
+bool Same(Object* lhs, Object* rhs) {
+    if (lhs == nullptr || rhs == nullptr) {
+        return lhs == rhs;
+    }
+    if (Number* number = As<Number>(lhs)) {
+        return Is<Number>(rhs) && As<Number>(rhs)->GetValue() == number->GetValue();
+    } else if (Bool* boolean = As<Bool>(lhs)) {
+        return Is<Bool>(rhs) && As<Bool>(rhs)->GetValue() == boolean->GetValue();
+    } else if (Symbol* symbol = As<Symbol>(lhs)) {
+        return Is<Symbol>(rhs) && As<Symbol>(rhs)->GetName() == symbol->GetName();
+    } else if (Quote* quote = As<Quote>(lhs)) {
+        return Is<Quote>(rhs) && Same(quote->next_.Get(), As<Quote>(rhs)->next_.Get());
+    }
+    Cell* cell = As<Cell>(lhs);
+    return Is<Cell>(rhs) && Same(cell->GetFirst().Get(), As<Cell>(rhs)->GetFirst().Get()) &&
+           Same(cell->GetSecond().Get(), As<Cell>(rhs)->GetSecond().Get());
+}
+}  // namespace
+
+TEST_CASE("Binary images round-trip through the printer") {
+    const char* kData[] = {
+        "42",
+        "-2147483648",
+        "#f",
+        "foo",
+        "()",
+        "(1 2 3)",
+        "(1 . 2)",
+        "((a b) (c (d . #t)) () e)",
+        "(() ())",
+        "(define (f x) (if (< x 0) (- x) x))",
+        "((((((1))))) 2)",
+    };
+
+    BinaryWriter writer;
+    for (const char* text : kData) {
+        writer.Add(ReadText(text));
+    }
+    REQUIRE(writer.GetTreeCount() == std::size(kData));
+    std::string bytes = writer.Finish();
+
+    auto image = BinaryImage::Open(bytes);
+    REQUIRE(image);
+    REQUIRE(image->GetTreeCount() == std::size(kData));
+    Interpreter interpreter;
+    for (size_t i = 0; i < std::size(kData); ++i) {
+        INFO(kData[i]);
+        Ref<Object> tree = image->Load(i).ValueOrThrow();
+        REQUIRE(interpreter.ASTToString(tree) == interpreter.ASTToString(ReadText(kData[i])));
+    }
+}
+
+TEST_CASE("Binary images keep quotes") {
+    const char* kData[] = {"'(1 2)", "(list-tail '(a b 'c) 1)", "'''x", "(a . 'b)"};
+    BinaryWriter writer;
+    for (const char* text : kData) {
+        writer.Add(ReadText(text));
+    }
+    std::string bytes = writer.Finish();
+    auto image = BinaryImage::Open(bytes);
+    REQUIRE(image);
+    for (size_t i = 0; i < std::size(kData); ++i) {
+        INFO(kData[i]);
+        REQUIRE(Same(image->Load(i)->Get(), ReadText(kData[i]).Get()));
+    }
+}
+
+TEST_CASE("Binary nodes are viewed in place") {
+    BinaryWriter writer;
+    writer.Add(ReadText("((a 1) (b 2) ((nested) . #t))"));
+    std::string bytes = writer.Finish();
+    auto image = BinaryImage::Open(bytes);
+    REQUIRE(image);
+    REQUIRE(image->GetSymbolCount() == 3);
+
+    using Kind = BinaryNode::Kind;
+    BinaryNode list = image->GetTree(0);
+    REQUIRE(list.GetKind() == Kind::kCell);
+    BinaryNode second_row = list.GetSecond().GetFirst();
+    REQUIRE(second_row.GetFirst().GetSymbol() == "b");
+    REQUIRE(second_row.GetSecond().GetFirst().GetNumber() == 2);
+    REQUIRE(second_row.GetSecond().GetSecond().GetKind() == Kind::kNull);
+
+    BinaryNode third_row = list.GetSecond().GetSecond().GetFirst();
+    REQUIRE(third_row.GetFirst().GetFirst().GetSymbol() == "nested");
+    REQUIRE(third_row.GetSecond().GetBool());
+    REQUIRE(list.GetSecond().GetSecond().GetSecond().GetKind() == Kind::kNull);
+}
+
+TEST_CASE("Long binary lists load without deep recursion") {
+    Ref<Object> list;
+    for (int i = 0; i < 1000000; ++i) {
+        Ref<Cell> cell = MakeRef<Cell>();
+        cell->first_ = MakeRef<Number>(i % 7);
+        cell->second_ = std::move(list);
+        list = std::move(cell);
+    }
+
+    BinaryWriter writer;
+    writer.Add(list);
+    std::string bytes = writer.Finish();
+    auto image = BinaryImage::Open(bytes);
+    REQUIRE(image);
+    Interpreter interpreter;
+    REQUIRE(interpreter.ASTToString(image->Load(0).ValueOrThrow()) ==
+            interpreter.ASTToString(list));
+
+    // The spine of a list is one level deep, however long it is.
+    REQUIRE(image->Load(0, 1));
+}
+
+TEST_CASE("Binary loading enforces the depth limit") {
+    BinaryWriter writer;
+    writer.Add(ReadText("(1 (2 (3 (4))))"));
+    std::string bytes = writer.Finish();
+    auto image = BinaryImage::Open(bytes);
+    REQUIRE(image);
+    REQUIRE(image->Load(0, 4));
+    auto loaded = image->Load(0, 3);
+    REQUIRE_FALSE(loaded);
+    REQUIRE(loaded.GetError().kind == ErrorKind::kLimit);
+}
+
+TEST_CASE("Binary loading bounds the depth by default") {
+    Ref<Object> tree = MakeRef<Number>(1);
+    for (size_t i = 0; i <= BinaryImage::kDefaultMaxDepth; ++i) {
+        Ref<Quote> quote = MakeRef<Quote>();
+        quote->next_ = std::move(tree);
+        tree = std::move(quote);
+    }
+    BinaryWriter writer;
+    writer.Add(tree);
+    std::string bytes = writer.Finish();
+    auto image = BinaryImage::Open(bytes);
+    REQUIRE(image);
+    auto loaded = image->Load(0);
+    REQUIRE_FALSE(loaded);
+    REQUIRE(loaded.GetError().kind == ErrorKind::kLimit);
+    REQUIRE(image->Load(0, BinaryImage::kDefaultMaxDepth + 1));
+}
+
+TEST_CASE("Malformed binary images are rejected") {
+    REQUIRE_FALSE(BinaryImage::Open(""));
+    REQUIRE_FALSE(BinaryImage::Open("(1 2 3) is text rather than a binary image, it is rejected"));
+
+    BinaryWriter writer;
+    writer.Add(ReadText("(define (f x) (if (< x 0) (- x) '(x 100000)))"));
+    writer.Add(ReadText("(#t #f ((a) . b))"));
+    std::string bytes = writer.Finish();
+
+    // Every truncation and every flipped byte either fails cleanly or loads something.
+    for (size_t size = 0; size < bytes.size(); ++size) {
+        auto image = BinaryImage::Open(std::string_view(bytes).substr(0, size));
+        if (image) {
+            for (size_t i = 0; i < image->GetTreeCount(); ++i) {
+                image->Load(i);
+            }
+        }
+    }
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        for (int bit = 0; bit < 8; ++bit) {
+            std::string corrupt = bytes;
+            corrupt[i] ^= static_cast<char>(1 << bit);
+            auto image = BinaryImage::Open(corrupt);
+            if (image) {
+                for (size_t tree = 0; tree < image->GetTreeCount(); ++tree) {
+                    image->Load(tree);
+                }
+            }
+        }
+    }
+
+    auto truncated = BinaryImage::Open(std::string_view(bytes).substr(0, bytes.size() - 1));
+    REQUIRE(truncated);
+    auto loaded = truncated->Load(1);
+    REQUIRE_FALSE(loaded);
+    REQUIRE(loaded.GetError().kind == ErrorKind::kSyntax);
+}
+
+TEST_CASE("Binary images are read from mapped files") {
+    BinaryWriter writer;
+    for (int i = 0; i < 100; ++i) {
+        writer.Add(ReadText("(row " + std::to_string(i) + " (ok 0 0))"));
+    }
+    std::string path = "test_binary_image.bin";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << writer.Finish();
+    }
+
+    auto file = MappedFile::Open(path);
+    REQUIRE(file);
+    auto image = BinaryImage::Open(file->GetBytes());
+    REQUIRE(image);
+    REQUIRE(image->GetTreeCount() == 100);
+    Interpreter interpreter;
+    REQUIRE(interpreter.ASTToString(image->Load(42).ValueOrThrow()) == "(row 42 (ok 0 0))");
+    std::remove(path.c_str());
+
+    auto missing = MappedFile::Open("no/such/file.bin");
+    REQUIRE_FALSE(missing);
+    REQUIRE(missing.GetError().kind == ErrorKind::kRuntime);
+}
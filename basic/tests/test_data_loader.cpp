@@ -0,0 +1,150 @@
+#include <catch.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <data_loader.h>
+#include <parser.h>
+#include <scheme.h>
+
+namespace {
+std::vector<std::string> LoadAll(DataLoader* loader) {
+    Interpreter interpreter;
+    std::vector<std::string> printed;
+    Ref<Object> datum;
+    while (loader->Next(&datum)) {
+        printed.push_back(interpreter.ASTToString(datum));
+    }
+    return printed;
+}
+
+std::string MakeData(std::vector<std::string>* expected) {
+    std::string data;
+    for (int i = 0; i < 2000; ++i) {
+        std::string datum;
+        switch (i % 5) {
+            case 0:
+                datum = "(record " + std::to_string(i) + " (ok #t) ())";
+                break;
+            case 1:
+                datum = "(" + std::string(i % 90, 'x') + " . " + std::to_string(-i) + ")";
+                break;
+            case 2:
+                datum = std::to_string(i);
+                break;
+            case 3:
+                datum = "((((" + std::to_string(i) + ") a) b) c)";
+                break;
+            case 4:
+                datum = "sym-" + std::to_string(i);
+                break;
+        }
+        expected->push_back(datum);
+        data += datum;
+        data += i % 3 == 0 ? "\n" : i % 3 == 1 ? "  \t" : "";
+        if (i % 3 == 2 && datum.back() != ')') {
+            data += ' ';
+        }
+    }
+    return data;
+}
+}  // namespace
+
+TEST_CASE("Data loader yields datums in file order") {
+    std::vector<std::string> expected;
+    std::string data = MakeData(&expected);
+
+    WorkStealingPool pool(4);
+    for (size_t chunk_bytes : {1, 7, 64, 1000, 1 << 20}) {
+        for (size_t window_bytes : {1, 4096, 1 << 24}) {
+            INFO(chunk_bytes << " " << window_bytes);
+            DataLoader loader(data, &pool, {.chunk_bytes = chunk_bytes,
+                                            .window_bytes = window_bytes});
+            REQUIRE(LoadAll(&loader) == expected);
+            REQUIRE(loader.GetError() == nullptr);
+        }
+    }
+
+    DataLoader inline_loader(data, nullptr, {.chunk_bytes = 100});
+    REQUIRE(LoadAll(&inline_loader) == expected);
+}
+
+TEST_CASE("Data loader keeps quotes with their datum") {
+    WorkStealingPool pool(2);
+    DataLoader loader("'(1 2) ' x ''(a) (b)", &pool, {.chunk_bytes = 1});
+    Ref<Object> datum;
+    for (int i = 0; i < 3; ++i) {
+        REQUIRE(loader.Next(&datum));
+        REQUIRE(Is<Quote>(datum));
+    }
+    REQUIRE(loader.Next(&datum));
+    REQUIRE(Is<Cell>(datum));
+    REQUIRE_FALSE(loader.Next(&datum));
+    REQUIRE(loader.GetError() == nullptr);
+}
+
+TEST_CASE("Data loader stops at the first bad datum") {
+    std::string data;
+    for (int i = 0; i < 100; ++i) {
+        data += "(good " + std::to_string(i) + ")\n";
+    }
+    size_t bad_offset = data.size();
+    data += "(bad . . 1)\n(good 100)\n";
+
+    WorkStealingPool pool(4);
+    for (size_t chunk_bytes : {16, 1 << 20}) {
+        DataLoader loader(data, &pool, {.chunk_bytes = chunk_bytes});
+        std::vector<std::string> printed = LoadAll(&loader);
+        REQUIRE(printed.size() == 100);
+        REQUIRE(printed.back() == "(good 99)");
+        REQUIRE(loader.GetError() != nullptr);
+        REQUIRE(loader.GetError()->kind == ErrorKind::kSyntax);
+        REQUIRE(loader.GetError()->offset > bad_offset);
+        REQUIRE(loader.GetError()->offset < bad_offset + 10);
+    }
+
+    DataLoader unbalanced("(1 2) (3 4))(5)", &pool);
+    REQUIRE(LoadAll(&unbalanced).size() == 2);
+    REQUIRE(unbalanced.GetError() != nullptr);
+
+    DataLoader deep("(1) ((((2))))", &pool, {.max_depth = 3});
+    REQUIRE(LoadAll(&deep).size() == 1);
+    REQUIRE(deep.GetError()->kind == ErrorKind::kLimit);
+}
+
+TEST_CASE("Data loader reads mapped files") {
+    std::vector<std::string> expected;
+    std::string data = MakeData(&expected);
+    std::string path = "test_data_loader.scm";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << data;
+    }
+
+    WorkStealingPool pool(3);
+    auto loader = DataLoader::Open(path, &pool, {.chunk_bytes = 4096, .window_bytes = 16384});
+    REQUIRE(loader);
+    REQUIRE(LoadAll(loader->get()) == expected);
+    std::remove(path.c_str());
+
+    REQUIRE_FALSE(DataLoader::Open("no/such/file.scm", &pool));
+
+    DataLoader empty("", &pool);
+    Ref<Object> datum;
+    REQUIRE_FALSE(empty.Next(&datum));
+    REQUIRE(empty.GetError() == nullptr);
+}
+
+TEST_CASE("Data loader can be dropped midway") {
+    std::vector<std::string> expected;
+    std::string data = MakeData(&expected);
+    WorkStealingPool pool(4);
+    for (int i = 0; i < 20; ++i) {
+        DataLoader loader(data, &pool, {.chunk_bytes = 256});
+        Ref<Object> datum;
+        REQUIRE(loader.Next(&datum));
+    }
+}
@@ -0,0 +1,105 @@
+#include <catch.hpp>
+
+#include <error.h>
+#include <heap.h>
+#include <scheme.h>
+
+namespace {
+Ref<Object> MakeList(int size) {
+    Ref<Object> list;
+    for (int i = size; i > 0; --i) {
+        auto cell = MakeRef<Cell>();
+        cell->first_ = MakeRef<Number>(i);
+        cell->second_ = std::move(list);
+        list = std::move(cell);
+    }
+    return list;
+}
+
+int Sum(const Ref<Object>& list) {
+    int sum = 0;
+    for (Cell* cell = As<Cell>(list); cell != nullptr; cell = As<Cell>(cell->GetSecond())) {
+        sum += As<Number>(cell->GetFirst())->GetValue();
+    }
+    return sum;
+}
+}  // namespace
+
+TEST_CASE("Heap objects are not reference counted") {
+    Heap heap;
+    Heap::Scope scope(&heap);
+
+    auto number = MakeRef<Number>(1);
+    REQUIRE(number->IsGcManaged());
+    REQUIRE(number->GetRefCount() == 0);
+    REQUIRE(heap.GetStats().nursery_bytes > 0);
+}
+
+TEST_CASE("Minor collections keep roots and promote survivors") {
+    GcOptions options;
+    options.promotion_age = 2;
+    Heap heap(options);
+    Heap::Scope scope(&heap);
+
+    Ref<Object> list = MakeList(100);
+    Heap::Root root(&heap, &list);
+    MakeList(1000);
+
+    heap.CollectMinor();
+    REQUIRE(Sum(list) == 5050);
+    REQUIRE(heap.GetStats().old_generation_bytes == 0);
+    REQUIRE(heap.GetStats().bytes_collected > 0);
+
+    heap.CollectMinor();
+    REQUIRE(Sum(list) == 5050);
+    REQUIRE(heap.GetStats().nursery_bytes == 0);
+    REQUIRE(heap.GetStats().old_generation_bytes > 0);
+    REQUIRE(heap.GetStats().minor_collections == 2);
+}
+
+TEST_CASE("Major collection reclaims cycles") {
+    GcOptions options;
+    options.promotion_age = 1;
+    Heap heap(options);
+    Heap::Scope scope(&heap);
+
+    Ref<Object> cycle = MakeList(10);
+    Cell* last = As<Cell>(cycle);
+    while (last->GetSecond() != nullptr) {
+        last = As<Cell>(last->GetSecond());
+    }
+    last->second_ = cycle;
+
+    {
+        Heap::Root root(&heap, &cycle);
+        heap.CollectMinor();
+    }
+    size_t promoted = heap.GetStats().old_generation_bytes;
+    REQUIRE(promoted > 0);
+
+    cycle = nullptr;
+    heap.CollectMajor();
+    REQUIRE(heap.GetStats().old_generation_bytes == 0);
+    REQUIRE(heap.GetStats().bytes_collected >= promoted);
+    REQUIRE(heap.GetStats().major_collections == 1);
+}
+
+TEST_CASE("Interpreter with collected heap") {
+    GcOptions options;
+    options.nursery_bytes = 4096;
+    Interpreter interpreter;
+    interpreter.EnableGc(options);
+
+    for (int i = 0; i < 1000; ++i) {
+        REQUIRE(interpreter.Run("(+ 1 2 3)") == "6");
+        REQUIRE(interpreter.Run("(cons (list-ref '(1 2 3) 1) (cdr '(a b c)))") == "(2 b c)");
+        REQUIRE(interpreter.Run("(and 1 (> 2 1) '(x y))") == "(x y)");
+        REQUIRE_THROWS_AS(interpreter.Run("(car '())"), RuntimeError);
+    }
+
+    GcStats stats = interpreter.GetGcStats();
+    REQUIRE(stats.minor_collections > 0);
+    REQUIRE(stats.bytes_collected > 0);
+    REQUIRE(stats.max_pause >= stats.last_pause);
+    REQUIRE(stats.nursery_bytes <= 2 * options.nursery_bytes);
+}
@@ -0,0 +1,112 @@
+#include <catch.hpp>
+
+#include <sstream>
+#include <string>
+
+#include <hash_cons.h>
+#include <parser.h>
+#include <scheme.h>
+
+namespace {
+Ref<Object> ReadWith(HashConsTable* table, const std::string& input) {
+    std::stringstream stream(input);
+    Tokenizer tokenizer(&stream);
+    return TryRead(&tokenizer, 0, table).ValueOrThrow();
+}
+
+Object* Nth(const Ref<Object>& list, int index) {
+    Object* current = list.Get();
+    for (int i = 0; i < index; ++i) {
+        current = As<Cell>(current)->GetSecond().Get();
+    }
+    return As<Cell>(current)->GetFirst().Get();
+}
+}  // namespace
+
+TEST_CASE("Equal quoted data is one object") {
+    HashConsTable table;
+    Ref<Object> first = ReadWith(&table, "'((0 0 0) (1 0 0) (0 0 0) foo #t foo)");
+    Ref<Object> second = ReadWith(&table, "'((0 0 0) (1 0 0) (0 0 0) foo #t foo)");
+
+    Ref<Object> rows = As<Quote>(first)->next_;
+    REQUIRE(rows == As<Quote>(second)->next_);
+    REQUIRE(rows->IsHashConsed());
+    REQUIRE(rows->IsShared());
+    REQUIRE(Nth(rows, 0) == Nth(rows, 2));
+    REQUIRE(Nth(rows, 0) != Nth(rows, 1));
+    REQUIRE(Nth(rows, 3) == Nth(rows, 5));
+    // (1 0 0) ends in the same (0 0) as (0 0 0).
+    REQUIRE(As<Cell>(Nth(rows, 1))->GetSecond() == As<Cell>(Nth(rows, 0))->GetSecond());
+
+    // Code is left alone, only what is quoted gets interned.
+    Ref<Object> code = ReadWith(&table, "(list-ref '(0 0) 0)");
+    REQUIRE_FALSE(code->IsHashConsed());
+    REQUIRE(Is<Quote>(Nth(code, 1)));
+
+    auto stats = table.GetStats();
+    REQUIRE(stats.hits > 0);
+    REQUIRE(stats.entries > 0);
+}
+
+TEST_CASE("Hash-consing keeps results") {
+    const char* kPrograms[] = {
+        "'(1 2 . 3)",
+        "(cons '(0 0) '(0 0))",
+        "(cdr '((0 0 0) (1 0 0) (0 0 0)))",
+        "(list-ref '(3 4 5) 1)",
+        "(list-tail '(a b a b) 2)",
+        "(list? '(x 'y 'y))",
+        "'#t",
+        "'()",
+    };
+
+    Interpreter plain;
+    Interpreter consing;
+    consing.EnableHashConsing();
+    Interpreter collected;
+    collected.EnableHashConsing();
+    collected.EnableGc({.nursery_bytes = 4 << 10});
+    for (int i = 0; i < 50; ++i) {
+        for (const char* program : kPrograms) {
+            INFO(program);
+            std::string expected = plain.Run(program);
+            REQUIRE(consing.Run(program) == expected);
+            REQUIRE(collected.Run(program) == expected);
+        }
+    }
+    REQUIRE(consing.GetHashConsStats().hits > 0);
+}
+
+TEST_CASE("Unreferenced entries are swept") {
+    HashConsTable table;
+    {
+        Ref<Object> datum = ReadWith(&table, "'((1 2) (3 (4 5)) six)");
+        table.Sweep();
+        REQUIRE(table.GetStats().entries > 0);
+    }
+    table.Sweep();
+    REQUIRE(table.GetStats().entries == 0);
+
+    // Growing the table sweeps it on the way.
+    for (int i = 0; i < 10000; ++i) {
+        ReadWith(&table, "'(" + std::to_string(i) + " x)");
+    }
+    REQUIRE(table.GetStats().entries < 5000);
+    REQUIRE(table.GetStats().swept > 5000);
+}
+
+TEST_CASE("Long lists are interned without deep recursion") {
+    HashConsTable table;
+    Ref<Object> list;
+    for (int i = 0; i < 1000000; ++i) {
+        Ref<Cell> cell = MakeRef<Cell>();
+        cell->first_ = MakeRef<Number>(i % 3);
+        cell->second_ = std::move(list);
+        list = std::move(cell);
+    }
+
+    Ref<Object> interned = table.Intern(list);
+    REQUIRE(interned != list);
+    REQUIRE(table.Intern(list) == interned);
+    REQUIRE(table.GetStats().entries == 1000000 + 3);
+}
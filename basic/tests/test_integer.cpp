@@ -81,6 +81,18 @@ TEST_CASE_METHOD(SchemeTest, "IntegerArithmeticsEdgeCases") {
     ExpectEq("(*)", "1");
     ExpectRuntimeError("(/)");
     ExpectRuntimeError("(-)");
+    ExpectRuntimeError("(/ 1 0)");
+    ExpectRuntimeError("(/ 4 2 0 1)");
+    ExpectRuntimeError("(/ -2147483648 -1)");
+
+    ExpectRuntimeError("(+ 2147483647 1)");
+    ExpectRuntimeError("(- -2147483648 1)");
+    ExpectRuntimeError("(* 65536 65536)");
+    ExpectRuntimeError("(* -2147483648 -1)");
+    ExpectRuntimeError("(abs -2147483648)");
+    ExpectEq("(+ 2147483647 -1 1)", "2147483647");
+    ExpectEq("(- -2147483647 1)", "-2147483648");
+    ExpectEq("(abs -2147483647)", "2147483647");
 }
 
 TEST_CASE_METHOD(SchemeTest, "IntegerMaxMin") {
@@ -0,0 +1,102 @@
+#include <catch.hpp>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <latency.h>
+#include <scheme.h>
+
+TEST_CASE("Latency buckets cover every value") {
+    for (size_t i = 1; i < LatencyHistogram::kBuckets; ++i) {
+        REQUIRE(LatencyHistogram::GetBucketStart(i) > LatencyHistogram::GetBucketStart(i - 1));
+        uint64_t start = LatencyHistogram::GetBucketStart(i);
+        REQUIRE(LatencyHistogram::GetBucket(start) == i);
+        REQUIRE(LatencyHistogram::GetBucket(start - 1) == i - 1);
+    }
+    REQUIRE(LatencyHistogram::GetBucket(UINT64_MAX) == LatencyHistogram::kBuckets - 1);
+}
+
+TEST_CASE("Latency quantiles stay within a bucket of the truth") {
+    LatencyHistogram histogram;
+    REQUIRE(histogram.GetQuantile(0.5) == 0);
+    for (uint64_t value = 1; value <= 100000; ++value) {
+        histogram.Record(value * 1000);
+    }
+    REQUIRE(histogram.GetCount() == 100000);
+    REQUIRE(histogram.GetMax() == 100000000);
+    for (double q : {0.5, 0.9, 0.99, 0.999}) {
+        double expected = q * 100000000;
+        REQUIRE(histogram.GetQuantile(q) >= expected);
+        REQUIRE(histogram.GetQuantile(q) <= expected * 1.035);
+    }
+    REQUIRE(histogram.GetQuantile(1) == 100000000);
+
+    LatencyHistogram small;
+    small.Record(7);
+    small.Merge(histogram);
+    REQUIRE(small.GetCount() == 100001);
+    REQUIRE(small.GetQuantile(0) == 7);
+}
+
+TEST_CASE("Interpreters record phases into their own shards") {
+    LatencyRecorder recorder;
+    std::atomic<int> wrong = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&recorder, &wrong] {
+            Interpreter interpreter;
+            for (int i = 0; i < 250; ++i) {
+                interpreter.SetLatencyRecorder(&recorder);
+                wrong += interpreter.Run("(+ 1 (* 2 3))") != "7";
+            }
+            interpreter.SetLatencyRecorder(&recorder);
+            wrong += interpreter.TryRun("(car 1)").HasValue();
+            wrong += interpreter.TryRun("(1").HasValue();
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    REQUIRE(wrong == 0);
+
+    REQUIRE(recorder.Merge(Phase::kTotal).GetCount() == 1008);
+    REQUIRE(recorder.Merge(Phase::kRead).GetCount() == 1004);
+    REQUIRE(recorder.Merge(Phase::kEvaluate).GetCount() == 1000);
+    REQUIRE(recorder.Merge(Phase::kPrint).GetCount() == 1000);
+    REQUIRE(recorder.Merge(Phase::kTotal).GetSum() >= recorder.Merge(Phase::kEvaluate).GetSum());
+
+    Interpreter detached;
+    detached.SetLatencyRecorder(&recorder);
+    detached.SetLatencyRecorder(nullptr);
+    detached.Run("1");
+    REQUIRE(recorder.Merge(Phase::kTotal).GetCount() == 1008);
+}
+
+TEST_CASE("Latency recorder exports Prometheus text") {
+    LatencyRecorder recorder;
+    Interpreter interpreter;
+    interpreter.SetLatencyRecorder(&recorder);
+    interpreter.Run("(list 1 2 3)");
+
+    std::string text = recorder.ToPrometheus();
+    REQUIRE(text.find("# TYPE scheme_phase_duration_seconds summary\n") != std::string::npos);
+    REQUIRE(text.find("scheme_phase_duration_seconds{phase=\"evaluate\",quantile=\"0.999\"} ") !=
+            std::string::npos);
+    REQUIRE(text.find("scheme_phase_duration_seconds_count{phase=\"print\"} 1\n") !=
+            std::string::npos);
+
+    std::string path = "test_latency.prom";
+    REQUIRE(recorder.ExportPrometheus(path));
+    std::ifstream in(path);
+    std::stringstream written;
+    written << in.rdbuf();
+    REQUIRE(written.str() == text);
+    std::remove(path.c_str());
+
+    REQUIRE_FALSE(recorder.ExportPrometheus("no/such/dir/metrics.prom"));
+}
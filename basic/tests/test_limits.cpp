@@ -0,0 +1,103 @@
+#include <catch.hpp>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include <error.h>
+#include <scheme.h>
+
+namespace {
+// (+ (+ 1) (+ 1) ...) makes count + 1 calls.
+std::string MakeWideCall(size_t count) {
+    std::string program = "(+";
+    for (size_t i = 0; i < count; ++i) {
+        program += " (+ 1)";
+    }
+    program += ')';
+    return program;
+}
+
+std::string MakeDeepCall(size_t depth) {
+    std::string program;
+    for (size_t i = 0; i < depth; ++i) {
+        program += "(+ 1 ";
+    }
+    program += '1';
+    program.append(depth, ')');
+    return program;
+}
+}  // namespace
+
+TEST_CASE("Step limit") {
+    Interpreter interpreter;
+    interpreter.SetLimits({.max_steps = 100});
+
+    REQUIRE(interpreter.Run(MakeWideCall(99)) == "99");
+    auto result = interpreter.TryRun(MakeWideCall(100));
+    REQUIRE_FALSE(result);
+    REQUIRE(result.GetError().kind == ErrorKind::kLimit);
+    REQUIRE(result.GetError().message == "Step limit exceeded");
+    REQUIRE_THROWS_AS(interpreter.Run(MakeWideCall(1000)), LimitError);
+
+    // Every run gets the full budget.
+    REQUIRE(interpreter.Run(MakeWideCall(99)) == "99");
+}
+
+TEST_CASE("Memory limit") {
+    Interpreter interpreter;
+    interpreter.SetLimits({.max_bytes = 64 << 10});
+
+    REQUIRE(interpreter.Run(MakeWideCall(10)) == "10");
+    REQUIRE_THROWS_AS(interpreter.Run(MakeWideCall(10000)), LimitError);
+    REQUIRE_THROWS_AS(interpreter.Run("'" + MakeWideCall(10000)), LimitError);
+}
+
+TEST_CASE("Depth limit") {
+    Interpreter interpreter;
+    interpreter.SetLimits({.max_depth = 50});
+
+    REQUIRE(interpreter.Run(MakeDeepCall(49)) == "50");
+    REQUIRE(interpreter.Run(MakeWideCall(1000)) == "1000");
+
+    auto too_deep = interpreter.TryRun(MakeDeepCall(51));
+    REQUIRE_FALSE(too_deep);
+    REQUIRE(too_deep.GetError().kind == ErrorKind::kLimit);
+    REQUIRE(too_deep.GetError().message == "Input is nested too deeply");
+
+    REQUIRE_THROWS_AS(interpreter.Run("'" + std::string(100, '(') + std::string(100, ')')),
+                      LimitError);
+    REQUIRE_THROWS_AS(interpreter.Run(std::string(100, '\'') + "1"), LimitError);
+}
+
+TEST_CASE("Limit errors are runtime errors") {
+    Interpreter interpreter;
+    interpreter.SetLimits({.max_steps = 1});
+    REQUIRE_THROWS_AS(interpreter.Run("(+ 1 (+ 2 3))"), RuntimeError);
+    REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+}
+
+TEST_CASE("Cancellation") {
+    Interpreter interpreter;
+    CancellationToken token;
+    interpreter.SetCancellationToken(&token);
+
+    REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+    token.Cancel();
+    REQUIRE_THROWS_AS(interpreter.Run("(+ 1 2)"), LimitError);
+    token.Reset();
+    REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+
+    std::string program = MakeWideCall(5000);
+    std::thread canceller([&token] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        token.Cancel();
+    });
+    bool cancelled = false;
+    for (int i = 0; i < 100000 && !cancelled; ++i) {
+        auto result = interpreter.TryRun(program);
+        cancelled = !result && result.GetError().message == "Run cancelled";
+    }
+    canceller.join();
+    REQUIRE(cancelled);
+}
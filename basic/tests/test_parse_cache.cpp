@@ -0,0 +1,89 @@
+#include <catch.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <error.h>
+#include <parse_cache.h>
+#include <scheme.h>
+
+TEST_CASE("Parse cache reuses programs") {
+    ParseCache cache(1 << 20);
+    Interpreter interpreter;
+    interpreter.SetParseCache(&cache);
+
+    for (int i = 0; i < 3; ++i) {
+        REQUIRE(interpreter.Run("(cons (+ 1 2) (list-tail '(1 2 3) 1))") == "(3 2 3)");
+        REQUIRE(interpreter.Run("(list 1 2 3)") == "(1 2 3)");
+        REQUIRE_THROWS_AS(interpreter.Run("(car 1)"), RuntimeError);
+        REQUIRE_THROWS_AS(interpreter.Run("(car 1"), SyntaxError);
+    }
+
+    auto stats = cache.GetStats();
+    REQUIRE(stats.insertions == 3);
+    REQUIRE(stats.hits == 6);
+    REQUIRE(stats.misses == 6);
+
+    Ref<Object> program;
+    REQUIRE(cache.Lookup("(list 1 2 3)", &program));
+    REQUIRE(program->IsShared());
+    REQUIRE_FALSE(cache.Lookup("(list 1 2 4)", &program));
+}
+
+TEST_CASE("Parse cache with limits and the collected heap") {
+    ParseCache cache(1 << 20);
+    Interpreter interpreter;
+    interpreter.SetParseCache(&cache);
+    interpreter.EnableGc({.nursery_bytes = 4 << 10});
+    interpreter.SetLimits({.max_steps = 10});
+
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(interpreter.Run("(cons (+ 1 2) '(4 5))") == "(3 4 5)");
+        REQUIRE_THROWS_AS(interpreter.Run("(+ (+ 1) (+ 1) (+ 1) (+ 1) (+ 1) (+ 1) (+ 1) (+ 1) "
+                                          "(+ 1) (+ 1))"),
+                          LimitError);
+    }
+    REQUIRE(cache.GetStats().hits == 198);
+}
+
+TEST_CASE("Cached programs are shared between threads") {
+    static const char* kPrograms[] = {
+        "(list-ref '(1 2 3 4) (+ 1 1))",
+        "(cons (car '(1 2)) (cdr '(3 4)))",
+        "(and (< 1 2) (list 1 2))",
+        "(max (- 10 2) (* 2 3) (abs -9))",
+    };
+    static const char* kResults[] = {"3", "(1 4)", "(1 2)", "9"};
+
+    ParseCache cache(1 << 20, 2);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache, t] {
+            Interpreter interpreter;
+            interpreter.SetParseCache(&cache);
+            if (t % 2 == 1) {
+                interpreter.EnableGc();
+            }
+            for (int i = 0; i < 2000; ++i) {
+                size_t index = (i + t) % std::size(kPrograms);
+                if (interpreter.Run(kPrograms[index]) != kResults[index]) {
+                    throw std::logic_error("Wrong result");
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    REQUIRE(cache.GetStats().entries == std::size(kPrograms));
+}
+
+TEST_CASE("ToList builds a new list") {
+    Interpreter interpreter;
+    std::vector<Ref<Object>> elements = {MakeRef<Number>(1), MakeRef<Number>(2)};
+
+    Ref<Object> list = interpreter.ToList(elements);
+    REQUIRE(interpreter.ASTToString(list) == "(1 2)");
+    REQUIRE(interpreter.ToList({}) == nullptr);
+}
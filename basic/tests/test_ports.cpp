@@ -0,0 +1,229 @@
+#include <catch.hpp>
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <async.h>
+#include <data_loader.h>
+#include <ports.h>
+#include <scheme.h>
+
+namespace {
+std::vector<std::string> ReadAll(InputPort* port) {
+    Interpreter interpreter;
+    std::vector<std::string> printed;
+    for (Ref<Object> datum; port->Read(&datum);) {
+        printed.push_back(interpreter.ASTToString(datum));
+    }
+    return printed;
+}
+}  // namespace
+
+TEST_CASE("display, write and newline print to the output port") {
+    StringOutputPort port;
+    Interpreter interpreter;
+    interpreter.SetOutputPort(&port);
+
+    REQUIRE(interpreter.Run("(display (+ 1 2))").empty());
+    REQUIRE(interpreter.Run("(newline)").empty());
+    interpreter.Run("(write '(a (1 . #t) ()))");
+    interpreter.Run("(display (cdr '(1 2 3)))");
+    interpreter.Run("(newline)");
+    interpreter.Run("(display -2147483648)");
+    REQUIRE(port.GetString() == "3\n(a (1 . #t) ())(2 3)\n-2147483648");
+
+    REQUIRE_THROWS_AS(interpreter.Run("(display)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(display 1 2)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(newline 1)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(display (car '()))"), RuntimeError);
+    REQUIRE(port.GetSize() == 34);
+
+    interpreter.SetOutputPort(nullptr);
+    auto result = interpreter.TryRun("(newline)");
+    REQUIRE_FALSE(result);
+    REQUIRE(result.GetError().kind == ErrorKind::kRuntime);
+}
+
+TEST_CASE("Output is not served from the result cache") {
+    StringOutputPort port;
+    ResultCache cache(1 << 20);
+    Interpreter interpreter;
+    interpreter.SetOutputPort(&port);
+    interpreter.SetResultCache(&cache);
+    for (int i = 0; i < 3; ++i) {
+        interpreter.Run("(display (* 6 7))");
+    }
+    REQUIRE(port.GetString() == "424242");
+}
+
+TEST_CASE("Asynchronous runs print in the order of evaluation") {
+    StringOutputPort port;
+    Interpreter interpreter;
+    interpreter.SetOutputPort(&port);
+    std::string input = "(pair? (cons (display 1) (cons (newline) (display 2))))";
+    REQUIRE(interpreter.Run(input) == "#t");
+
+    Scheduler scheduler(1);
+    std::optional<Expected<std::string>> result;
+    scheduler.Spawn([](Interpreter* interpreter, Scheduler* scheduler, std::string input,
+                       std::optional<Expected<std::string>>* result) -> Task<void> {
+        result->emplace(co_await interpreter->RunAsync(scheduler, std::move(input)));
+    }(&interpreter, &scheduler, input, &result));
+    scheduler.Run();
+    REQUIRE(**result == "#t");
+    REQUIRE(port.GetString() == "1\n21\n2");
+}
+
+TEST_CASE("String ports keep full buffers as blocks") {
+    StringOutputPort port(8);
+    std::string expected;
+    for (int i = 0; i < 100; ++i) {
+        std::string text = std::string(i % 13, 'a' + i % 26) + std::to_string(i);
+        port.Write(text);
+        expected += text;
+        REQUIRE(port.GetSize() == expected.size());
+    }
+    REQUIRE(port.GetString() == expected);
+    REQUIRE(port.Flush());
+    REQUIRE(port.GetString() == expected);
+    port.Clear();
+    REQUIRE(port.GetString().empty());
+    REQUIRE(port.GetSize() == 0);
+}
+
+TEST_CASE("File ports write their buffer and large text in one go") {
+    std::string path = "test_ports_output.txt";
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    REQUIRE(file != nullptr);
+    std::string expected;
+    {
+        FileOutputPort port(fileno(file), 16);
+        Interpreter interpreter;
+        interpreter.SetOutputPort(&port);
+        for (int i = 0; i < 50; ++i) {
+            interpreter.Run("(display '(" + std::to_string(i) + " x))");
+            expected += "(" + std::to_string(i) + " x)";
+        }
+        std::string large(1000, 'z');
+        port.Write(large);
+        expected += large;
+        port.Write("tail");
+        expected += "tail";
+        REQUIRE(port.Flush());
+    }
+    std::fclose(file);
+
+    std::stringstream written;
+    written << std::ifstream(path).rdbuf();
+    REQUIRE(written.str() == expected);
+    std::remove(path.c_str());
+
+    FileOutputPort closed(-1, 4);
+    closed.Write("more than four bytes");
+    REQUIRE_FALSE(closed.Flush());
+}
+
+TEST_CASE("Input ports read one datum at a time") {
+    std::string data = "(a (1 . 2) ()) 42\n\t(x y)sym(b)#t\n\n" + std::string(300, ' ') + "(" +
+                       std::string(100, 'z') + " (deep (er)))   -7";
+    std::string path = "test_ports_input.scm";
+    std::ofstream(path) << data;
+
+    DataLoader loader(data, nullptr);
+    Interpreter interpreter;
+    std::vector<std::string> expected;
+    for (Ref<Object> datum; loader.Next(&datum);) {
+        expected.push_back(interpreter.ASTToString(datum));
+    }
+    REQUIRE(expected.size() == 8);
+
+    for (size_t buffer_bytes : {1, 3, 16, 1 << 16}) {
+        for (bool map : {false, true}) {
+            INFO("buffer " << buffer_bytes << (map ? " mapped" : ""));
+            auto port = InputPort::Open(path, {.buffer_bytes = buffer_bytes, .map = map});
+            REQUIRE(port);
+            REQUIRE_FALSE((*port)->AtEnd());
+            REQUIRE(ReadAll(port->get()) == expected);
+            REQUIRE((*port)->AtEnd());
+            REQUIRE((*port)->GetError() == nullptr);
+        }
+    }
+
+    std::ofstream(path) << "'(x 'y)'\n z";
+    auto port = InputPort::Open(path, {.buffer_bytes = 1});
+    REQUIRE(port);
+    Ref<Object> datum;
+    REQUIRE((*port)->Read(&datum));
+    REQUIRE(Is<Quote>(datum));
+    REQUIRE(Is<Cell>(As<Quote>(datum)->next_));
+    REQUIRE((*port)->Read(&datum));
+    REQUIRE(Is<Quote>(datum));
+    REQUIRE(Is<Symbol>(As<Quote>(datum)->next_));
+    REQUIRE_FALSE((*port)->Read(&datum));
+    REQUIRE((*port)->AtEnd());
+
+    std::remove(path.c_str());
+    REQUIRE_FALSE(InputPort::Open(path));
+}
+
+TEST_CASE("Input ports stop at the first datum that does not parse") {
+    std::string path = "test_ports_invalid.scm";
+    std::ofstream(path) << "(a b)\n1 2 ) (c)";
+    for (bool map : {false, true}) {
+        auto port = InputPort::Open(path, {.buffer_bytes = 2, .map = map});
+        REQUIRE(port);
+        REQUIRE(ReadAll(port->get()) == std::vector<std::string>{"(a b)", "1", "2"});
+        REQUIRE((*port)->GetError() != nullptr);
+        REQUIRE((*port)->GetError()->kind == ErrorKind::kSyntax);
+        REQUIRE((*port)->GetError()->offset == 10);
+        Ref<Object> datum;
+        REQUIRE_FALSE((*port)->Read(&datum));
+        REQUIRE_FALSE((*port)->AtEnd());
+    }
+
+    std::ofstream(path) << "(a (b)";
+    auto port = InputPort::Open(path);
+    REQUIRE(ReadAll(port->get()).empty());
+    REQUIRE((*port)->GetError() != nullptr);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("read takes datums from the input port until the eof object") {
+    std::string path = "test_ports_read.scm";
+    std::ofstream(path) << "(1 2 3) 42 #t (x y)";
+    auto port = InputPort::Open(path, {.buffer_bytes = 4});
+    REQUIRE(port);
+    ResultCache cache(1 << 20);
+    Interpreter interpreter;
+    interpreter.SetResultCache(&cache);
+    REQUIRE_THROWS_AS(interpreter.Run("(read)"), RuntimeError);
+
+    interpreter.SetInputPort(port->get());
+    REQUIRE(interpreter.Run("(car (read))") == "1");
+    REQUIRE(interpreter.Run("(read)") == "42");
+    REQUIRE(interpreter.Run("(eof-object? (read))") == "#f");
+    REQUIRE(interpreter.Run("(list-ref (read) 1)") == "y");
+    REQUIRE(interpreter.Run("(eof-object? (read))") == "#t");
+    REQUIRE(interpreter.Run("(read)") == "#[eof]");
+    REQUIRE(interpreter.Run("(eof-object? 'eof)") == "#f");
+    REQUIRE_THROWS_AS(interpreter.Run("(read 1)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("(eof-object?)"), RuntimeError);
+    REQUIRE_THROWS_AS(interpreter.Run("#[eof]"), SyntaxError);
+
+    std::ofstream(path) << "(1 2) (3";
+    port = InputPort::Open(path);
+    REQUIRE(port);
+    interpreter.SetInputPort(port->get());
+    interpreter.EnableGc();
+    REQUIRE(interpreter.Run("(cdr (read))") == "(2)");
+    auto result = interpreter.TryRun("(read)");
+    REQUIRE_FALSE(result);
+    REQUIRE(result.GetError().kind == ErrorKind::kSyntax);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,84 @@
+#include <catch.hpp>
+
+#include <string>
+
+#include <profile.h>
+#include <scheme.h>
+
+namespace {
+const BuiltinProfile* Find(const Profile& profile, const std::string& name) {
+    for (const BuiltinProfile& builtin : profile.builtins) {
+        if (builtin.name == name) {
+            return &builtin;
+        }
+    }
+    return nullptr;
+}
+}  // namespace
+
+TEST_CASE("Profiling is off by default") {
+    Interpreter interpreter;
+    REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+    REQUIRE(interpreter.GetProfile().builtins.empty());
+}
+
+TEST_CASE("Profile counts calls and argument sizes per builtin") {
+    if (!kProfilingBuilt) {
+        return;
+    }
+    Interpreter interpreter;
+    interpreter.EnableProfiling();
+    REQUIRE(interpreter.Run("(+ 1 2 (* 3 4))") == "15");
+    REQUIRE(interpreter.Run("(+ 1 2 3 4 5)") == "15");
+    REQUIRE(interpreter.Run("(list-tail '(1 2 3 4 5 6 7) 2)") == "(3 4 5 6 7)");
+    REQUIRE_THROWS(interpreter.Run("(car 1)"));
+
+    Profile profile = interpreter.GetProfile();
+    const BuiltinProfile* plus = Find(profile, "+");
+    REQUIRE(plus != nullptr);
+    REQUIRE(plus->calls == 2);
+    // Three arguments land in [2, 4), five in [4, 8).
+    REQUIRE(plus->argument_counts[2] == 1);
+    REQUIRE(plus->argument_counts[3] == 1);
+    REQUIRE(plus->exclusive <= plus->inclusive);
+
+    const BuiltinProfile* times = Find(profile, "*");
+    REQUIRE(times != nullptr);
+    REQUIRE(times->calls == 1);
+    REQUIRE(plus->inclusive >= times->inclusive);
+
+    const BuiltinProfile* tail = Find(profile, "list-tail");
+    REQUIRE(tail != nullptr);
+    REQUIRE(tail->list_lengths[3] == 1);
+    REQUIRE(Find(profile, "car")->calls == 1);
+
+    // Sorted by exclusive time.
+    for (size_t i = 1; i < profile.builtins.size(); ++i) {
+        REQUIRE(profile.builtins[i - 1].exclusive >= profile.builtins[i].exclusive);
+    }
+
+    std::string text = profile.ToText();
+    REQUIRE(text.find("list-tail") != std::string::npos);
+    REQUIRE(text.find("4-7:1") != std::string::npos);
+    std::string json = profile.ToJson();
+    REQUIRE(json.find("{\"name\": \"+\", \"calls\": 2,") != std::string::npos);
+    REQUIRE(json.find("\"bucket_starts\": [0, 1, 2, 4, 8,") == 1);
+
+    interpreter.DisableProfiling();
+    interpreter.Run("(+ 1 2)");
+    REQUIRE(interpreter.GetProfile().builtins.empty());
+}
+
+TEST_CASE("Profile lumps unknown names together past a limit") {
+    if (!kProfilingBuilt) {
+        return;
+    }
+    Interpreter interpreter;
+    interpreter.EnableProfiling();
+    for (int i = 0; i < 1000; ++i) {
+        REQUIRE_THROWS(interpreter.Run("(f" + std::to_string(i) + " 1)"));
+    }
+    Profile profile = interpreter.GetProfile();
+    REQUIRE(profile.builtins.size() <= 256);
+    REQUIRE(Find(profile, "(other)") != nullptr);
+}
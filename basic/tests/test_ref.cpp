@@ -0,0 +1,97 @@
+#include <catch.hpp>
+
+#include <thread>
+#include <vector>
+
+#include <object.h>
+#include <scheme.h>
+
+TEST_CASE("Ref counting") {
+    auto number = MakeRef<Number>(5);
+    REQUIRE(number->GetRefCount() == 1);
+
+    Ref<Object> copy = number;
+    REQUIRE(number->GetRefCount() == 2);
+    REQUIRE(copy == number);
+
+    Number* view = As<Number>(copy);
+    REQUIRE(view == number.Get());
+    REQUIRE(number->GetRefCount() == 2);
+    REQUIRE(!As<Bool>(copy));
+
+    Ref<Object> moved = std::move(copy);
+    REQUIRE(!copy);
+    REQUIRE(number->GetRefCount() == 2);
+
+    moved = nullptr;
+    REQUIRE(number->GetRefCount() == 1);
+}
+
+TEST_CASE("Ref from raw pointer") {
+    auto cell = MakeRef<Cell>();
+    cell->first_ = MakeRef<Number>(1);
+
+    Object* raw = cell->first_.Get();
+    Ref<Object> owner(raw);
+    cell.Reset();
+
+    REQUIRE(Is<Number>(owner));
+    REQUIRE(owner->GetRefCount() == 1);
+}
+
+TEST_CASE("Shared graph") {
+    auto list = MakeRef<Cell>();
+    list->first_ = MakeRef<Symbol>("x");
+    list->second_ = MakeRef<Cell>();
+    As<Cell>(list->second_)->first_ = MakeRef<Quote>();
+
+    Share(list);
+    REQUIRE(list->IsShared());
+    REQUIRE(list->first_->IsShared());
+    REQUIRE(list->second_->IsShared());
+    REQUIRE(As<Cell>(list->second_)->first_->IsShared());
+
+    static constexpr int kThreads = 4;
+    static constexpr int kCopies = 10000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+        threads.emplace_back([&list] {
+            for (int j = 0; j < kCopies; ++j) {
+                Ref<Object> copy = list->GetSecond();
+                Ref<Object> symbol = list->GetFirst();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    REQUIRE(list->GetRefCount() == 1);
+    REQUIRE(list->first_->GetRefCount() == 1);
+    REQUIRE(list->second_->GetRefCount() == 1);
+}
+
+#ifndef NDEBUG
+TEST_CASE("Evaluator refcount traffic") {
+    // Each object costs two updates (creation and release), everything else is the overhead
+    // of passing values around, which borrowed arguments keep close to zero.
+    struct Expression {
+        std::string input;
+        uint64_t max_operations;
+    };
+    const std::vector<Expression> expressions = {{"(car '(1 2))", 24},
+                                                 {"(+ 1 2 3 4 5)", 38},
+                                                 {"(and #t (> 2 1) (= 3 3))", 56},
+                                                 {"(list-ref '(1 2 3 4) 2)", 44},
+                                                 {"(cons 1 '(2 3))", 30},
+                                                 {"'(1 2 3 4 5 6 7 8)", 38}};
+
+    Interpreter interpreter;
+    for (const auto& [input, max_operations] : expressions) {
+        ref_count_operations = 0;
+        interpreter.Run(input);
+        INFO(input);
+        REQUIRE(ref_count_operations <= max_operations);
+    }
+}
+#endif
@@ -0,0 +1,131 @@
+#include <catch.hpp>
+
+#include <string>
+#include <thread>
+
+#include <reclaimer.h>
+#include <scheme.h>
+
+namespace {
+Ref<Object> MakeList(size_t size, const Ref<Object>& element) {
+    Ref<Object> list;
+    for (size_t i = 0; i < size; ++i) {
+        auto cell = MakeRef<Cell>();
+        cell->first_ = element;
+        cell->second_ = std::move(list);
+        list = std::move(cell);
+    }
+    return list;
+}
+}  // namespace
+
+TEST_CASE("Dropping a long list") {
+    static constexpr size_t kSize = 10'000'000;
+
+    Ref<Object> element = MakeRef<Number>(1);
+    Ref<Object> list = MakeList(kSize, element);
+    REQUIRE(element->GetRefCount() == kSize + 1);
+
+    list = nullptr;
+    REQUIRE(element->GetRefCount() == 1);
+}
+
+TEST_CASE("Dropping a deep tree") {
+    static constexpr size_t kDepth = 1'000'000;
+
+    Ref<Object> element = MakeRef<Number>(1);
+    Ref<Object> tree = element;
+    for (size_t i = 0; i < kDepth; ++i) {
+        auto cell = MakeRef<Cell>();
+        cell->first_ = std::move(tree);
+        cell->second_ = MakeRef<Quote>();
+        tree = std::move(cell);
+    }
+
+    tree = nullptr;
+    REQUIRE(element->GetRefCount() == 1);
+}
+
+TEST_CASE("Reclaimer") {
+    Ref<Object> element = MakeRef<Number>(1);
+    Share(element);
+
+    Reclaimer reclaimer;
+    for (int i = 0; i < 10; ++i) {
+        reclaimer.Retire(MakeList(100'000, element));
+    }
+    reclaimer.Flush();
+
+    REQUIRE(reclaimer.GetRetiredCount() == 10);
+    REQUIRE(element->GetRefCount() == 1);
+}
+
+TEST_CASE("Interpreter hands large results to the reclaimer") {
+    Reclaimer reclaimer;
+    Interpreter interpreter;
+    interpreter.SetReclaimer(&reclaimer, 100);
+
+    REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+    REQUIRE(reclaimer.GetRetiredCount() == 0);
+
+    std::string list = "'(";
+    for (int i = 0; i < 1000; ++i) {
+        list += std::to_string(i) + " ";
+    }
+    list += ")";
+    REQUIRE(interpreter.Run("(cdr " + list + ")").size() > 100);
+    REQUIRE(reclaimer.GetRetiredCount() == 1);
+    reclaimer.Flush();
+}
+
+TEST_CASE("Reclaimed objects come off the live counts of the retiring thread") {
+    std::string list = "'(";
+    for (int i = 0; i < 1000; ++i) {
+        list += std::to_string(i) + " ";
+    }
+    list += ")";
+
+    auto run = [&list](Reclaimer* reclaimer) {
+        Interpreter interpreter;
+        interpreter.SetReclaimer(reclaimer, 100);
+        interpreter.Run("(cdr " + list + ")");
+        if (reclaimer != nullptr) {
+            reclaimer->Flush();
+        }
+        interpreter.Run("(+ 1 2)");
+        return interpreter.GetAllocationStats().total.live_bytes;
+    };
+
+    Reclaimer reclaimer;
+    int64_t before = GetThreadAllocations().total.live_bytes;
+    REQUIRE(run(&reclaimer) == run(nullptr));
+    REQUIRE(GetThreadAllocations().total.live_bytes == before);
+}
+
+TEST_CASE("Reclaimed objects of a closed account are not counted against anyone") {
+    std::string list = "'(";
+    for (int i = 0; i < 1000; ++i) {
+        list += std::to_string(i) + " ";
+    }
+    list += ")";
+
+    Reclaimer reclaimer;
+    std::thread([&] {
+        Interpreter interpreter;
+        interpreter.SetReclaimer(&reclaimer, 100);
+        interpreter.Run("(cdr " + list + ")");
+    }).join();
+    reclaimer.Flush();
+
+    auto run = [](Reclaimer* reclaimer) {
+        int64_t live_bytes;
+        std::thread([&] {
+            Interpreter interpreter;
+            interpreter.SetReclaimer(reclaimer, 100);
+            interpreter.Run("(+ 1 2)");
+            live_bytes = interpreter.GetAllocationStats().total.live_bytes;
+        }).join();
+        return live_bytes;
+    };
+    REQUIRE(run(&reclaimer) == run(nullptr));
+}
@@ -0,0 +1,128 @@
+#include <catch.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <error.h>
+#include <result_cache.h>
+#include <scheme.h>
+
+TEST_CASE("Result cache serves repeated expressions") {
+    ResultCache cache(1 << 20);
+    Interpreter interpreter;
+    interpreter.SetResultCache(&cache);
+
+    REQUIRE(interpreter.Run("(+ 1 (* 2 3))") == "7");
+    REQUIRE(interpreter.Run("(+   1\n(* 2 +3) )") == "7");
+    REQUIRE(interpreter.Run("(+ 1 (* 2 4))") == "9");
+    REQUIRE(interpreter.Run("'(1 . (2 3))") == "(1 2 3)");
+    REQUIRE(interpreter.Run("' ( 1 . ( 2 3 ) )") == "(1 2 3)");
+
+    auto stats = cache.GetStats();
+    REQUIRE(stats.hits == 2);
+    REQUIRE(stats.misses == 3);
+    REQUIRE(stats.insertions == 3);
+    REQUIRE(stats.entries == 3);
+
+    // Tokens stay apart: 1 2 is not 12.
+    REQUIRE(interpreter.Run("(+ 12)") == "12");
+    REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+}
+
+TEST_CASE("Result cache skips failures") {
+    ResultCache cache(1 << 20);
+    Interpreter interpreter;
+    interpreter.SetResultCache(&cache);
+
+    for (int i = 0; i < 2; ++i) {
+        REQUIRE_THROWS_AS(interpreter.Run("(car 1)"), RuntimeError);
+        REQUIRE_THROWS_AS(interpreter.Run("(+ 1"), SyntaxError);
+        REQUIRE_FALSE(interpreter.TryRun("(+ 99999999999 1)"));
+    }
+    auto stats = cache.GetStats();
+    REQUIRE(stats.hits == 0);
+    REQUIRE(stats.entries == 0);
+
+    const std::string_view inputs[] = {"(+ 1 2)", "(car 1)", "(+ 1 2)"};
+    const BatchResult& result = interpreter.RunBatch(inputs);
+    REQUIRE(result.Get(0) == "3");
+    REQUIRE(result.items[1].status == BatchStatus::kRuntimeError);
+    REQUIRE(result.Get(2) == "3");
+    REQUIRE(cache.GetStats().hits == 1);
+}
+
+TEST_CASE("Result cache hits are cancelled too") {
+    ResultCache cache(1 << 20);
+    Interpreter interpreter;
+    CancellationToken token;
+    interpreter.SetResultCache(&cache);
+    interpreter.SetCancellationToken(&token);
+
+    REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+    token.Cancel();
+    REQUIRE_THROWS_AS(interpreter.Run("(+ 1 2)"), LimitError);
+    token.Reset();
+    REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+    REQUIRE(cache.GetStats().hits == 1);
+}
+
+TEST_CASE("Result cache evicts least recently used") {
+    ResultCache cache(4 << 10, 1);
+    Interpreter interpreter;
+    interpreter.SetResultCache(&cache);
+
+    REQUIRE(interpreter.Run("(+ 0 0)") == "0");
+    for (int i = 1; i < 100; ++i) {
+        std::string number = std::to_string(i);
+        REQUIRE(interpreter.Run("(+ " + number + " 0)") == number);
+        // Keeps the first entry recently used.
+        REQUIRE(interpreter.Run("(+ 0 0)") == "0");
+    }
+
+    auto stats = cache.GetStats();
+    REQUIRE(stats.evictions > 0);
+    REQUIRE(stats.bytes <= 4 << 10);
+    REQUIRE(stats.hits == 99);
+    REQUIRE(stats.entries + stats.evictions == stats.insertions);
+
+    // Larger than the whole budget, so not stored.
+    std::string big = "'(";
+    for (int i = 0; i < 2000; ++i) {
+        big += "1 ";
+    }
+    big += ')';
+    interpreter.Run(big);
+    interpreter.Run(big);
+    REQUIRE(cache.GetStats().hits == 99);
+
+    cache.Clear();
+    REQUIRE(cache.GetStats().entries == 0);
+    REQUIRE(cache.GetStats().bytes == 0);
+}
+
+TEST_CASE("Result cache is shared between threads") {
+    ResultCache cache(1 << 20);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache] {
+            Interpreter interpreter;
+            interpreter.SetResultCache(&cache);
+            for (int i = 0; i < 1000; ++i) {
+                int value = i % 50;
+                if (interpreter.Run("(+ " + std::to_string(value) + " 1)") !=
+                    std::to_string(value + 1)) {
+                    throw std::logic_error("Wrong result");
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto stats = cache.GetStats();
+    REQUIRE(stats.entries == 50);
+    REQUIRE(stats.hits + stats.misses == 4000);
+    REQUIRE(stats.hits >= 4000 - 4 * 50);
+}
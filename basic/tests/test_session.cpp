@@ -0,0 +1,32 @@
+#include <catch.hpp>
+
+#include <error.h>
+#include <scheme.h>
+
+TEST_CASE("Session reuses the reader") {
+    Interpreter interpreter;
+    REQUIRE(interpreter.RunInPlace("(+ 1 2)") == "3");
+    REQUIRE(interpreter.RunInPlace("'(1 2 3)") == "(1 2 3)");
+    REQUIRE_THROWS_AS(interpreter.RunInPlace("(1 2"), SyntaxError);
+    REQUIRE(interpreter.RunInPlace("(list-ref '(4 5 6) 2)") == "6");
+    REQUIRE(interpreter.Run("(cons 1 (cons 2 '()))") == "(1 2)");
+}
+
+TEST_CASE("Batch keeps going after errors") {
+    const std::vector<std::string_view> requests = {"(+ 1 2)", "(1 2", "(car 1)", "'(1 #t)", ""};
+
+    Interpreter interpreter;
+    const BatchResult& result = interpreter.RunBatch(requests);
+    REQUIRE(result.items.size() == 5);
+    REQUIRE(result.items[0].status == BatchStatus::kOk);
+    REQUIRE(result.Get(0) == "3");
+    REQUIRE(result.items[1].status == BatchStatus::kSyntaxError);
+    REQUIRE(result.items[2].status == BatchStatus::kRuntimeError);
+    REQUIRE(result.items[3].status == BatchStatus::kOk);
+    REQUIRE(result.Get(3) == "(1 #t)");
+    REQUIRE(result.items[4].status == BatchStatus::kSyntaxError);
+    REQUIRE(result.items[2].offset == result.items[1].offset + result.items[1].size);
+
+    REQUIRE(interpreter.RunBatch(std::span(requests).first(1)).Get(0) == "3");
+    REQUIRE(interpreter.RunBatch({}).items.empty());
+}
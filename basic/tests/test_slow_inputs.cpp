@@ -0,0 +1,75 @@
+#include <catch.hpp>
+
+#include <string>
+
+#include <fuzzer.h>
+#include <scheme.h>
+
+TEST_CASE("Lookahead for a dot skips any whitespace") {
+    Interpreter interpreter;
+    REQUIRE(interpreter.Run("'(1\t. 2)") == "(1 . 2)");
+    REQUIRE(interpreter.Run("'(1\n.\n2)") == "(1 . 2)");
+    REQUIRE(interpreter.Run("(+ 1\r\n2\t3)") == "6");
+    REQUIRE(interpreter.Run("'(a @ . b)") == "(a . b)");
+}
+
+TEST_CASE("Long lists are read in constant stack") {
+    static constexpr int kLength = 1'000'000;
+    std::string sum = "(+";
+    std::string quoted = "'(";
+    for (int i = 0; i < kLength; ++i) {
+        sum += " 1";
+        quoted += " x";
+    }
+    sum += ')';
+    quoted += " . y)";
+
+    Interpreter interpreter;
+    REQUIRE(interpreter.Run(sum) == std::to_string(kLength));
+    std::string printed = interpreter.Run(quoted);
+    REQUIRE(printed.size() == 2 * kLength + 5);
+    REQUIRE(printed.ends_with("x x . y)"));
+}
+
+TEST_CASE("Interpreter counts the steps of the last run") {
+    Interpreter interpreter;
+    interpreter.Run("(+ 1 (* 2 3) (- 4 (abs -1)))");
+    REQUIRE(interpreter.GetLastRunSteps() == 4);
+    interpreter.Run("42");
+    REQUIRE(interpreter.GetLastRunSteps() == 0);
+
+    interpreter.SetLimits({.max_steps = 100});
+    std::string chain = "1";
+    for (int i = 0; i < 200; ++i) {
+        chain = "(+ 1 " + chain + ")";
+    }
+    REQUIRE_FALSE(interpreter.TryRun(chain));
+    REQUIRE(interpreter.GetLastRunSteps() == 100);
+}
+
+TEST_CASE("Generated inputs cost linearly in their size") {
+    GrammarFuzzer fuzzer;
+    Interpreter interpreter;
+    interpreter.SetLimits({.max_steps = 10'000'000, .max_depth = 4096});
+    auto measure = [&interpreter](const std::string& input) {
+        interpreter.TryRun(input);
+        return std::pair(interpreter.GetLastRunSteps(),
+                         interpreter.GetLastRunAllocationStats().total.peak_bytes);
+    };
+
+    for (size_t shape = 0; shape < GrammarFuzzer::kShapeCount; ++shape) {
+        for (uint64_t seed = 0; seed < 8; ++seed) {
+            std::string small =
+                fuzzer.Generate(static_cast<GrammarFuzzer::Shape>(shape), seed, 256);
+            std::string large =
+                fuzzer.Generate(static_cast<GrammarFuzzer::Shape>(shape), seed, 1024);
+            INFO(GrammarFuzzer::GetShapeName(static_cast<GrammarFuzzer::Shape>(shape))
+                 << " seed " << seed);
+            auto [small_steps, small_peak] = measure(small);
+            auto [large_steps, large_peak] = measure(large);
+            double growth = 2.0 * large.size() / small.size();
+            REQUIRE(large_steps <= growth * small_steps + 64);
+            REQUIRE(large_peak <= growth * small_peak + 4096);
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#include <catch.hpp>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <data_loader.h>
+#include <scheme.h>
+#include <spsc_queue.h>
+
+TEST_CASE("SPSC queue hands values over in order") {
+    SpscQueue<int> queue(3);
+    REQUIRE(queue.GetCapacity() == 4);
+    int value;
+    REQUIRE_FALSE(queue.TryPop(&value));
+    for (int i = 0; i < 4; ++i) {
+        queue.Push(i);
+    }
+    REQUIRE(queue.TryPop(&value));
+    REQUIRE(value == 0);
+    queue.Push(4);
+    queue.Close();
+    for (int i = 1; i <= 4; ++i) {
+        REQUIRE(queue.Pop(&value));
+        REQUIRE(value == i);
+    }
+    REQUIRE_FALSE(queue.Pop(&value));
+    REQUIRE_FALSE(queue.TryPop(&value));
+}
+
+TEST_CASE("SPSC queue waits on both ends across threads") {
+    static constexpr int kCount = 200'000;
+    SpscQueue<std::unique_ptr<int>> queue(8);
+    std::thread producer([&queue] {
+        for (int i = 0; i < kCount; ++i) {
+            queue.Push(std::make_unique<int>(i));
+        }
+        queue.Close();
+    });
+
+    int expected = 0;
+    bool in_order = true;
+    for (std::unique_ptr<int> value; queue.Pop(&value); ++expected) {
+        in_order = in_order && *value == expected;
+    }
+    producer.join();
+    REQUIRE(in_order);
+    REQUIRE(expected == kCount);
+}
+
+TEST_CASE("Interpreter evaluates programs read on another thread") {
+    std::string source;
+    std::string expected;
+    for (int i = 0; i < 5000; ++i) {
+        source += "(+ " + std::to_string(i) + " 1) '(a " + std::to_string(i) + ")\n";
+        expected += std::to_string(i + 1) + " (a " + std::to_string(i) + ") ";
+    }
+    source += "(car '())";
+
+    SpscQueue<Ref<Object>> queue(64);
+    std::thread reader([&] {
+        DataLoader loader(source, nullptr);
+        for (Ref<Object> form; loader.Next(&form);) {
+            queue.Push(std::move(form));
+        }
+        queue.Close();
+    });
+
+    Interpreter interpreter;
+    std::string printed;
+    std::vector<Error> errors;
+    for (Ref<Object> form; queue.Pop(&form);) {
+        auto result = interpreter.TryRunProgram(std::move(form));
+        if (result) {
+            printed += *result;
+            printed += ' ';
+        } else {
+            errors.push_back(result.GetError());
+        }
+    }
+    reader.join();
+    REQUIRE(printed == expected);
+    REQUIRE(errors.size() == 1);
+    REQUIRE(errors[0].kind == ErrorKind::kRuntime);
+}
+
+TEST_CASE("Programs run in place respect the limits and the heap") {
+    Interpreter interpreter;
+    interpreter.EnableGc();
+    Session session;
+    session.Reset("(+ (* 3 4) (max 1 2))");
+    REQUIRE(*interpreter.TryRunProgram(*TryRead(session.GetTokenizer())) == "14");
+
+    interpreter.SetLimits({.max_steps = 2});
+    session.Reset("(+ 1 (+ 2 (+ 3 4)))");
+    auto result = interpreter.TryRunProgram(*TryRead(session.GetTokenizer()));
+    REQUIRE_FALSE(result);
+    REQUIRE(result.GetError().kind == ErrorKind::kLimit);
+    REQUIRE(interpreter.GetLastRunSteps() == 2);
+}
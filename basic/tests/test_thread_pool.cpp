@@ -0,0 +1,79 @@
+#include <catch.hpp>
+
+#include <atomic>
+#include <latch>
+#include <string>
+#include <vector>
+
+#include <scheme.h>
+#include <thread_pool.h>
+
+TEST_CASE("Pool runs every task") {
+    std::atomic<int> sum = 0;
+    {
+        WorkStealingPool pool(4);
+        REQUIRE(pool.GetThreadCount() == 4);
+        for (int i = 1; i <= 1000; ++i) {
+            pool.Submit([&sum, i] { sum += i; });
+        }
+    }
+    REQUIRE(sum == 500500);
+    REQUIRE(WorkStealingPool::CurrentWorker() == -1);
+}
+
+TEST_CASE("Tasks submitted by a worker get stolen") {
+    WorkStealingPool pool(4);
+    std::latch done(257);
+    std::vector<int> workers(256, -1);
+    pool.Submit([&] {
+        for (int i = 0; i < 256; ++i) {
+            pool.Submit([&, i] {
+                workers[i] = WorkStealingPool::CurrentWorker();
+                done.count_down();
+            });
+        }
+        done.count_down();
+    });
+    done.wait();
+    for (int worker : workers) {
+        REQUIRE(worker >= 0);
+        REQUIRE(worker < 4);
+    }
+}
+
+TEST_CASE("Workers of one pool submit to another") {
+    WorkStealingPool small(1);
+    std::atomic<int> sum = 0;
+    std::latch done(64);
+    {
+        WorkStealingPool large(8);
+        for (int i = 1; i <= 64; ++i) {
+            large.Submit([&, i] {
+                small.Submit([&, i] {
+                    sum += i;
+                    done.count_down();
+                });
+            });
+        }
+    }
+    done.wait();
+    REQUIRE(sum == 2080);
+}
+
+TEST_CASE("Interpreter per worker") {
+    constexpr int kRequests = 2000;
+    std::vector<std::string> results(kRequests);
+    {
+        WorkStealingPool pool(4);
+        for (int i = 0; i < kRequests; ++i) {
+            pool.Submit([&results, i] {
+                thread_local Interpreter interpreter;
+                std::string request = "(+ " + std::to_string(i) + " (car '(1 2)))";
+                results[i] = interpreter.RunInPlace(request);
+            });
+        }
+    }
+    for (int i = 0; i < kRequests; ++i) {
+        REQUIRE(results[i] == std::to_string(i + 1));
+    }
+}
@@ -0,0 +1,77 @@
+#include <catch.hpp>
+
+#include <string>
+
+#include <scheme.h>
+#include <trace.h>
+
+namespace {
+size_t Count(const std::string& text, const std::string& pattern) {
+    size_t count = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos;
+         pos = text.find(pattern, pos + 1)) {
+        ++count;
+    }
+    return count;
+}
+}  // namespace
+
+TEST_CASE("Tracer records calls and phases of a run") {
+    Tracer tracer;
+    Interpreter interpreter;
+    interpreter.SetTracer(&tracer);
+    REQUIRE(interpreter.Run("(+ 1 (* 2 3) (- 5 4))") == "8");
+
+    // run, read, evaluate, print and three calls.
+    REQUIRE(tracer.GetEventCount() == 14);
+    REQUIRE(tracer.GetDroppedCount() == 0);
+    std::string json = tracer.ToChromeJson();
+    REQUIRE(json.rfind("{\"traceEvents\": [", 0) == 0);
+    REQUIRE(Count(json, "\"ph\": \"B\"") == 7);
+    REQUIRE(Count(json, "\"ph\": \"E\"") == 7);
+    REQUIRE(Count(json, "\"cat\": \"phase\"") == 8);
+    REQUIRE(json.find("{\"name\": \"*\", \"cat\": \"call\", \"ph\": \"B\"") != std::string::npos);
+    REQUIRE(json.find("\"args\": {\"offset\": 6}") != std::string::npos);
+    REQUIRE(json.find("\"dropped_events\": 0") != std::string::npos);
+
+    interpreter.SetTracer(nullptr);
+    interpreter.Run("(+ 1 2)");
+    REQUIRE(tracer.GetEventCount() == 14);
+
+    tracer.Clear();
+    REQUIRE(tracer.GetEventCount() == 0);
+    interpreter.SetTracer(&tracer);
+    REQUIRE_THROWS(interpreter.Run("(+ 1 (car 2))"));
+    REQUIRE(Count(tracer.ToChromeJson(), "\"ph\": \"B\"") ==
+            Count(tracer.ToChromeJson(), "\"ph\": \"E\""));
+}
+
+TEST_CASE("Tracer keeps the latest events when the buffer wraps") {
+    std::string program = "1";
+    for (int i = 0; i < 100; ++i) {
+        program = "(+ " + program + " 1)";
+    }
+
+    Tracer tracer(64);
+    Interpreter interpreter;
+    interpreter.SetTracer(&tracer);
+    REQUIRE(interpreter.Run(program) == "101");
+    REQUIRE(tracer.GetEventCount() == 64);
+    REQUIRE(tracer.GetDroppedCount() == 2 * 104 - 64);
+
+    // Ends of overwritten begins are left out, so the trace stays balanced.
+    std::string json = tracer.ToChromeJson();
+    REQUIRE(Count(json, "\"ph\": \"B\"") == Count(json, "\"ph\": \"E\""));
+    REQUIRE(json.find("\"name\": \"print\"") != std::string::npos);
+}
+
+TEST_CASE("Tracing and profiling can be on together") {
+    Tracer tracer;
+    Interpreter interpreter;
+    interpreter.EnableProfiling();
+    interpreter.SetTracer(&tracer);
+    REQUIRE(interpreter.Run("(list 1 2)") == "(1 2)");
+    interpreter.DisableProfiling();
+    REQUIRE(interpreter.Run("(list 1 2)") == "(1 2)");
+    REQUIRE(tracer.GetEventCount() == 20);
+}
@@ -0,0 +1,63 @@
+#include <catch.hpp>
+
+#include <error.h>
+#include <scheme.h>
+
+TEST_CASE("TryRun returns the result") {
+    Interpreter interpreter;
+    auto result = interpreter.TryRun("(+ 1 2)");
+    REQUIRE(result.HasValue());
+    REQUIRE(*result == "3");
+}
+
+TEST_CASE("TryRun reports syntax errors") {
+    Interpreter interpreter;
+
+    auto unclosed = interpreter.TryRun("(+ 1 2");
+    REQUIRE_FALSE(unclosed);
+    REQUIRE(unclosed.GetError().kind == ErrorKind::kSyntax);
+    REQUIRE(unclosed.GetError().offset == 6);
+
+    auto extra = interpreter.TryRun("(+ 1 2) )");
+    REQUIRE_FALSE(extra);
+    REQUIRE(extra.GetError().kind == ErrorKind::kSyntax);
+    REQUIRE(extra.GetError().offset == 8);
+
+    auto huge = interpreter.TryRun("(+ 1 99999999999)");
+    REQUIRE_FALSE(huge);
+    REQUIRE(huge.GetError().kind == ErrorKind::kSyntax);
+    REQUIRE(huge.GetError().message == "Number is out of range");
+    REQUIRE(huge.GetError().offset == 5);
+
+    REQUIRE_THROWS_AS(interpreter.Run("(+ 1 99999999999)"), SyntaxError);
+    REQUIRE_THROWS_AS(interpreter.Run("5 99999999999"), SyntaxError);
+}
+
+TEST_CASE("TryRun reports runtime errors at the failed call") {
+    Interpreter interpreter;
+
+    auto error = interpreter.TryRun("(+ 1 (car 5))");
+    REQUIRE_FALSE(error);
+    REQUIRE(error.GetError().kind == ErrorKind::kRuntime);
+    REQUIRE(error.GetError().message == "Invalid call for car");
+    REQUIRE(error.GetError().offset == 6);
+
+    auto nested = interpreter.TryRun("(cons (+ 1 2) (- 3 #t))");
+    REQUIRE_FALSE(nested);
+    REQUIRE(nested.GetError().offset == 15);
+
+    auto no_command = interpreter.TryRun("()");
+    REQUIRE_FALSE(no_command);
+    REQUIRE(no_command.GetError().kind == ErrorKind::kRuntime);
+
+    REQUIRE(*interpreter.TryRun("(car '(1 2))") == "1");
+}
+
+TEST_CASE("Helpers still throw") {
+    Interpreter interpreter;
+    std::stringstream ss{"(1 #t)"};
+    Tokenizer tokenizer{&ss};
+    auto head = Read(&tokenizer);
+    REQUIRE_THROWS_AS(interpreter.ToIntVector(head), RuntimeError);
+    REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+}
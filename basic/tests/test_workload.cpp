@@ -0,0 +1,136 @@
+#include <catch.hpp>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <scheme.h>
+#include <workload.h>
+
+namespace {
+std::vector<WorkloadRecord> ReadAll(WorkloadReader* reader) {
+    std::vector<WorkloadRecord> records;
+    for (WorkloadRecord record; reader->Next(&record);) {
+        records.push_back(record);
+    }
+    return records;
+}
+}  // namespace
+
+TEST_CASE("Interpreter records runs into a workload log") {
+    std::string path = "test_workload_runs.log";
+    {
+        auto recorder = WorkloadRecorder::Open(path);
+        REQUIRE(recorder);
+        Interpreter interpreter;
+        interpreter.SetWorkloadRecorder(recorder->get());
+        REQUIRE(interpreter.Run("(+ 1 2)") == "3");
+        REQUIRE_FALSE(interpreter.TryRun("(car '())"));
+        std::vector<std::string_view> inputs = {"(list 1 2)", "(", "(+ 1 #t)"};
+        interpreter.RunBatch(inputs);
+        interpreter.SetWorkloadRecorder(nullptr);
+        interpreter.Run("(+ 3 4)");
+        REQUIRE((*recorder)->GetRecordCount() == 5);
+    }
+
+    auto reader = WorkloadReader::Open(path);
+    REQUIRE(reader);
+    std::vector<WorkloadRecord> records = ReadAll(&*reader);
+    REQUIRE(records.size() == 5);
+
+    REQUIRE(records[0].input == "(+ 1 2)");
+    REQUIRE(records[0].output == "3");
+    REQUIRE_FALSE(records[0].failed);
+    REQUIRE(records[1].input == "(car '())");
+    REQUIRE(records[1].failed);
+    REQUIRE(records[1].error_kind == ErrorKind::kRuntime);
+    REQUIRE_FALSE(records[1].output.empty());
+    REQUIRE(records[2].output == "(1 2)");
+    REQUIRE(records[3].error_kind == ErrorKind::kSyntax);
+    REQUIRE(records[4].error_kind == ErrorKind::kRuntime);
+    for (size_t i = 1; i < records.size(); ++i) {
+        REQUIRE(records[i].start >= records[i - 1].start + records[i - 1].duration);
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Workload logs read up to a truncated record") {
+    std::string path = "test_workload_truncated.log";
+    {
+        auto recorder = WorkloadRecorder::Open(path);
+        REQUIRE(recorder);
+        for (int i = 0; i < 3; ++i) {
+            (*recorder)->Append({.input = "(+ 1 1)", .output = std::to_string(i)});
+        }
+    }
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+
+    auto reader = WorkloadReader::Open(path);
+    REQUIRE(reader);
+    std::vector<WorkloadRecord> records = ReadAll(&*reader);
+    REQUIRE(records.size() == 2);
+    REQUIRE(records[1].output == "1");
+
+    std::ofstream(path) << "(+ 1 2)\n";
+    REQUIRE_FALSE(WorkloadReader::Open(path));
+    std::remove(path.c_str());
+    REQUIRE_FALSE(WorkloadReader::Open(path));
+}
+
+TEST_CASE("Workload recorder drops runs past its size limit") {
+    std::string path = "test_workload_limit.log";
+    {
+        auto recorder = WorkloadRecorder::Open(path, {.max_bytes = 100});
+        REQUIRE(recorder);
+        for (int i = 0; i < 10; ++i) {
+            (*recorder)->Append({.input = "(+ 1 2 3 4 5 6 7 8 9 10)", .output = "55"});
+        }
+        REQUIRE((*recorder)->GetRecordCount() == 3);
+        REQUIRE((*recorder)->GetDroppedCount() == 7);
+    }
+    auto reader = WorkloadReader::Open(path);
+    REQUIRE(reader);
+    REQUIRE(ReadAll(&*reader).size() == 3);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Workload recorder is shared between threads") {
+    static constexpr int kThreads = 4;
+    static constexpr int kRuns = 300;
+    std::string path = "test_workload_threads.log";
+    {
+        auto recorder = WorkloadRecorder::Open(path, {.buffer_bytes = 512});
+        REQUIRE(recorder);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t) {
+            threads.emplace_back([t, recorder = recorder->get()] {
+                Interpreter interpreter;
+                interpreter.SetWorkloadRecorder(recorder);
+                for (int i = 0; i < kRuns; ++i) {
+                    interpreter.TryRun("(+ " + std::to_string(t) + ' ' + std::to_string(i) + ')');
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    auto reader = WorkloadReader::Open(path);
+    REQUIRE(reader);
+    std::set<std::string> inputs;
+    size_t mismatches = 0;
+    for (const WorkloadRecord& record : ReadAll(&*reader)) {
+        inputs.emplace(record.input);
+        Interpreter interpreter;
+        mismatches += interpreter.Run(std::string(record.input)) != record.output;
+    }
+    REQUIRE(inputs.size() == kThreads * kRuns);
+    REQUIRE(mismatches == 0);
+    std::remove(path.c_str());
+}
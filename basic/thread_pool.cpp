@@ -0,0 +1,97 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace {
+// The pool the calling thread works for, and its index there.
+thread_local const WorkStealingPool* current_pool = nullptr;
+thread_local int current_worker = -1;
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(size_t thread_count) {
+    thread_count = std::max<size_t>(thread_count, 1);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads_.emplace_back([this, i] { Work(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard lock(sleep_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::Submit(Task task) {
+    size_t index = current_pool == this ? current_worker
+                                        : next_worker_.fetch_add(1, std::memory_order_relaxed) %
+                                              workers_.size();
+    // Counted before the task is visible, so the worker that takes it cannot count it off first.
+    pending_.fetch_add(1, std::memory_order_release);
+    {
+        std::lock_guard lock(workers_[index]->mutex);
+        workers_[index]->tasks.push_back(std::move(task));
+    }
+    {
+        // Pairs with the predicate check in Work, so the notification cannot be lost.
+        std::lock_guard lock(sleep_mutex_);
+    }
+    wake_.notify_one();
+}
+
+size_t WorkStealingPool::GetThreadCount() const {
+    return threads_.size();
+}
+
+int WorkStealingPool::CurrentWorker() {
+    return current_worker;
+}
+
+bool WorkStealingPool::TryTake(size_t index, Task* task) {
+    {
+        Worker& own = *workers_[index];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            *task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t shift = 1; shift < workers_.size(); ++shift) {
+        Worker& victim = *workers_[(index + shift) % workers_.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            *task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::Work(size_t index) {
+    current_pool = this;
+    current_worker = static_cast<int>(index);
+    Task task;
+    while (true) {
+        if (TryTake(index, &task)) {
+            pending_.fetch_sub(1, std::memory_order_acq_rel);
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock lock(sleep_mutex_);
+        wake_.wait(lock, [this] { return stop_ || pending_.load(std::memory_order_acquire) > 0; });
+        if (stop_ && pending_.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
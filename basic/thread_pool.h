@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads with a task deque each. A worker takes tasks from the back of its
+// own deque and, once it runs dry, steals from the front of the others. Tasks submitted from
+// outside the pool, worker threads of other pools included, are spread round-robin; tasks
+// submitted by one of its workers go to that worker's deque.
+//
+// Tasks must not throw. The destructor runs every task submitted so far before joining.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(size_t thread_count = std::thread::hardware_concurrency());
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void Submit(Task task);
+
+    size_t GetThreadCount() const;
+
+    // Index of the calling worker, or -1 when called from outside a pool.
+    static int CurrentWorker();
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool TryTake(size_t index, Task* task);
+    void Work(size_t index);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> next_worker_ = 0;
+    std::atomic<size_t> pending_ = 0;
+
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+};
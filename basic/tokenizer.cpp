@@ -1,34 +1,51 @@
 #include <tokenizer.h>
 
-#include <set>
+#include <array>
+#include <charconv>
+#include <cstdint>
 #include <stdexcept>
-#include <cctype>
 #include <string>
-
-const static std::set<char> kSymbols = {'<', '=', '>', '*', '/', '#', '?', '!', '+', '-'};
+#include <string_view>
 
 namespace {
-bool IsSymbolPart(const char ch) {
-    if (kSymbols.find(ch) != kSymbols.end() && ch != '+') {
-        return true;
+// Character classes for the reader, looked up once per character.
+enum CharClass : uint8_t { kDigit = 1, kAlpha = 2, kSymbolBegin = 4, kSymbolPart = 8 };
+
+constexpr std::array<uint8_t, 256> MakeCharClasses() {
+    std::array<uint8_t, 256> classes{};
+    for (int ch = '0'; ch <= '9'; ++ch) {
+        classes[ch] = kDigit | kSymbolPart;
     }
-    if (isdigit(ch)) {
-        return true;
+    for (int ch = 'a'; ch <= 'z'; ++ch) {
+        classes[ch] = classes[ch - 'a' + 'A'] = kAlpha | kSymbolBegin | kSymbolPart;
     }
-    if (isalpha(ch)) {
-        return true;
+    for (unsigned char ch : std::string_view("<=>*/#?!+-")) {
+        if (ch != '?' && ch != '!') {
+            classes[ch] |= kSymbolBegin;
+        }
+        if (ch != '+') {
+            classes[ch] |= kSymbolPart;
+        }
     }
-    return false;
+    return classes;
 }
 
-bool IsSymbolBegin(const char ch) {
-    if (kSymbols.find(ch) != kSymbols.end() && ch != '?' && ch != '!') {
-        return true;
-    }
-    if (isalpha(ch)) {
-        return true;
-    }
-    return false;
+constexpr std::array<uint8_t, 256> kCharClasses = MakeCharClasses();
+
+bool HasClass(const int ch, const uint8_t char_class) {
+    return ch != EOF && (kCharClasses[static_cast<unsigned char>(ch)] & char_class);
+}
+
+bool IsDigit(const int ch) {
+    return HasClass(ch, kDigit);
+}
+
+bool IsSymbolPart(const int ch) {
+    return HasClass(ch, kSymbolPart);
+}
+
+bool IsSymbolBegin(const int ch) {
+    return HasClass(ch, kSymbolBegin);
 }
 }  // namespace
 
@@ -56,6 +73,15 @@ Tokenizer::Tokenizer(std::istream *in) : input_(in) {
     Next();
 }
 
+void Tokenizer::Reset() {
+    has_token_ = false;
+    is_end_ = false;
+    error_ = nullptr;
+    position_ = 0;
+    token_offset_ = 0;
+    Next();
+}
+
 bool Tokenizer::IsEnd() {
     return is_end_;
 }
@@ -67,9 +93,27 @@ Token Tokenizer::GetToken() {
     throw std::runtime_error("No token inside");
 }
 
+const Token* Tokenizer::TryGetToken() const {
+    return has_token_ ? &current_ : nullptr;
+}
+
+size_t Tokenizer::GetOffset() const {
+    return token_offset_;
+}
+
+const char* Tokenizer::GetError() const {
+    return error_;
+}
+
+// The reader goes straight to the stream buffer: istream::peek and get build a sentry per call.
 void Tokenizer::Next() {
-    while (input_->peek() != EOF) {
-        char cur_ch = input_->get();
+    std::streambuf* buffer = input_->rdbuf();
+    if (error_ != nullptr) {
+        return;
+    }
+    while (buffer->sgetc() != EOF) {
+        token_offset_ = position_++;
+        char cur_ch = buffer->sbumpc();
         if (cur_ch == '(') {
             current_ = BracketToken::OPEN;
             has_token_ = true;
@@ -86,17 +130,32 @@ void Tokenizer::Next() {
             current_ = DotToken();
             has_token_ = true;
             return;
-        } else if ((cur_ch == '+' && isdigit(input_->peek())) ||
-                   (cur_ch == '-' && isdigit(input_->peek())) || isdigit(cur_ch)) {
-            std::string str_number;
-            str_number += cur_ch;
-
-            while (isdigit(input_->peek())) {
-                cur_ch = input_->get();
-                str_number += cur_ch;
+        } else if ((cur_ch == '+' && IsDigit(buffer->sgetc())) ||
+                   (cur_ch == '-' && IsDigit(buffer->sgetc())) || IsDigit(cur_ch)) {
+            char digits[16];
+            size_t length = 0;
+            bool overflow = false;
+            if (cur_ch != '+') {
+                digits[length++] = cur_ch;
             }
 
-            int number = std::stoi(str_number);
+            while (IsDigit(buffer->sgetc())) {
+                ++position_;
+                cur_ch = buffer->sbumpc();
+                if (length < sizeof(digits)) {
+                    digits[length++] = cur_ch;
+                } else {
+                    overflow = true;
+                }
+            }
+
+            int number = 0;
+            auto [end, error] = std::from_chars(digits, digits + length, number);
+            if (overflow || error != std::errc()) {
+                error_ = "Number is out of range";
+                has_token_ = false;
+                break;
+            }
 
             current_ = ConstantToken{number};
             has_token_ = true;
@@ -105,8 +164,9 @@ void Tokenizer::Next() {
             std::string symbol;
             symbol += cur_ch;
 
-            while (IsSymbolPart(input_->peek())) {
-                cur_ch = input_->get();
+            while (IsSymbolPart(buffer->sgetc())) {
+                ++position_;
+                cur_ch = buffer->sbumpc();
                 symbol += cur_ch;
             }
 
@@ -125,12 +185,16 @@ void Tokenizer::Next() {
             return;
         }
     }
+    if (error_ == nullptr) {
+        token_offset_ = position_;
+    }
     is_end_ = true;
 }
 
 bool Tokenizer::NextIsDot() {
-    while (input_->peek() != EOF) {
-        char cur_ch = input_->peek();
+    std::streambuf* buffer = input_->rdbuf();
+    while (buffer->sgetc() != EOF) {
+        char cur_ch = buffer->sgetc();
         if (cur_ch == '(') {
             return false;
         } else if (cur_ch == ')') {
@@ -139,13 +203,15 @@ bool Tokenizer::NextIsDot() {
             return false;
         } else if (cur_ch == '.') {
             return true;
-        } else if ((cur_ch == '+' && isdigit(input_->peek())) ||
-                   (cur_ch == '-' && isdigit(input_->peek())) || isdigit(cur_ch)) {
+        } else if ((cur_ch == '+' && IsDigit(buffer->sgetc())) ||
+                   (cur_ch == '-' && IsDigit(buffer->sgetc())) || IsDigit(cur_ch)) {
             return false;
         } else if (IsSymbolBegin(cur_ch)) {
             return false;
-        } else if (cur_ch == ' ') {
-            input_->get();
+        } else {
+            // Whitespace and anything else Next would skip; stopping at it would loop forever.
+            ++position_;
+            buffer->sbumpc();
         }
     }
     return false;
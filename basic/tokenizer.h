@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <string>
 #include <variant>
 #include <optional>
 #include <istream>
@@ -39,17 +41,32 @@ class Tokenizer {
 public:
     Tokenizer(std::istream* in);
 
+    // Starts over on whatever the stream holds now.
+    void Reset();
+
     bool IsEnd();
 
     void Next();
 
     Token GetToken();
 
+    // Non-throwing GetToken: the current token, or null when there is none.
+    const Token* TryGetToken() const;
+
+    // Offset of the current token from the start of the input.
+    size_t GetOffset() const;
+
+    // Set when the input cannot be tokenized; the tokenizer stops at the offending token.
+    const char* GetError() const;
+
     bool NextIsDot();
 
 private:
     bool has_token_ = false;
     bool is_end_ = false;
+    const char* error_ = nullptr;
+    size_t position_ = 0;
+    size_t token_offset_ = 0;
     Token current_;
     std::istream* input_ = nullptr;
 };
\ No newline at end of file
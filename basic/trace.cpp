@@ -0,0 +1,134 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+constexpr std::string_view kOtherNames = "(other)";
+constexpr const char* kCategoryNames[] = {"call", "phase"};
+
+void AppendJsonString(std::string_view value, std::string* out) {
+    *out += '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            *out += '\\';
+        }
+        *out += c;
+    }
+    *out += '"';
+}
+}  // namespace
+
+Tracer::Tracer(size_t capacity) : events_(std::max<size_t>(capacity, 1)) {
+    Clear();
+}
+
+void Tracer::Clear() {
+    first_ = 0;
+    size_ = 0;
+    dropped_ = 0;
+    open_.clear();
+    start_ = std::chrono::steady_clock::now();
+}
+
+void Tracer::Begin(std::string_view name, size_t source_offset, Category category) {
+    uint32_t id = GetNameId(name);
+    open_.push_back(id);
+    Push({.time = static_cast<uint64_t>((std::chrono::steady_clock::now() - start_).count()),
+          .name = id,
+          .source_offset = static_cast<uint32_t>(std::min<size_t>(source_offset, UINT32_MAX)),
+          .begin = true,
+          .category = category});
+}
+
+void Tracer::End() {
+    if (open_.empty()) {
+        return;
+    }
+    uint32_t id = open_.back();
+    open_.pop_back();
+    Push({.time = static_cast<uint64_t>((std::chrono::steady_clock::now() - start_).count()),
+          .name = id,
+          .source_offset = 0,
+          .begin = false,
+          .category = Category::kCall});
+}
+
+size_t Tracer::GetEventCount() const {
+    return size_;
+}
+
+uint64_t Tracer::GetDroppedCount() const {
+    return dropped_;
+}
+
+void Tracer::Push(const Event& event) {
+    if (size_ < events_.size()) {
+        events_[(first_ + size_++) % events_.size()] = event;
+        return;
+    }
+    events_[first_] = event;
+    first_ = (first_ + 1) % events_.size();
+    ++dropped_;
+}
+
+uint32_t Tracer::GetNameId(std::string_view name) {
+    if (auto it = name_ids_.find(name); it != name_ids_.end()) {
+        return it->second;
+    }
+    if (names_.size() + 1 >= kMaxNames) {
+        name = kOtherNames;
+        if (auto it = name_ids_.find(name); it != name_ids_.end()) {
+            return it->second;
+        }
+    }
+    uint32_t id = static_cast<uint32_t>(names_.size());
+    names_.emplace_back(name);
+    name_ids_.emplace(names_.back(), id);
+    return id;
+}
+
+std::string Tracer::ToChromeJson() const {
+    std::string out = "{\"traceEvents\": [";
+    bool first = true;
+    // End events take their category from the begin they match.
+    auto append = [this, &out, &first](const Event& event, const Event& begin) {
+        char line[128];
+        out += first ? "\n" : ",\n";
+        first = false;
+        out += "{\"name\": ";
+        AppendJsonString(names_[event.name], &out);
+        std::snprintf(line, sizeof(line),
+                      ", \"cat\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": 1",
+                      kCategoryNames[static_cast<int>(begin.category)], event.begin ? 'B' : 'E',
+                      event.time / 1e3);
+        out += line;
+        if (event.begin && event.category == Category::kCall) {
+            out += ", \"args\": {\"offset\": " + std::to_string(event.source_offset) + '}';
+        }
+        out += '}';
+    };
+
+    std::vector<const Event*> open;
+    uint64_t last_time = 0;
+    for (size_t i = 0; i < size_; ++i) {
+        const Event& event = events_[(first_ + i) % events_.size()];
+        last_time = event.time;
+        if (event.begin) {
+            append(event, event);
+            open.push_back(&event);
+        } else if (!open.empty()) {
+            append(event, *open.back());
+            open.pop_back();
+        }
+    }
+    for (; !open.empty(); open.pop_back()) {
+        Event end = *open.back();
+        end.time = last_time;
+        end.begin = false;
+        append(end, *open.back());
+    }
+
+    out += "\n], \"displayTimeUnit\": \"ns\", \"otherData\": {\"dropped_events\": ";
+    return out + std::to_string(dropped_) + "}}\n";
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Begin and end events of evaluation in a ring buffer allocated up front. When the buffer is
+// full the oldest events are overwritten, so a long run keeps its last part. Traces serialize to
+// the Chrome Trace Event format, which chrome://tracing and Perfetto open.
+//
+// An interpreter records into the tracer set with Interpreter::SetTracer, one call event per
+// builtin call and one phase event per phase of a run. Set it for the requests to be traced only;
+// without a tracer evaluation pays a single branch.
+class Tracer {
+public:
+    enum class Category : uint8_t { kCall, kPhase };
+
+    explicit Tracer(size_t capacity = 1 << 16);
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // Drops the events and restarts the clock, keeping the buffer and the names.
+    void Clear();
+
+    void Begin(std::string_view name, size_t source_offset, Category category = Category::kCall);
+    void End();
+
+    size_t GetEventCount() const;
+    uint64_t GetDroppedCount() const;
+
+    // Timestamps are in microseconds since the last Clear. End events whose begin was
+    // overwritten are left out, and calls still open are closed at the last event.
+    std::string ToChromeJson() const;
+
+private:
+    // Past this many distinct names, calls are recorded under one.
+    static constexpr size_t kMaxNames = 256;
+
+    struct Event {
+        uint64_t time;
+        uint32_t name;
+        uint32_t source_offset;
+        bool begin;
+        Category category;
+    };
+
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const {
+            return std::hash<std::string_view>()(name);
+        }
+    };
+
+    uint32_t GetNameId(std::string_view name);
+    void Push(const Event& event);
+
+    std::vector<Event> events_;
+    // Index of the oldest event and number of events held.
+    size_t first_ = 0;
+    size_t size_ = 0;
+    uint64_t dropped_ = 0;
+    std::vector<uint32_t> open_;
+    std::chrono::steady_clock::time_point start_;
+
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, uint32_t, NameHash, std::equal_to<>> name_ids_;
+};
+
+// Brackets a phase of a run with events; does nothing without a tracer.
+class TraceScope {
+public:
+    TraceScope(Tracer* tracer, std::string_view name) : tracer_(tracer) {
+        if (tracer_ != nullptr) {
+            tracer_->Begin(name, 0, Tracer::Category::kPhase);
+        }
+    }
+
+    ~TraceScope() {
+        if (tracer_ != nullptr) {
+            tracer_->End();
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    Tracer* tracer_;
+};
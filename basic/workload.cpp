@@ -0,0 +1,154 @@
+#include "workload.h"
+
+#include <cerrno>
+#include <cstring>
+
+namespace {
+constexpr std::string_view kMagic = "SCWL";
+constexpr char kVersion = 1;
+// Status byte of a record: zero for success, one plus the error kind for a failure.
+constexpr uint8_t kOk = 0;
+
+void AppendVarint(uint64_t value, std::string* out) {
+    while (value >= 0x80) {
+        *out += static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    *out += static_cast<char>(value);
+}
+
+bool GetVarint(std::string_view bytes, size_t* offset, uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*offset >= bytes.size()) {
+            return false;
+        }
+        uint8_t byte = bytes[(*offset)++];
+        *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GetString(std::string_view bytes, size_t* offset, std::string_view* value) {
+    uint64_t size;
+    if (!GetVarint(bytes, offset, &size) || size > bytes.size() - *offset) {
+        return false;
+    }
+    *value = bytes.substr(*offset, size);
+    *offset += size;
+    return true;
+}
+}  // namespace
+
+Expected<std::unique_ptr<WorkloadRecorder>> WorkloadRecorder::Open(
+    const std::string& path, const WorkloadRecorderOptions& options) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return Error{ErrorKind::kRuntime, path + ": " + std::strerror(errno)};
+    }
+    std::unique_ptr<WorkloadRecorder> recorder(new WorkloadRecorder(file, options));
+    recorder->buffer_ = kMagic;
+    recorder->buffer_ += kVersion;
+    if (!recorder->Flush()) {
+        return Error{ErrorKind::kRuntime, path + ": " + std::strerror(errno)};
+    }
+    return recorder;
+}
+
+WorkloadRecorder::WorkloadRecorder(std::FILE* file, const WorkloadRecorderOptions& options)
+    : options_(options), start_(std::chrono::steady_clock::now()), file_(file) {
+    buffer_.reserve(options_.buffer_bytes);
+}
+
+WorkloadRecorder::~WorkloadRecorder() {
+    Flush();
+    std::fclose(file_);
+}
+
+void WorkloadRecorder::Append(const WorkloadRecord& record) {
+    std::lock_guard lock(mutex_);
+    size_t before = buffer_.size();
+    AppendVarint(record.start.count(), &buffer_);
+    AppendVarint(record.duration.count(), &buffer_);
+    buffer_ += static_cast<char>(record.failed ? 1 + static_cast<int>(record.error_kind) : kOk);
+    AppendVarint(record.input.size(), &buffer_);
+    buffer_ += record.input;
+    AppendVarint(record.output.size(), &buffer_);
+    buffer_ += record.output;
+    if (options_.max_bytes != 0 && size_ + buffer_.size() - before > options_.max_bytes) {
+        buffer_.resize(before);
+        ++dropped_;
+        return;
+    }
+    size_ += buffer_.size() - before;
+    ++records_;
+    if (buffer_.size() >= options_.buffer_bytes) {
+        FlushLocked();
+    }
+}
+
+bool WorkloadRecorder::Flush() {
+    std::lock_guard lock(mutex_);
+    return FlushLocked() && std::fflush(file_) == 0;
+}
+
+bool WorkloadRecorder::FlushLocked() {
+    if (!buffer_.empty() &&
+        std::fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size()) {
+        failed_ = true;
+    }
+    buffer_.clear();
+    return !failed_;
+}
+
+uint64_t WorkloadRecorder::GetRecordCount() const {
+    std::lock_guard lock(mutex_);
+    return records_;
+}
+
+uint64_t WorkloadRecorder::GetDroppedCount() const {
+    std::lock_guard lock(mutex_);
+    return dropped_;
+}
+
+Expected<WorkloadReader> WorkloadReader::Open(const std::string& path) {
+    auto file = MappedFile::Open(path);
+    if (!file) {
+        return file.GetError();
+    }
+    std::string_view bytes = file->GetBytes();
+    if (bytes.size() < kMagic.size() + 1 || !bytes.starts_with(kMagic) ||
+        bytes[kMagic.size()] != kVersion) {
+        return Error{ErrorKind::kSyntax, path + ": not a workload log"};
+    }
+    return WorkloadReader(std::move(*file));
+}
+
+WorkloadReader::WorkloadReader(MappedFile file)
+    : file_(std::move(file)), bytes_(file_.GetBytes()), offset_(kMagic.size() + 1) {
+}
+
+bool WorkloadReader::Next(WorkloadRecord* record) {
+    size_t offset = offset_;
+    uint64_t start;
+    uint64_t duration;
+    if (!GetVarint(bytes_, &offset, &start) || !GetVarint(bytes_, &offset, &duration) ||
+        offset >= bytes_.size()) {
+        return false;
+    }
+    uint8_t status = bytes_[offset++];
+    if (status > 1 + static_cast<int>(ErrorKind::kLimit) ||
+        !GetString(bytes_, &offset, &record->input) ||
+        !GetString(bytes_, &offset, &record->output)) {
+        return false;
+    }
+    record->start = std::chrono::nanoseconds(start);
+    record->duration = std::chrono::nanoseconds(duration);
+    record->failed = status != kOk;
+    record->error_kind = record->failed ? static_cast<ErrorKind>(status - 1) : ErrorKind::kSyntax;
+    offset_ = offset;
+    return true;
+}
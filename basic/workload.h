@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "binary.h"
+#include "error.h"
+
+// One run as recorded: when it started relative to the recorder, how long it took, and what it
+// printed or, for a failed run, the message of its error.
+struct WorkloadRecord {
+    std::chrono::nanoseconds start{0};
+    std::chrono::nanoseconds duration{0};
+    bool failed = false;
+    ErrorKind error_kind = ErrorKind::kSyntax;
+    std::string_view input;
+    std::string_view output;
+};
+
+struct WorkloadRecorderOptions {
+    // Records are collected in memory and written out once this many bytes are pending.
+    size_t buffer_bytes = 1 << 20;
+    // Once the log reaches this size further runs are dropped; zero means no limit.
+    uint64_t max_bytes = 0;
+};
+
+// Appends runs to a workload log for scheme_replay. The log is a header followed by records of
+// varint times and lengths and the raw input and output bytes; a log cut off by a crash reads
+// up to its last complete record.
+//
+// An interpreter records into the recorder set with Interpreter::SetWorkloadRecorder. Appending
+// copies the record into a buffer under a mutex, so one recorder can be shared by the workers
+// of a server; a worker that fills the buffer writes it out.
+class WorkloadRecorder {
+public:
+    static Expected<std::unique_ptr<WorkloadRecorder>> Open(
+        const std::string& path, const WorkloadRecorderOptions& options = {});
+
+    // Flushes what is pending.
+    ~WorkloadRecorder();
+
+    WorkloadRecorder(const WorkloadRecorder&) = delete;
+    WorkloadRecorder& operator=(const WorkloadRecorder&) = delete;
+
+    // Record start times are measured from here.
+    std::chrono::steady_clock::time_point GetStart() const {
+        return start_;
+    }
+
+    void Append(const WorkloadRecord& record);
+    // Returns false if a write failed, then or earlier.
+    bool Flush();
+
+    uint64_t GetRecordCount() const;
+    uint64_t GetDroppedCount() const;
+
+private:
+    WorkloadRecorder(std::FILE* file, const WorkloadRecorderOptions& options);
+
+    bool FlushLocked();
+
+    const WorkloadRecorderOptions options_;
+    const std::chrono::steady_clock::time_point start_;
+
+    mutable std::mutex mutex_;
+    std::FILE* file_;
+    std::string buffer_;
+    uint64_t size_ = 0;
+    uint64_t records_ = 0;
+    uint64_t dropped_ = 0;
+    bool failed_ = false;
+};
+
+// Reads the records of a workload log in the order they were appended. Records are views into
+// the mapped file and stay valid as long as the reader.
+class WorkloadReader {
+public:
+    static Expected<WorkloadReader> Open(const std::string& path);
+
+    // Returns false at the end of the log or at a truncated record.
+    bool Next(WorkloadRecord* record);
+
+private:
+    explicit WorkloadReader(MappedFile file);
+
+    MappedFile file_;
+    std::string_view bytes_;
+    size_t offset_ = 0;
+};
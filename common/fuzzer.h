@@ -2,7 +2,12 @@
 
 #include <sstream>
 #include <random>
+#include <algorithm>
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
 
 class Fuzzer {
 public:
@@ -32,3 +37,197 @@ private:
     std::stringstream ss_;
     std::mt19937 gen_;
 };
+
+// Generates programs that stress one dimension of the interpreter at a time: deep nesting, long
+// lists, large literals, whitespace the reader has to skip, or random arithmetic.
+// Generate is deterministic in its arguments and its output grows linearly with size, so the
+// cost of running it can be compared across sizes of one seed.
+class GrammarFuzzer {
+public:
+    enum class Shape : uint8_t {
+        kDeepCalls,
+        kDeepQuote,
+        kLongCall,
+        kLongList,
+        kLargeLiterals,
+        kWhitespace,
+        kRandom
+    };
+
+    static constexpr size_t kShapeCount = 7;
+
+    static const char* GetShapeName(Shape shape) {
+        static constexpr const char* kNames[kShapeCount] = {
+            "deep-calls", "deep-quote", "long-call", "long-list",
+            "large-literals", "whitespace", "random"};
+        return kNames[static_cast<size_t>(shape)];
+    }
+
+    std::string Generate(Shape shape, uint64_t seed, size_t size) const {
+        std::mt19937_64 gen(seed * kShapeCount + static_cast<size_t>(shape));
+        std::string out;
+        switch (shape) {
+            case Shape::kDeepCalls:
+                AppendDeepCalls(&gen, size, &out);
+                break;
+            case Shape::kDeepQuote:
+                out += gen() % 2 ? "'" : "(car '";
+                out.append(size, '(');
+                out += gen() % 2 ? "a" : "1 . 2";
+                out.append(size, ')');
+                if (out[0] == '(') {
+                    out += ')';
+                }
+                break;
+            case Shape::kLongCall:
+                AppendLongCall(&gen, size, &out);
+                break;
+            case Shape::kLongList:
+                AppendLongList(&gen, size, &out);
+                break;
+            case Shape::kLargeLiterals:
+                AppendLargeLiterals(&gen, size, &out);
+                break;
+            case Shape::kWhitespace:
+                AppendWhitespace(&gen, size, &out);
+                break;
+            case Shape::kRandom:
+                out += '(';
+                AppendRandom(&gen, size, 0, &out);
+                out += ')';
+                break;
+        }
+        return out;
+    }
+
+private:
+    static constexpr std::array kVariadic = {"+", "-", "*", "/", "max", "min", "=", "<",
+                                             ">=", "and", "or", "list"};
+    static constexpr std::array kUnary = {"abs", "not", "number?", "boolean?", "pair?",
+                                          "null?", "list?", "car", "cdr", "quote"};
+    static constexpr std::array kAtoms = {"0", "1", "-7", "42", "#t", "#f", "x", "'()", "'a"};
+    static constexpr std::array kRandomAtoms = {"1", "2", "-7", "42", "0"};
+
+    template <class Array>
+    static const char* Pick(std::mt19937_64* gen, const Array& names) {
+        return names[(*gen)() % names.size()];
+    }
+
+    static void AppendDeepCalls(std::mt19937_64* gen, size_t size, std::string* out) {
+        // One operator for the whole chain, so every level does the same work.
+        static constexpr std::array kChains = {"(+ 1 ", "(* 1 ", "(max 0 ", "(abs ", "(list ",
+                                               "(car (list ", "(and #t ", "(cons 1 "};
+        std::string_view link = Pick(gen, kChains);
+        for (size_t i = 0; i < size; ++i) {
+            *out += link;
+        }
+        *out += '1';
+        size_t closing = link.starts_with("(car") ? 2 : 1;
+        out->append(size * closing, ')');
+    }
+
+    static void AppendLongCall(std::mt19937_64* gen, size_t size, std::string* out) {
+        *out += '(';
+        *out += Pick(gen, kVariadic);
+        for (size_t i = 0; i < size; ++i) {
+            *out += ' ';
+            *out += std::to_string((*gen)() % 100);
+        }
+        *out += ')';
+    }
+
+    static void AppendLongList(std::mt19937_64* gen, size_t size, std::string* out) {
+        static constexpr std::array kHeads = {"'(", "(list? '(", "(list-tail '(", "(car '(",
+                                              "(list-ref '("};
+        std::string_view head = Pick(gen, kHeads);
+        *out += head;
+        for (size_t i = 0; i < size; ++i) {
+            *out += Pick(gen, kAtoms);
+            *out += ' ';
+        }
+        if ((*gen)() % 4 == 0) {
+            *out += ". 1";
+        }
+        *out += ')';
+        if (head.starts_with("(list-")) {
+            *out += ' ' + std::to_string(size / 2);
+        }
+        if (head != "'(") {
+            *out += ')';
+        }
+    }
+
+    static void AppendLargeLiterals(std::mt19937_64* gen, size_t size, std::string* out) {
+        switch ((*gen)() % 3) {
+            case 0:
+                *out += "(+ 1 ";
+                for (size_t i = 0; i < size; ++i) {
+                    *out += static_cast<char>('0' + (*gen)() % 10);
+                }
+                *out += ')';
+                break;
+            case 1:
+                *out += "'";
+                out->append(size, 'x');
+                break;
+            default:
+                *out += "(list";
+                for (size_t i = 0; i < size / 16 + 1; ++i) {
+                    *out += " '";
+                    out->append(16, static_cast<char>('a' + (*gen)() % 26));
+                }
+                *out += ')';
+                break;
+        }
+    }
+
+    // Runs of whitespace and of characters the reader skips, around dots and brackets.
+    static void AppendWhitespace(std::mt19937_64* gen, size_t size, std::string* out) {
+        static constexpr std::string_view kSkipped = " \t\n\r\v\f@\";,";
+        auto gap = [gen, size, out] {
+            for (size_t i = (*gen)() % (size + 1); i > 0; --i) {
+                *out += kSkipped[(*gen)() % kSkipped.size()];
+            }
+        };
+        *out += "'(";
+        for (int i = 0; i < 4; ++i) {
+            gap();
+            *out += Pick(gen, kAtoms);
+        }
+        gap();
+        *out += '.';
+        gap();
+        *out += '1';
+        gap();
+        *out += ')';
+    }
+
+    // A random call with about budget more tokens in it; the caller adds the brackets.
+    static size_t AppendRandom(std::mt19937_64* gen, size_t budget, size_t depth,
+                               std::string* out) {
+        // Arithmetic only: the other builtins fail on numbers, and the first failure would end
+        // the run long before the bulk of the input is evaluated.
+        static constexpr std::array kArithmetic = {"+", "-", "*", "max", "min"};
+        size_t used = 1;
+        bool unary = (*gen)() % 8 == 0;
+        *out += unary ? "abs" : Pick(gen, kArithmetic);
+        size_t arguments = unary ? 1 : 2 + (*gen)() % 3;
+        for (size_t i = 0; i < arguments || used < budget / 4; ++i) {
+            *out += ' ';
+            if (used < budget && depth < kMaxRandomDepth && (*gen)() % 2) {
+                *out += '(';
+                used += AppendRandom(gen, (budget - used) / 2, depth + 1, out);
+                *out += ')';
+            } else {
+                *out += Pick(gen, kRandomAtoms);
+                ++used;
+            }
+            if (unary) {
+                break;
+            }
+        }
+        return used;
+    }
+
+    static constexpr size_t kMaxRandomDepth = 64;
+};
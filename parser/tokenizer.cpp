@@ -144,7 +144,8 @@ bool Tokenizer::NextIsDot() {
             return false;
         } else if (IsSymbolBegin(cur_ch)) {
             return false;
-        } else if (cur_ch == ' ') {
+        } else {
+            // Whitespace and anything else Next would skip; stopping at it would loop forever.
             input_->get();
         }
     }